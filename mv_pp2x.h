@@ -22,6 +22,8 @@
 #include <linux/netdevice.h>
 #include <linux/string.h>
 #include <linux/log2.h>
+#include <linux/hashtable.h>
+#include <linux/version.h>
 
 #include "mv_pp2x_hw_type.h"
 #include "mv_gop110_hw_type.h"
@@ -29,6 +31,42 @@
 #define MVPP2_DRIVER_NAME "mvpp2"
 #define MVPP2_DRIVER_VERSION "1.0"
 
+/* Native XDP (ndo_xdp) is available starting from kernel 4.8 */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 8, 0)
+#define MVPP2_XDP
+#endif
+
+/* xdp_buff headroom (data_hard_start) is available starting from 4.10 */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 10, 0)
+#define MVPP2_XDP_HEADROOM
+#endif
+
+/* napi_consume_skb() bulk frees skbs from NAPI context starting from 4.5 */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 5, 0)
+#define MVPP2_NAPI_CONSUME
+#endif
+
+/* napi_complete_done() reports NAPI owned by busy polling starting from 4.10 */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 10, 0)
+#define MVPP2_NAPI_DONE_RET
+#endif
+
+/* ndo_setup_tc(dev, num_tc) is the API of kernels up to 4.5, replaced by
+ * ndo_setup_tc(dev, handle, protocol, tc_to_netdev) from 4.6 to 4.11.
+ * tc flower and matchall offloads with actions walked by tcf_exts_to_list()
+ * are available starting from 4.9.
+ */
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4, 11, 0)
+#define MVPP2_TC
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 6, 0)
+#define MVPP2_TC_TO_NETDEV
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 9, 0) && \
+	defined(CONFIG_NET_CLS_ACT)
+#define MVPP2_TC_FLOWER
+#endif
+#endif
+
 #define MVPP2X_SKB_MAGIC_MASK		0xFFFFFFC0
 #define MVPP2X_SKB_MAGIC_SKB_OFFS	3
 #define MVPP2X_SKB_PP2_CELL_OFFS	4
@@ -56,11 +94,19 @@
 
 #define IRQ_NAME_SIZE (36)
 
-#define STATS_DELAY	250
+/* Background refresh of the clear on read 32-bit counters before they
+ * saturate, readers refresh them on demand at most every
+ * MVPP2_STATS_REFRESH_MSEC
+ */
+#define STATS_DELAY	5000
+#define MVPP2_STATS_REFRESH_MSEC	100
 
 #define TSO_TXQ_LIMIT 100
 #define TXQ_LIMIT (MAX_SKB_FRAGS + 2)
 
+/* Segmentation done by mv_pp2_tx_tso() */
+#define MVPP2_TSO_FEATURES	(NETIF_F_TSO | NETIF_F_TSO6)
+
 #define MV_ETH_SKB_SHINFO_SIZE	SKB_DATA_ALIGN(sizeof(struct skb_shared_info))
 
 /* START - Taken from mvPp2Commn.h, need to order TODO */
@@ -156,12 +202,32 @@
 /* Coalescing */
 #define MVPP2_TXDONE_COAL_PKTS		64
 #define MVPP2_TXDONE_HRTIMER_PERIOD_NS	1000000UL
-#define MVPP2_TX_HRTIMER_PERIOD_NS	50000UL
 #define MVPP2_TXDONE_COAL_USEC		1000
 
+/* Aggregated TXQ doorbell: descriptors and bytes bulked before the
+ * doorbell is rung, and the optional deferral timer period (0 - disabled)
+ */
+#define MVPP2_TX_DB_FRAMES		64
+#define MVPP2_TX_DB_BYTES		(32 * 1024)
+#define MVPP2_TX_DB_USEC		0
+#define MVPP2_TX_DB_MAX_USEC		1000
+#define MVPP2_TX_DB_HIST_NUM		7 /* 1, 2-3, 4-7, ..., 64+ */
+
 #define MVPP2_RX_COAL_PKTS		32
 #define MVPP2_RX_COAL_USEC		64
 
+/* RX descriptors harvested before their packets are built */
+#define MVPP2_RX_BATCH			16
+
+/* Max polls served from pending_cause_rx without reading cause register */
+#define MVPP2_CAUSE_SKIP_MAX		8
+
+/* Dynamic interrupt moderation */
+#define MVPP2_DIM_NEVENTS		64 /* polls per sampling window */
+#define MVPP2_DIM_PROFILES_NUM		5
+#define MVPP2_DIM_DEF_PROFILE		1
+#define MVPP2_DIM_DIFF_PCT		10 /* significant rate change */
+
 /* BM constants */
 #define MVPP2_BM_POOLS_NUM		16
 #define MVPP2_BM_POOLS_MAX_ALLOC_NUM	4 /* Max num of allowed BM pools
@@ -186,16 +252,25 @@ extern  u32 debug_param;
 #define QV_THR_2_CPU(sw_thread_id)	(sw_thread_id - first_addr_space)
 #define QV_CPU_2_THR(cpu_id)		(first_addr_space + cpu_id)
 
-/* Used for define type of data saved in shadow: SKB or extended buffer or nothing */
-#define MVPP2_ETH_SHADOW_SKB		0x1
-#define MVPP2_ETH_SHADOW_EXT		0x2
-#define MVPP2_ETH_SHADOW_REC		0x4
+/* Type of data saved in TX shadow entry */
+enum mv_pp2x_tx_shadow_type {
+	MVPP2_ETH_SHADOW_NONE,		/* mapped buffer only */
+	MVPP2_ETH_SHADOW_SKB,		/* mapped buffer, last one of skb */
+	MVPP2_ETH_SHADOW_EXT,		/* TSO header slot, not mapped */
+	MVPP2_ETH_SHADOW_REC,		/* recycled skb, buffer released by HW */
+	MVPP2_ETH_SHADOW_XDP,		/* XDP_TX buffer, released by HW */
+	MVPP2_ETH_SHADOW_PAGE,		/* mapped fragment, page reference */
+};
+
+/* Number of TX shadow entries prefetched ahead by TX done */
+#define MVPP2_TX_SHADOW_PREFETCH	8
 
 #define MVPP2_UNIQUE_HASH		0x4567492
 
-#define MVPP2_EXTRA_BUF_SIZE	120
-#define MVPP2_EXTRA_BUF_NUM	(MVPP2_MAX_TXD * MVPP2_MAX_TXQ)
-#define MVPP2_SKB_NUM		(MVPP2_MAX_RXD * MVPP2_MAX_RXQ * MVPP2_MAX_PORTS)
+/* Per descriptor slot of the TSO header area: MH + MAC + IP + TCP headers */
+#define MVPP2_TSO_HDR_SIZE	128
+/* Max number of objects moved at once between caller and object cache */
+#define MVPP2_OBJ_CACHE_BULK	16
 
 enum mvppv2_version {
 	PPV21 = 21,
@@ -256,6 +331,9 @@ struct gop_stat {
 	u64 rx_total_err;
 	u64 rx_hw_drop;
 	u64 rx_sw_drop;
+	u64 rx_police_green;
+	u64 rx_police_yellow;
+	u64 rx_police_red;
 	u64 tx_byte;
 	u64 tx_unicast;
 	u64 tx_mcast;
@@ -307,6 +385,21 @@ struct mv_mac_data {
 #define MVPP2_NO_LINK_IRQ	0
 
 /* Per-CPU Tx queue control */
+/* TX shadow entry, 16 bytes so that 4 entries share a cache line */
+struct mv_pp2x_tx_shadow {
+	void *cookie;			/* skb or page, by type */
+	u32 buf_phys_addr;
+	u16 data_size;
+	u8 buf_phys_addr_high;		/* PPv2.2 40 bit address */
+	u8 type;			/* enum mv_pp2x_tx_shadow_type */
+};
+
+static inline dma_addr_t mv_pp2x_tx_shadow_phys_addr(struct mv_pp2x_tx_shadow *shadow)
+{
+	return (dma_addr_t)(((u64)shadow->buf_phys_addr_high << 32) |
+			    shadow->buf_phys_addr);
+}
+
 struct mv_pp2x_txq_pcpu {
 	int cpu;
 
@@ -316,13 +409,12 @@ struct mv_pp2x_txq_pcpu {
 	/* Number of Tx DMA descriptors reserved for each CPU */
 	int reserved_num;
 
-	/* Array of transmitted skb */
-	struct sk_buff **tx_skb;
-
-	/* Array of transmitted buffers' physical addresses */
-	dma_addr_t *tx_buffs;
+	/* Shadow entry per TX descriptor */
+	struct mv_pp2x_tx_shadow *shadow;
 
-	int *data_size;
+	/* TSO headers, one MVPP2_TSO_HDR_SIZE slot per TX descriptor */
+	u8 *tso_hdrs;
+	dma_addr_t tso_hdrs_phys;
 
 	/* Index of last TX DMA descriptor that was inserted */
 	int txq_put_index;
@@ -396,6 +488,15 @@ struct mv_pp2x_aggr_tx_queue {
 
 	/* Used to statistic the desc number to xmit in bulk */
 	u32 xmit_bulk;
+	/* Bytes carried by the bulked descriptors */
+	u32 xmit_bytes;
+};
+
+/* RX frame harvested from RX descriptor, data is NULL for chained buffers */
+struct mv_pp2x_rx_frame {
+	struct mv_pp2x_rx_desc *rx_desc;
+	dma_addr_t buf_phys_addr;
+	unsigned char *data;
 };
 
 struct mv_pp2x_rx_queue {
@@ -431,6 +532,10 @@ struct mv_pp2x_rx_queue {
 	/* ID of port to which physical RXQ is mapped */
 	int port;
 
+	/* Dedicated BM pool of RXQ handed over to user space, NULL if RXQ
+	 * is owned by kernel
+	 */
+	struct mv_pp2x_bm_pool *ext_pool;
 };
 
 struct avanta_lp_gop_hw {
@@ -493,12 +598,22 @@ struct mv_pp2x_hw {
 
 	/* PRS shadow table */
 	struct mv_pp2x_prs_shadow *prs_shadow;
+	/* PRS shadow index of MAC/VLAN/VID/flow entries */
+	DECLARE_HASHTABLE(prs_hash, MVPP2_PRS_HASH_BITS);
+	/* PRS tcam allocation bitmap, follows prs_shadow valid */
+	DECLARE_BITMAP(prs_used, MVPP2_PRS_TCAM_SRAM_SIZE);
+	/* PRS tcam entries moved by compaction */
+	u32 prs_moves;
 	/* PRS auxiliary table for double vlan entries control */
 	bool *prs_double_vlans;
 	/* CLS shadow info for update in running time */
 	struct mv_pp2x_cls_shadow *cls_shadow;
 	/* C2 shadow info */
 	struct mv_pp2x_c2_shadow *c2_shadow;
+	/* C3 hash table access and aRFS filters of all ports */
+	spinlock_t c3_lock;
+	/* Port owning each bank 0 policer, MVPP2_PLCR_NONE if free */
+	s8 plcr_owner[MVPP2_PLCR_BANK_NUM];
 };
 
 struct mv_pp2x_cos {
@@ -515,8 +630,53 @@ struct mv_pp2x_rss {
 	u8 rss_mode; /*UDP packet */
 	u8 dflt_cpu; /*non-IP packet */
 	u8 rss_en;
+	u32 hash_opts[MVPP2_RSS_FLOW_NUM]; /* MVPP2_RSS_HEK_* per flow type */
 };
 
+struct mv_pp2x_ntuple_rule {
+	struct ethtool_rx_flow_spec fs;
+	u32 hits_base;	/* C2 hit counter when the rule was set */
+	u32 rss_context;	/* RSS context spreading the rule, 0 for none */
+	bool valid;
+};
+
+#ifdef MVPP2_TC_FLOWER
+struct mv_pp2x_tc_flower {
+	unsigned long cookie;
+	u32 order;		/* Insertion order, lower is matched first */
+	int loc;		/* ntuple lookup of the filter match keys */
+	struct mv_pp2x_cls_ntuple rule;
+	u64 hits;		/* Hits in previous C2 entries of the filter */
+	u32 hits_base;		/* C2 hit counter when the entry was written */
+	u64 hits_reported;	/* Hits already reported to tc */
+	unsigned long lastuse;
+};
+#endif
+
+#ifdef CONFIG_RFS_ACCEL
+#define MVPP2_ARFS_FILTERS		128
+#define MVPP2_ARFS_HASH_BITS		7
+#define MVPP2_ARFS_EXPIRE_PERIOD	HZ
+
+struct mv_pp2x_arfs_filter {
+	struct hlist_node node;
+	struct mv_pp2x_cls_c3_flow flow;
+	u32 flow_id;		/* RPS flow id, used for expiry */
+	u16 rxq_index;		/* RPS RX queue, i.e. CPU q_vector index */
+	int c3_idx;		/* C3 hash table index, -1 when not in HW */
+	bool used;
+	bool pending;		/* C3 entry to be (re)written */
+};
+
+struct mv_pp2x_arfs {
+	struct mv_pp2x_port *port;
+	struct delayed_work work;
+	unsigned long expire_time;
+	DECLARE_HASHTABLE(hash, MVPP2_ARFS_HASH_BITS);
+	struct mv_pp2x_arfs_filter filters[MVPP2_ARFS_FILTERS];
+};
+#endif
+
 struct mv_pp2x_param_config {
 	u8 first_bm_pool;
 	u8 first_sw_thread; /* The index of the first PPv2.2
@@ -565,6 +725,11 @@ struct mv_pp2x {
 	*/
 	u8 num_rss_tables; /* created for sysfs usage */
 	u32 rx_indir_table[MVPP22_RSS_TBL_LINE_NUM];
+	/* RSS contexts use the tables past num_rss_tables, the context ID
+	 * is the table number. Each one is owned by a single port.
+	 */
+	struct mv_pp2x_port *rss_ctx_port[MVPP22_RSS_TBL_NUM];
+	u32 rss_ctx_indir[MVPP22_RSS_TBL_NUM][MVPP22_RSS_TBL_LINE_NUM];
 	u32 l4_chksum_jumbo_port;
 
 	struct delayed_work stats_task;
@@ -578,6 +743,28 @@ struct mv_pp2x_pcpu_stats {
 	u64	rx_bytes;
 	u64	tx_packets;
 	u64	tx_bytes;
+	u64	rx_xdp_drop;
+	u64	rx_xdp_tx;
+	u64	rx_page_reuse;
+	u64	rx_page_alloc;
+	u64	rx_refill_bursts;
+	u64	rx_refill_bufs;
+	u64	rx_skb_cache_hit;
+	u64	rx_skb_cache_miss;
+	u64	tx_skb_recycled;
+	u64	tx_skb_freed;
+	u64	tx_done_batches;
+	u64	tx_done_descs;
+	u64	rx_irq_polls;
+	u64	rx_busy_polls;
+	u64	rx_multi_buf;
+};
+
+/* Per-CPU LIFO cache of preallocated objects */
+struct mv_pp2x_obj_cache {
+	int size;
+	int count;
+	void **objs;
 };
 
 /* Per-CPU port control */
@@ -586,20 +773,52 @@ struct mv_pp2x_port_pcpu {
 	bool timer_scheduled;
 	/* Tasklet for egress finalization */
 	struct tasklet_struct tx_done_tasklet;
-	int ext_buf_size;
-	struct list_head ext_buf_port_list;
-	struct mv_pp2x_ext_buf_pool *ext_buf_pool;
 };
 
 /* Per-CPU CP control */
 struct mv_pp2x_cp_pcpu {
-	struct list_head skb_port_list;
-	struct mv_pp2x_skb_pool *skb_pool;
+	/* Recycled skbs without data buffer */
+	struct mv_pp2x_obj_cache skb_pool;
 	int in_use[MVPP2_BM_POOLS_NUM];
+	/* Buffers staged for a burst release to BM */
+	dma_addr_t refill_stage[MVPP2_BM_REFILL_BATCH];
 
 	struct hrtimer tx_timer;
 	struct tasklet_struct tx_tasklet;
 	bool tx_timer_scheduled;
+	/* NAPI poll of this CP runs, doorbell is rung at its end */
+	bool in_napi;
+	/* Aggregated TXQ doorbell batch size histogram (log2 buckets) */
+	u64 tx_db_hist[MVPP2_TX_DB_HIST_NUM];
+	u64 tx_db_timer;
+	struct u64_stats_sync syncp;
+};
+
+enum mv_pp2x_dim_state {
+	MVPP2_DIM_PARKING,
+	MVPP2_DIM_GOING_RIGHT,
+	MVPP2_DIM_GOING_LEFT
+};
+
+struct mv_pp2x_dim_profile {
+	u32 usecs;
+	u32 pkts;
+};
+
+/* Dynamic interrupt moderation state of one direction of a queue vector */
+struct mv_pp2x_dim {
+	/* Start of the sampling window */
+	ktime_t start_time;
+	u64 start_pkts;
+	u64 start_bytes;
+	u16 events;
+	/* Rates of the previous window, per msec */
+	u32 ppms;
+	u32 bpms;
+	u32 epms;
+	u8 profile_ix;
+	u8 state;
+	u8 steps;
 };
 
 struct queue_vector {
@@ -617,6 +836,16 @@ struct queue_vector {
 			* in Ethernet Occupied Interrupt Cause (EthOccIC))
 			*/
 	struct mv_pp2x_port *parent;
+	/* Poll scheduled by interrupt, cleared by first poll */
+	bool irq_sched;
+	/* Previous poll exhausted its budget */
+	bool repoll;
+	u8 cause_skip;
+	/* Adaptive coalescing */
+	u64 rx_pkts;
+	u64 rx_bytes;
+	struct mv_pp2x_dim rx_dim;
+	struct mv_pp2x_dim tx_dim;
 };
 
 struct mv_pp2x_ptp_desc; /* per-port private PTP descriptor */
@@ -660,7 +889,16 @@ struct mv_pp2x_port {
 	u16 rx_ring_size;
 
 	u32 tx_time_coal;
+	/* Aggregated TXQ doorbell thresholds */
+	u32 tx_db_frames;
+	u32 tx_db_usecs;
 	struct mv_pp2x_pcpu_stats __percpu *stats;
+	/* mac_data.gop_statistics is updated by one context under stats_lock
+	 * and read as a snapshot under stats_seq
+	 */
+	spinlock_t stats_lock;
+	seqcount_t stats_seq;
+	unsigned long stats_jiffies;
 
 	struct mv_pp2x_bm_pool *pool_long; /* Pointer to the pool_id
 					* (long or jumbo)
@@ -679,8 +917,38 @@ struct mv_pp2x_port {
 	struct mv_pp2x_ptp_desc *ptp_desc;
 	struct mv_pp2x_cos cos_cfg;
 	struct mv_pp2x_rss rss_cfg;
+	struct mv_pp2x_ntuple_rule ntuple_rules[MVPP2_CLS_NTUPLE_RULES];
+	/* Policer of the port RX traffic, MVPP2_PLCR_NONE for none */
+	int plcr;
+	/* TXQ shaper rates in Mbps from tx_maxrate, 0 for no limit */
+	u32 txq_maxrate[MVPP2_MAX_TXQ];
+	/* Offloaded mqprio traffic classes, class i is sent on TXQ i and
+	 * owns its netdev TX queues
+	 */
+	u8 num_tc;
+	/* TXQ fixed priority setting before the mqprio offload */
+	u32 tx_fixed_prio;
+#ifdef MVPP2_TC_FLOWER
+	/* tc flower filters in insertion order, filter i has C2 TCAM entry
+	 * MVPP2_CLS_C2_FLOWER_IDX(id, i)
+	 */
+	struct mv_pp2x_tc_flower *tc_flowers[MVPP2_CLS_C2_FLOWER_ENTRIES];
+	int tc_flower_num;
+	/* Order given to the next new filter */
+	u32 tc_flower_order;
+	/* Number of tc flower filters in each ntuple lookup */
+	int tc_flower_lkp_ref[MVPP2_CLS_NTUPLE_RULES];
+	/* tc matchall filter of the port policer */
+	unsigned long tc_mall_cookie;
+#endif
+#ifdef CONFIG_RFS_ACCEL
+	struct mv_pp2x_arfs *arfs;
+#endif
 	struct notifier_block	port_hotplug_nb;
 	int use_interrupts;
+#ifdef MVPP2_XDP
+	struct bpf_prog *xdp_prog;
+#endif
 };
 
 struct pp2x_hw_params {
@@ -701,30 +969,6 @@ struct mv_pp2x_platform_data {
 	struct pp2x_hw_params hw;
 };
 
-struct mv_pp2x_ext_buf_struct {
-	struct list_head ext_buf_list;
-	u8 *ext_buf_data;
-};
-
-struct mv_pp2x_skb_struct {
-	struct list_head skb_list;
-	struct sk_buff *skb;
-};
-
-struct mv_pp2x_ext_buf_pool {
-	int buf_pool_size;
-	int buf_pool_next_free;
-	int buf_pool_in_use;
-	struct mv_pp2x_ext_buf_struct *ext_buf_struct;
-};
-
-struct mv_pp2x_skb_pool {
-	int skb_pool_size;
-	int skb_pool_in_use;
-	int skb_pool_next_free;
-	struct mv_pp2x_skb_struct *skb_struct;
-};
-
 static inline struct mv_pp2x_port *mv_pp2x_port_struct_get(struct mv_pp2x *priv,
 							   int port)
 {
@@ -774,6 +1018,35 @@ static inline u8 mv_pp2x_bound_cpu_first_rxq_calc(struct mv_pp2x_port *port)
 	return(port->first_rxq + (bind_cpu << cos_width));
 }
 
+/* Netdev TX queues are laid out TXQ major, TXQ txq is sent from netdev TX
+ * queue txq * ncpus + cpu, so the queues of a TXQ are contiguous.
+ */
+static inline int mv_pp2x_txq_ncpus(struct mv_pp2x_port *port)
+{
+	return port->dev->num_tx_queues / port->num_tx_queues;
+}
+
+static inline u16 mv_pp2x_txq_ndev_queue(struct mv_pp2x_port *port, int txq,
+					 int cpu)
+{
+	return txq * mv_pp2x_txq_ncpus(port) + cpu;
+}
+
+/* RXQ number selecting the table of RSS context ctx for the port. It is
+ * past the port's RXQs and is overwritten by the context table entries.
+ */
+static inline u8 mv_pp22_rss_ctx_rxq(struct mv_pp2x_port *port, u32 ctx)
+{
+	u8 max_rxqs = port->priv->pp2xdata->pp2x_max_port_rxqs;
+
+	return(port->id * max_rxqs + max_rxqs - MVPP22_RSS_TBL_NUM + ctx);
+}
+
+static inline bool mv_pp22_rss_ctx_owned(struct mv_pp2x_port *port, u32 ctx)
+{
+	return ctx < MVPP22_RSS_TBL_NUM && port->priv->rss_ctx_port[ctx] == port;
+}
+
 /* Swap RX descriptor to be BE */
 static inline void mv_pp21_rx_desc_swap(struct mv_pp2x_rx_desc *rx_desc)
 {
@@ -841,23 +1114,39 @@ int mv_pp2x_bm_pool_destroy(struct device *dev, struct mv_pp2x *priv,
 			    struct mv_pp2x_bm_pool *bm_pool);
 int mv_pp2x_swf_bm_pool_assign(struct mv_pp2x_port *port, u32 rxq,
 			       u32 long_id, u32 short_id);
+int mv_pp2x_rxq_ext_pool_bind(struct mv_pp2x_port *port, u32 rxq,
+			      u32 pkt_size, u32 *pool_id);
+int mv_pp2x_rxq_ext_pool_unbind(struct mv_pp2x_port *port, u32 rxq);
 int mv_pp2x_open(struct net_device *dev);
 int mv_pp2x_stop(struct net_device *dev);
 void mv_pp2x_txq_inc_put(enum mvppv2_version pp2_ver,
 			 struct mv_pp2x_txq_pcpu *txq_pcpu,
-			 struct sk_buff *skb,
+			 void *cookie, u8 type,
 			 struct mv_pp2x_tx_desc *tx_desc);
 int mv_pp2x_check_ringparam_valid(struct net_device *dev,
 				  struct ethtool_ringparam *ring);
 void mv_pp2x_start_dev(struct mv_pp2x_port *port);
 void mv_pp2x_stop_dev(struct mv_pp2x_port *port);
+void mv_pp2x_dim_set(struct mv_pp2x_port *port, bool rx, bool tx);
 void mv_pp2x_cleanup_rxqs(struct mv_pp2x_port *port);
 int mv_pp2x_setup_rxqs(struct mv_pp2x_port *port);
 int mv_pp2x_setup_txqs(struct mv_pp2x_port *port);
 void mv_pp2x_cleanup_txqs(struct mv_pp2x_port *port);
 void mv_pp2x_set_ethtool_ops(struct net_device *netdev);
+#ifdef MVPP2_TC_TO_NETDEV
+int mv_pp2x_setup_tc(struct net_device *dev, u32 handle, __be16 proto,
+		     struct tc_to_netdev *tc);
+#elif defined(MVPP2_TC)
+int mv_pp2x_setup_tc(struct net_device *dev, u8 num_tc);
+#endif
 void mv_pp2x_set_non_kernel_ethtool_ops(struct net_device *netdev);
 int mv_pp22_rss_rxfh_indir_set(struct mv_pp2x_port *port);
+int mv_pp22_rss_ctx_indir_set(struct mv_pp2x_port *port, u32 ctx);
+int mv_pp22_rss_ctx_alloc(struct mv_pp2x_port *port);
+int mv_pp22_rss_ctx_free(struct mv_pp2x_port *port, u32 ctx);
+int mv_pp22_rss_ctx_cpus_set(struct mv_pp2x_port *port, u32 ctx, u32 cpu_mask);
+u32 mv_pp22_rss_ctx_cpus_get(struct mv_pp2x_port *port, u32 ctx);
+int mv_pp2x_ntuple_rss_ctx_set(struct mv_pp2x_port *port, u32 loc, u32 ctx);
 int mv_pp2x_cos_classifier_set(struct mv_pp2x_port *port,
 			       enum mv_pp2x_cos_classifier cos_mode);
 int mv_pp2x_cos_classifier_get(struct mv_pp2x_port *port);
@@ -866,6 +1155,10 @@ int mv_pp2x_cos_pri_map_get(struct mv_pp2x_port *port);
 int mv_pp2x_cos_default_value_set(struct mv_pp2x_port *port, int cos_value);
 int mv_pp2x_cos_default_value_get(struct mv_pp2x_port *port);
 int mv_pp22_rss_mode_set(struct mv_pp2x_port *port, int rss_mode);
+int mv_pp22_rss_hash_opts_set(struct mv_pp2x_port *port, int flow,
+			      u32 hek_opts);
+void mv_pp2x_port_stats_get(struct mv_pp2x_port *port,
+			    struct gop_stat *gop_statistics);
 int mv_pp22_rss_default_cpu_set(struct mv_pp2x_port *port, int default_cpu);
 int mv_pp2x_txq_reserved_desc_num_proc(struct mv_pp2x *priv,
 				       struct mv_pp2x_tx_queue *txq,
@@ -21,6 +21,7 @@
 #include <linux/etherdevice.h>
 #include <linux/platform_device.h>
 #include <linux/skbuff.h>
+#include <linux/if_vlan.h>
 #include <linux/inetdevice.h>
 #include <linux/mbus.h>
 #include <linux/module.h>
@@ -67,9 +68,22 @@ static const char mv_pp2x_gstrings_stats[][ETH_GSTRING_LEN] = {
 	"rx_pause", "tx_pause", "rx_mac_overrun", "rx_crc", "rx_runt",
 	"rx_giant", "rx_fragments_err", "rx_mac_err", "rx_jabber", "rx_ppv2_overrun",
 	"rx_cls_drop", "rx_fullq_drop", "rx_early_drop", "rx_bm_drop",
-	"rx_total_err",	"rx_sw_drop", "rx_hw_drop", "tx_crc_sent",
+	"rx_total_err",	"rx_sw_drop", "rx_hw_drop",
+	"rx_police_green", "rx_police_yellow", "rx_police_red", "tx_crc_sent",
 	"tx_drop", "collision",	"late_collision", "frames_64", "frames_65_to_127",
 	"frames_128_to_255", "frames_256_to_511", "frames_512_to_1023", "frames_1024_to_max",
+	/* driver SW counters */
+	"rx_xdp_drop", "rx_xdp_tx",
+	"rx_page_reuse", "rx_page_alloc",
+	"rx_refill_bursts", "rx_refill_bufs",
+	"rx_skb_cache_hit", "rx_skb_cache_miss",
+	"tx_skb_recycled", "tx_skb_freed", "tx_done_batches", "tx_done_descs",
+	"rx_irq_polls", "rx_busy_polls", "rx_multi_buf",
+	/* aggregated TXQ doorbell, shared by the ports of a CP */
+	"tx_db_batch_1", "tx_db_batch_2_3", "tx_db_batch_4_7", "tx_db_batch_8_15",
+	"tx_db_batch_16_31", "tx_db_batch_32_63", "tx_db_batch_64_max", "tx_db_timer",
+	/* ntuple RX classification rules, by location */
+	"rx_cls_rule0_hits", "rx_cls_rule1_hits", "rx_cls_rule2_hits", "rx_cls_rule3_hits",
 };
 
 int mv_pp2x_check_speed_duplex_valid(struct ethtool_cmd *cmd,
@@ -179,26 +193,80 @@ void mv_pp2x_ethtool_valid_coalesce(struct ethtool_coalesce *c,
 			(MVPP22_MAX_ISR_TX_THRESHOLD * USEC_PER_SEC)
 			/ port->priv->hw.tclk;
 	}
+
+	if (c->tx_max_coalesced_frames_irq > MVPP2_AGGR_TXQ_SIZE / 2) {
+		pr_err("TX doorbell frames value too high, rounded to %d\n",
+		       MVPP2_AGGR_TXQ_SIZE / 2);
+		c->tx_max_coalesced_frames_irq = MVPP2_AGGR_TXQ_SIZE / 2;
+	} else if (!c->tx_max_coalesced_frames_irq) {
+		c->tx_max_coalesced_frames_irq = 1;
+	}
+
+	if (c->tx_coalesce_usecs_irq > MVPP2_TX_DB_MAX_USEC) {
+		pr_err("TX doorbell time value too high, rounded to %d usecs\n",
+		       MVPP2_TX_DB_MAX_USEC);
+		c->tx_coalesce_usecs_irq = MVPP2_TX_DB_MAX_USEC;
+	}
 }
 
 /* Ethtool methods */
 
 /* Ethtool statistic */
+/* Sum per-CPU SW counter located at offset inside mv_pp2x_pcpu_stats */
+static u64 mv_pp2x_pcpu_stats_sum(struct mv_pp2x_port *port, size_t offset)
+{
+	unsigned int start;
+	u64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct mv_pp2x_pcpu_stats *cpu_stats = per_cpu_ptr(port->stats, cpu);
+		u64 val;
+
+		do {
+			start = u64_stats_fetch_begin_irq(&cpu_stats->syncp);
+			val = *(u64 *)((u8 *)cpu_stats + offset);
+		} while (u64_stats_fetch_retry_irq(&cpu_stats->syncp, start));
+
+		sum += val;
+	}
+
+	return sum;
+}
+
+/* Sum per-CPU CP counter located at offset inside mv_pp2x_cp_pcpu */
+static u64 mv_pp2x_cp_pcpu_sum(struct mv_pp2x_port *port, size_t offset)
+{
+	unsigned int start;
+	u64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct mv_pp2x_cp_pcpu *cp_pcpu = per_cpu_ptr(port->priv->pcpu, cpu);
+		u64 val;
+
+		do {
+			start = u64_stats_fetch_begin_irq(&cp_pcpu->syncp);
+			val = *(u64 *)((u8 *)cp_pcpu + offset);
+		} while (u64_stats_fetch_retry_irq(&cp_pcpu->syncp, start));
+
+		sum += val;
+	}
+
+	return sum;
+}
+
 static void mv_pp2x_eth_tool_get_ethtool_stats(struct net_device *dev,
 					       struct ethtool_stats *stats, u64 *data)
 {
 	struct mv_pp2x_port *port = netdev_priv(dev);
-	struct mv_mac_data *mac = &port->mac_data;
-	struct gop_hw *gop = &port->priv->hw.gop;
-	int gop_port = mac->gop_index;
-	struct gop_stat	*gop_statistics = &mac->gop_statistics;
-	int i = 0;
+	struct gop_stat	gop_stats, *gop_statistics = &gop_stats;
+	int i = 0, j;
 
 	if (port->priv->pp2_version == PPV21)
 		return;
 
-	mv_gop110_mib_counters_stat_update(gop, gop_port, gop_statistics);
-	mv_pp2x_counters_stat_update(port, gop_statistics);
+	mv_pp2x_port_stats_get(port, gop_statistics);
 
 	data[i++] = gop_statistics->rx_byte;
 	data[i++] = gop_statistics->rx_frames;
@@ -227,6 +295,9 @@ static void mv_pp2x_eth_tool_get_ethtool_stats(struct net_device *dev,
 	data[i++] = gop_statistics->rx_total_err;
 	data[i++] = gop_statistics->rx_sw_drop;
 	data[i++] = gop_statistics->rx_hw_drop;
+	data[i++] = gop_statistics->rx_police_green;
+	data[i++] = gop_statistics->rx_police_yellow;
+	data[i++] = gop_statistics->rx_police_red;
 	data[i++] = gop_statistics->tx_crc_sent;
 	data[i++] = dev->stats.tx_dropped;
 	data[i++] = gop_statistics->collision;
@@ -237,6 +308,29 @@ static void mv_pp2x_eth_tool_get_ethtool_stats(struct net_device *dev,
 	data[i++] = gop_statistics->frames_256_to_511;
 	data[i++] = gop_statistics->frames_512_to_1023;
 	data[i++] = gop_statistics->frames_1024_to_max;
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, rx_xdp_drop));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, rx_xdp_tx));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, rx_page_reuse));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, rx_page_alloc));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, rx_refill_bursts));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, rx_refill_bufs));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, rx_skb_cache_hit));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, rx_skb_cache_miss));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, tx_skb_recycled));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, tx_skb_freed));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, tx_done_batches));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, tx_done_descs));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, rx_irq_polls));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, rx_busy_polls));
+	data[i++] = mv_pp2x_pcpu_stats_sum(port, offsetof(struct mv_pp2x_pcpu_stats, rx_multi_buf));
+	for (j = 0; j < MVPP2_TX_DB_HIST_NUM; j++)
+		data[i++] = mv_pp2x_cp_pcpu_sum(port, offsetof(struct mv_pp2x_cp_pcpu, tx_db_hist) +
+						j * sizeof(u64));
+	data[i++] = mv_pp2x_cp_pcpu_sum(port, offsetof(struct mv_pp2x_cp_pcpu, tx_db_timer));
+	for (j = 0; j < MVPP2_CLS_NTUPLE_RULES; j++)
+		data[i++] = port->ntuple_rules[j].valid ?
+			    (u32)(mv_pp2x_cls_ntuple_hits_get(port, j) -
+				  port->ntuple_rules[j].hits_base) : 0;
 }
 
 static void mv_pp2x_eth_tool_get_strings(struct net_device *dev,
@@ -624,11 +718,7 @@ static int mv_pp2x_ethtool_set_coalesce(struct net_device *dev,
 	/* Check for not supported parameters  */
 	if ((c->rx_coalesce_usecs_irq) ||
 	    (c->rx_max_coalesced_frames_irq) ||
-	    (c->tx_coalesce_usecs_irq) ||
-	    (c->tx_max_coalesced_frames_irq) ||
 	    (c->stats_block_coalesce_usecs) ||
-	    (c->use_adaptive_rx_coalesce) ||
-	    (c->use_adaptive_tx_coalesce) ||
 	    (c->pkt_rate_low) ||
 	    (c->rx_coalesce_usecs_low) ||
 	    (c->rx_max_coalesced_frames_low) ||
@@ -644,17 +734,32 @@ static int mv_pp2x_ethtool_set_coalesce(struct net_device *dev,
 		return -EOPNOTSUPP;
 	}
 
+	if (c->use_adaptive_tx_coalesce && !port->priv->pp2xdata->interrupt_tx_done) {
+		netdev_err(dev, "adaptive TX coalescing requires TX done interrupts\n");
+		return -EOPNOTSUPP;
+	}
+
 	mv_pp2x_ethtool_valid_coalesce(c, port);
 
+	/* Static values are kept while adaptive mode owns the thresholds */
 	for (queue = 0; queue < port->num_rx_queues; queue++) {
 		struct mv_pp2x_rx_queue *rxq = port->rxqs[queue];
 
+		if (rxq->ext_pool)
+			continue;
 		rxq->time_coal = c->rx_coalesce_usecs;
 		rxq->pkts_coal = c->rx_max_coalesced_frames;
+		if (c->use_adaptive_rx_coalesce)
+			continue;
 		mv_pp2x_rx_pkts_coal_set(port, rxq);
 		mv_pp2x_rx_time_coal_set(port, rxq);
 	}
 	port->tx_time_coal = c->tx_coalesce_usecs;
+	/* No TX interrupt moderation besides TX done, the "irq" pair sets
+	 * the aggregated TXQ doorbell threshold and deferral time.
+	 */
+	port->tx_db_frames = c->tx_max_coalesced_frames_irq;
+	port->tx_db_usecs = c->tx_coalesce_usecs_irq;
 	for (queue = 0; queue < port->num_tx_queues; queue++) {
 		struct mv_pp2x_tx_queue *txq = port->txqs[queue];
 
@@ -662,9 +767,13 @@ static int mv_pp2x_ethtool_set_coalesce(struct net_device *dev,
 	}
 	if (port->priv->pp2xdata->interrupt_tx_done) {
 		mv_pp2x_tx_done_time_coal_set(port, port->tx_time_coal);
-		on_each_cpu(mv_pp2x_tx_done_pkts_coal_set, port, 1);
+		if (!c->use_adaptive_tx_coalesce)
+			on_each_cpu(mv_pp2x_tx_done_pkts_coal_set, port, 1);
 	}
 
+	mv_pp2x_dim_set(port, c->use_adaptive_rx_coalesce,
+			c->use_adaptive_tx_coalesce);
+
 	return 0;
 }
 
@@ -678,6 +787,10 @@ static int mv_pp2x_ethtool_get_coalesce(struct net_device *dev,
 	c->rx_max_coalesced_frames  = port->rxqs[0]->pkts_coal;
 	c->tx_max_coalesced_frames  = port->txqs[0]->pkts_coal;
 	c->tx_coalesce_usecs        = port->tx_time_coal;
+	c->tx_max_coalesced_frames_irq = port->tx_db_frames;
+	c->tx_coalesce_usecs_irq    = port->tx_db_usecs;
+	c->use_adaptive_rx_coalesce = !!(port->flags & MVPP2_F_DIM_RX);
+	c->use_adaptive_tx_coalesce = !!(port->flags & MVPP2_F_DIM_TX);
 
 	return 0;
 }
@@ -772,28 +885,262 @@ static u32 mv_pp2x_ethtool_get_rxfh_indir_size(struct net_device *dev)
 	return ARRAY_SIZE(port->priv->rx_indir_table);
 }
 
+/* ethtool RXH_* hash fields and their MVPP2_RSS_HEK_* bits */
+static const u32 mv_pp2x_rxh_hek[][2] = {
+	{ RXH_L2DA,	MVPP2_RSS_HEK_MAC_DA },
+	{ RXH_VLAN,	MVPP2_RSS_HEK_VLAN },
+	{ RXH_L3_PROTO,	MVPP2_RSS_HEK_L3_PROTO },
+	{ RXH_IP_SRC,	MVPP2_RSS_HEK_IP_SA },
+	{ RXH_IP_DST,	MVPP2_RSS_HEK_IP_DA },
+	{ RXH_L4_B_0_1,	MVPP2_RSS_HEK_L4_SP },
+	{ RXH_L4_B_2_3,	MVPP2_RSS_HEK_L4_DP },
+};
+
+static int mv_pp2x_rss_flow_type(u32 flow_type)
+{
+	switch (flow_type) {
+	case TCP_V4_FLOW:
+		return MVPP2_RSS_FLOW_TCP4;
+	case UDP_V4_FLOW:
+		return MVPP2_RSS_FLOW_UDP4;
+	case IPV4_FLOW:
+		return MVPP2_RSS_FLOW_IP4;
+	case TCP_V6_FLOW:
+		return MVPP2_RSS_FLOW_TCP6;
+	case UDP_V6_FLOW:
+		return MVPP2_RSS_FLOW_UDP6;
+	case IPV6_FLOW:
+		return MVPP2_RSS_FLOW_IP6;
+	default:
+		return -1;
+	}
+}
+
 static int mv_pp2x_get_rss_hash_opts(struct mv_pp2x_port *port,
 				     struct ethtool_rxnfc *nfc)
 {
-	switch (nfc->flow_type) {
+	int flow = mv_pp2x_rss_flow_type(nfc->flow_type);
+	int i;
+
+	if (flow < 0)
+		return -EOPNOTSUPP;
+
+	nfc->data = 0;
+	for (i = 0; i < ARRAY_SIZE(mv_pp2x_rxh_hek); i++)
+		if (port->rss_cfg.hash_opts[flow] & mv_pp2x_rxh_hek[i][1])
+			nfc->data |= mv_pp2x_rxh_hek[i][0];
+
+	return 0;
+}
+
+static u64 mv_pp2x_ntuple_mac_to_u64(const u8 *addr)
+{
+	u64 val = 0;
+	int i;
+
+	for (i = 0; i < ETH_ALEN; i++)
+		val = (val << 8) | addr[i];
+
+	return val;
+}
+
+/* Translate ethtool flow spec to classifier ntuple rule */
+static int mv_pp2x_ntuple_rule_build(struct mv_pp2x_port *port,
+				     struct ethtool_rx_flow_spec *fs,
+				     u32 rss_context,
+				     struct mv_pp2x_cls_ntuple *rule)
+{
+	u32 flow_type = fs->flow_type & ~FLOW_EXT;
+	struct ethtool_tcpip4_spec *l4, *l4_m;
+	struct ethtool_usrip4_spec *ip, *ip_m;
+	struct ethhdr *eth, *eth_m;
+	u64 da = 0, da_m = 0;
+	u32 sip = 0, sip_m = 0, dip = 0, dip_m = 0;
+	u16 vid = 0, vid_m = 0, proto = 0, proto_m = 0;
+	u16 sport = 0, sport_m = 0, dport = 0, dport_m = 0;
+	u8 l3 = 0, l3_m = 0;
+	int hek_offs = 0, ret = 0;
+
+	memset(rule, 0, sizeof(struct mv_pp2x_cls_ntuple));
+
+	if (rss_context) {
+		/* The context table gives the whole RXQ, ring_cookie is unused */
+		if (fs->ring_cookie == RX_CLS_FLOW_DISC ||
+		    !mv_pp22_rss_ctx_owned(port, rss_context))
+			return -EINVAL;
+		rule->rss = true;
+		rule->rxq = mv_pp22_rss_ctx_rxq(port, rss_context);
+	} else if (fs->ring_cookie == RX_CLS_FLOW_DISC)
+		rule->drop = true;
+	else if (fs->ring_cookie < port->num_rx_queues)
+		rule->rxq = port->rxqs[fs->ring_cookie]->id;
+	else
+		return -EINVAL;
+
+	if (fs->flow_type & FLOW_MAC_EXT)
+		return -EOPNOTSUPP;
+
+	switch (flow_type) {
 	case TCP_V4_FLOW:
-	case TCP_V6_FLOW:
-		nfc->data |= RXH_IP_SRC | RXH_IP_DST;
-		nfc->data |= RXH_L4_B_0_1 | RXH_L4_B_2_3;
-		break;
 	case UDP_V4_FLOW:
-	case UDP_V6_FLOW:
-		nfc->data |= RXH_IP_SRC | RXH_IP_DST;
-		if (port->rss_cfg.rss_mode == MVPP2_RSS_NF_UDP_5T)
-			nfc->data |= RXH_L4_B_0_1 | RXH_L4_B_2_3;
+		l4 = &fs->h_u.tcp_ip4_spec;
+		l4_m = &fs->m_u.tcp_ip4_spec;
+		if (l4_m->tos)
+			return -EOPNOTSUPP;
+		sip = ntohl(l4->ip4src);
+		sip_m = ntohl(l4_m->ip4src);
+		dip = ntohl(l4->ip4dst);
+		dip_m = ntohl(l4_m->ip4dst);
+		sport = ntohs(l4->psrc);
+		sport_m = ntohs(l4_m->psrc);
+		dport = ntohs(l4->pdst);
+		dport_m = ntohs(l4_m->pdst);
+		rule->flow_attr = MVPP2_PRS_FL_ATTR_IP4_BIT |
+			(flow_type == TCP_V4_FLOW ?
+			 MVPP2_PRS_FL_ATTR_TCP_BIT : MVPP2_PRS_FL_ATTR_UDP_BIT);
+		rule->flow_attr_mask = MVPP2_PRS_FL_ATTR_IP4_BIT |
+			MVPP2_PRS_FL_ATTR_TCP_BIT | MVPP2_PRS_FL_ATTR_UDP_BIT;
+		/* Fragments carry no L4 header past the first one */
+		if (sport_m || dport_m)
+			rule->flow_attr_mask |= MVPP2_PRS_FL_ATTR_FRAG_BIT;
 		break;
-	case IPV4_FLOW:
-	case IPV6_FLOW:
-		nfc->data |= RXH_IP_SRC | RXH_IP_DST;
+	case IPV4_USER_FLOW:
+		ip = &fs->h_u.usr_ip4_spec;
+		ip_m = &fs->m_u.usr_ip4_spec;
+		if (ip_m->l4_4_bytes || ip_m->tos || ip_m->ip_ver)
+			return -EOPNOTSUPP;
+		sip = ntohl(ip->ip4src);
+		sip_m = ntohl(ip_m->ip4src);
+		dip = ntohl(ip->ip4dst);
+		dip_m = ntohl(ip_m->ip4dst);
+		l3 = ip->proto;
+		l3_m = ip_m->proto;
+		rule->flow_attr = MVPP2_PRS_FL_ATTR_IP4_BIT;
+		rule->flow_attr_mask = MVPP2_PRS_FL_ATTR_IP4_BIT;
+		break;
+	case ETHER_FLOW:
+		eth = &fs->h_u.ether_spec;
+		eth_m = &fs->m_u.ether_spec;
+		if (!is_zero_ether_addr(eth_m->h_source))
+			return -EOPNOTSUPP;
+		da = mv_pp2x_ntuple_mac_to_u64(eth->h_dest);
+		da_m = mv_pp2x_ntuple_mac_to_u64(eth_m->h_dest);
+		proto = ntohs(eth->h_proto);
+		proto_m = ntohs(eth_m->h_proto);
 		break;
 	default:
 		return -EOPNOTSUPP;
 	}
+
+	if (fs->flow_type & FLOW_EXT) {
+		if (fs->m_ext.vlan_etype || fs->m_ext.data[0] ||
+		    fs->m_ext.data[1])
+			return -EOPNOTSUPP;
+		vid = ntohs(fs->h_ext.vlan_tci) & VLAN_VID_MASK;
+		vid_m = ntohs(fs->m_ext.vlan_tci);
+		/* Only the VLAN ID is extracted */
+		if (vid_m & ~VLAN_VID_MASK)
+			return -EOPNOTSUPP;
+		if (vid_m) {
+			rule->flow_attr |= MVPP2_PRS_FL_ATTR_VLAN_BIT;
+			rule->flow_attr_mask |= MVPP2_PRS_FL_ATTR_VLAN_BIT;
+		}
+	}
+
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_MAC_DA,
+					    da, da_m, ETH_ALEN);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_VLAN,
+					    vid, vid_m, 2);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_ETH_TYPE,
+					    proto, proto_m, 2);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_L3_PROTO,
+					    l3, l3_m, 1);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_IP4SA,
+					    sip, sip_m, 4);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_IP4DA,
+					    dip, dip_m, 4);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_L4SIP,
+					    sport, sport_m, 2);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_L4DIP,
+					    dport, dport_m, 2);
+
+	return ret ? -EOPNOTSUPP : 0;
+}
+
+static int mv_pp2x_ethtool_cls_rule_ins(struct mv_pp2x_port *port,
+					struct ethtool_rx_flow_spec *fs,
+					u32 rss_context)
+{
+	struct mv_pp2x_ntuple_rule *ntuple;
+	struct mv_pp2x_cls_ntuple rule;
+	int ret;
+
+	if (fs->location >= MVPP2_CLS_NTUPLE_RULES)
+		return -EINVAL;
+#ifdef MVPP2_TC_FLOWER
+	/* The lookup of the location is in use by tc flower filters */
+	if (port->tc_flower_lkp_ref[fs->location])
+		return -EBUSY;
+#endif
+
+	ret = mv_pp2x_ntuple_rule_build(port, fs, rss_context, &rule);
+	if (ret) {
+		netdev_err(port->dev, "unsupported classification rule\n");
+		return ret;
+	}
+
+	ntuple = &port->ntuple_rules[fs->location];
+	ntuple->valid = false;
+	ret = mv_pp2x_cls_ntuple_set(port, fs->location, &rule);
+	if (ret)
+		return ret;
+
+	ntuple->fs = *fs;
+	ntuple->rss_context = rule.rss ? rss_context : 0;
+	ntuple->hits_base = mv_pp2x_cls_ntuple_hits_get(port, fs->location);
+	ntuple->valid = true;
+
+	return 0;
+}
+
+/* Spread the flows of ntuple rule loc over the CPUs of RSS context ctx, ctx 0
+ * steers them back to the rule queue. Called under rtnl lock, like the
+ * ethtool rule changes.
+ */
+int mv_pp2x_ntuple_rss_ctx_set(struct mv_pp2x_port *port, u32 loc, u32 ctx)
+{
+	struct ethtool_rx_flow_spec fs;
+
+	if (loc >= MVPP2_CLS_NTUPLE_RULES || !port->ntuple_rules[loc].valid)
+		return -ENOENT;
+
+	fs = port->ntuple_rules[loc].fs;
+
+	return mv_pp2x_ethtool_cls_rule_ins(port, &fs, ctx);
+}
+EXPORT_SYMBOL(mv_pp2x_ntuple_rss_ctx_set);
+
+static int mv_pp2x_ethtool_cls_rule_del(struct mv_pp2x_port *port, u32 loc)
+{
+	int ret;
+
+	if (loc >= MVPP2_CLS_NTUPLE_RULES || !port->ntuple_rules[loc].valid)
+		return -ENOENT;
+
+	ret = mv_pp2x_cls_ntuple_del(port, loc);
+	if (ret)
+		return ret;
+
+	port->ntuple_rules[loc].valid = false;
+
 	return 0;
 }
 
@@ -803,6 +1150,7 @@ static int mv_pp2x_ethtool_get_rxnfc(struct net_device *dev,
 {
 	struct mv_pp2x_port *port = netdev_priv(dev);
 	int ret = -EOPNOTSUPP;
+	int i, j;
 
 	if (port->priv->pp2_version == PPV21)
 		return -EOPNOTSUPP;
@@ -821,6 +1169,34 @@ static int mv_pp2x_ethtool_get_rxnfc(struct net_device *dev,
 	case ETHTOOL_GRXFH:
 			ret = mv_pp2x_get_rss_hash_opts(port, cmd);
 			break;
+	case ETHTOOL_GRXCLSRLCNT:
+			cmd->rule_cnt = 0;
+			for (i = 0; i < MVPP2_CLS_NTUPLE_RULES; i++)
+				if (port->ntuple_rules[i].valid)
+					cmd->rule_cnt++;
+			cmd->data = MVPP2_CLS_NTUPLE_RULES;
+			ret = 0;
+			break;
+	case ETHTOOL_GRXCLSRULE:
+			if (cmd->fs.location >= MVPP2_CLS_NTUPLE_RULES ||
+			    !port->ntuple_rules[cmd->fs.location].valid)
+				return -ENOENT;
+			cmd->fs = port->ntuple_rules[cmd->fs.location].fs;
+			ret = 0;
+			break;
+	case ETHTOOL_GRXCLSRLALL:
+			j = 0;
+			for (i = 0; i < MVPP2_CLS_NTUPLE_RULES; i++) {
+				if (!port->ntuple_rules[i].valid)
+					continue;
+				if (j == cmd->rule_cnt)
+					return -EMSGSIZE;
+				rules[j++] = i;
+			}
+			cmd->rule_cnt = j;
+			cmd->data = MVPP2_CLS_NTUPLE_RULES;
+			ret = 0;
+			break;
 	default:
 			break;
 	}
@@ -831,39 +1207,29 @@ static int mv_pp2x_ethtool_get_rxnfc(struct net_device *dev,
 static int mv_pp2x_set_rss_hash_opt(struct mv_pp2x_port *port,
 				    struct ethtool_rxnfc *nfc)
 {
-	if (nfc->data & ~(RXH_IP_SRC | RXH_IP_DST |
-			  RXH_L4_B_0_1 | RXH_L4_B_2_3))
+	int flow = mv_pp2x_rss_flow_type(nfc->flow_type);
+	u64 rxh = nfc->data;
+	u32 hek_opts = 0;
+	int i;
+
+	if (flow < 0)
 		return -EINVAL;
 
-	switch (nfc->flow_type) {
-	case TCP_V4_FLOW:
-	case TCP_V6_FLOW:
-		if (!(nfc->data & RXH_IP_SRC) ||
-		    !(nfc->data & RXH_IP_DST) ||
-		    !(nfc->data & RXH_L4_B_0_1) ||
-		    !(nfc->data & RXH_L4_B_2_3))
-			return -EINVAL;
-		break;
-	case UDP_V4_FLOW:
-	case UDP_V6_FLOW:
-		if (!(nfc->data & RXH_IP_SRC) ||
-		    !(nfc->data & RXH_IP_DST))
-			return -EINVAL;
-		switch (nfc->data & (RXH_L4_B_0_1 | RXH_L4_B_2_3)) {
-		case 0:
-			mv_pp22_rss_mode_set(port, MVPP2_RSS_NF_UDP_2T);
-			break;
-		case (RXH_L4_B_0_1 | RXH_L4_B_2_3):
-			mv_pp22_rss_mode_set(port, MVPP2_RSS_NF_UDP_5T);
-			break;
-		default:
-			return -EINVAL;
+	for (i = 0; i < ARRAY_SIZE(mv_pp2x_rxh_hek); i++) {
+		if (rxh & mv_pp2x_rxh_hek[i][0]) {
+			hek_opts |= mv_pp2x_rxh_hek[i][1];
+			rxh &= ~(u64)mv_pp2x_rxh_hek[i][0];
 		}
-		break;
-	default:
-		return -EINVAL;
 	}
-	return 0;
+	if (rxh)
+		return -EINVAL;
+
+	/* Fragments and non-TCP/UDP packets have no L4 ports */
+	if ((flow == MVPP2_RSS_FLOW_IP4 || flow == MVPP2_RSS_FLOW_IP6) &&
+	    (hek_opts & (MVPP2_RSS_HEK_L4_SP | MVPP2_RSS_HEK_L4_DP)))
+		return -EINVAL;
+
+	return mv_pp22_rss_hash_opts_set(port, flow, hek_opts);
 }
 
 static int mv_pp2x_ethtool_set_rxnfc(struct net_device *dev, struct ethtool_rxnfc *cmd)
@@ -882,6 +1248,12 @@ static int mv_pp2x_ethtool_set_rxnfc(struct net_device *dev, struct ethtool_rxnf
 	case ETHTOOL_SRXFH:
 		ret =  mv_pp2x_set_rss_hash_opt(port, cmd);
 		break;
+	case ETHTOOL_SRXCLSRLINS:
+		ret = mv_pp2x_ethtool_cls_rule_ins(port, &cmd->fs, 0);
+		break;
+	case ETHTOOL_SRXCLSRLDEL:
+		ret = mv_pp2x_ethtool_cls_rule_del(port, cmd->fs.location);
+		break;
 	default:
 		break;
 	}
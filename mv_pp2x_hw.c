@@ -21,6 +21,7 @@
 #include <linux/etherdevice.h>
 #include <linux/platform_device.h>
 #include <linux/inetdevice.h>
+#include <linux/jhash.h>
 #include <uapi/linux/ppp_defs.h>
 
 #include <net/ip.h>
@@ -400,6 +401,73 @@ static struct mv_pp2x_prs_flow_id
 /* Array of bitmask to indicate flow id attribute */
 static int mv_pp2x_prs_flow_id_attr_tbl[MVPP2_PRS_FL_LAST];
 
+/* Parser shadow index key */
+static u32 mv_pp2x_prs_key(int lu, const u8 *data, int len)
+{
+	return jhash(data, len, lu);
+}
+
+/* Get shadow index key from the match data of tcam sw entry.
+ * Only lookups searched in runtime are indexed.
+ */
+static bool mv_pp2x_prs_entry_key(struct mv_pp2x_prs_entry *pe, u32 *key)
+{
+	u8 data[ETH_ALEN];
+	int lu, i, len;
+
+	lu = pe->tcam.byte[HW_BYTE_OFFS(MVPP2_PRS_TCAM_LU_BYTE)] &
+	     MVPP2_PRS_LU_MASK;
+
+	switch (lu) {
+	case MVPP2_PRS_LU_MAC:
+		/* MAC DA under its mask */
+		len = ETH_ALEN;
+		for (i = 0; i < len; i++)
+			data[i] = pe->tcam.byte[TCAM_DATA_BYTE(i)] &
+				  pe->tcam.byte[TCAM_DATA_MASK(i)];
+		break;
+	case MVPP2_PRS_LU_VLAN:
+		/* First TPID */
+		len = 2;
+		for (i = 0; i < len; i++)
+			data[i] = pe->tcam.byte[TCAM_DATA_BYTE(i)];
+		break;
+	case MVPP2_PRS_LU_VID:
+		/* 12 bits VID */
+		len = 2;
+		data[0] = pe->tcam.byte[TCAM_DATA_BYTE(2)] &
+			  MVPP2_PRS_VID_H_WORD_MASK;
+		data[1] = pe->tcam.byte[TCAM_DATA_BYTE(3)];
+		break;
+	case MVPP2_PRS_LU_FLOWS:
+		/* Result info dword */
+		len = 4;
+		for (i = 0; i < len; i++)
+			data[i] = pe->tcam.byte[TCAM_DATA_BYTE(i)];
+		break;
+	default:
+		return false;
+	}
+
+	*key = mv_pp2x_prs_key(lu, data, len);
+
+	return true;
+}
+
+/* Update SW mirror and index of parser entry */
+static void mv_pp2x_prs_shadow_entry_set(struct mv_pp2x_hw *hw,
+					 struct mv_pp2x_prs_entry *pe)
+{
+	struct mv_pp2x_prs_shadow *shadow = &hw->prs_shadow[pe->index];
+	u32 key;
+
+	hash_del(&shadow->node);
+	memcpy(&shadow->entry, pe, sizeof(struct mv_pp2x_prs_entry));
+
+	if (mv_pp2x_prs_entry_key(pe, &key))
+		hash_add(hw->prs_hash, &shadow->node, key);
+}
+
 /* Update parser tcam and sram hw entries */
 int mv_pp2x_prs_hw_write(struct mv_pp2x_hw *hw, struct mv_pp2x_prs_entry *pe)
 {
@@ -411,15 +479,19 @@ int mv_pp2x_prs_hw_write(struct mv_pp2x_hw *hw, struct mv_pp2x_prs_entry *pe)
 	/* Clear entry invalidation bit */
 	pe->tcam.word[MVPP2_PRS_TCAM_INV_WORD] &= ~MVPP2_PRS_TCAM_INV_MASK;
 
-	/* Write tcam index - indirect access */
+	/* Write sram index - indirect access.
+	 * Sram goes first, so a new tcam entry never hits a stale result.
+	 */
+	mv_pp2x_write(hw, MVPP2_PRS_SRAM_IDX_REG, pe->index);
+	for (i = 0; i < MVPP2_PRS_SRAM_WORDS; i++)
+		mv_pp2x_write(hw, MVPP2_PRS_SRAM_DATA_REG(i), pe->sram.word[i]);
+
+	/* Write tcam index - indirect access, invalidation word is last */
 	mv_pp2x_write(hw, MVPP2_PRS_TCAM_IDX_REG, pe->index);
 	for (i = 0; i < MVPP2_PRS_TCAM_WORDS; i++)
 		mv_pp2x_write(hw, MVPP2_PRS_TCAM_DATA_REG(i), pe->tcam.word[i]);
 
-	/* Write sram index - indirect access */
-	mv_pp2x_write(hw, MVPP2_PRS_SRAM_IDX_REG, pe->index);
-	for (i = 0; i < MVPP2_PRS_SRAM_WORDS; i++)
-		mv_pp2x_write(hw, MVPP2_PRS_SRAM_DATA_REG(i), pe->sram.word[i]);
+	mv_pp2x_prs_shadow_entry_set(hw, pe);
 
 	return 0;
 }
@@ -453,6 +525,21 @@ int mv_pp2x_prs_hw_read(struct mv_pp2x_hw *hw, struct mv_pp2x_prs_entry *pe)
 }
 EXPORT_SYMBOL(mv_pp2x_prs_hw_read);
 
+/* Read tcam entry from SW mirror, no hw access */
+static int mv_pp2x_prs_sw_read(struct mv_pp2x_hw *hw,
+			       struct mv_pp2x_prs_entry *pe)
+{
+	if (pe->index > MVPP2_PRS_TCAM_SRAM_SIZE - 1)
+		return -EINVAL;
+
+	memcpy(pe, &hw->prs_shadow[pe->index].entry,
+	       sizeof(struct mv_pp2x_prs_entry));
+	if (pe->tcam.word[MVPP2_PRS_TCAM_INV_WORD] & MVPP2_PRS_TCAM_INV_MASK)
+		return MVPP2_PRS_TCAM_ENTRY_INVALID;
+
+	return 0;
+}
+
 void mv_pp2x_prs_sw_clear(struct mv_pp2x_prs_entry *pe)
 {
 	memset(pe, 0, sizeof(struct mv_pp2x_prs_entry));
@@ -466,6 +553,12 @@ void mv_pp2x_prs_hw_inv(struct mv_pp2x_hw *hw, int index)
 	mv_pp2x_write(hw, MVPP2_PRS_TCAM_IDX_REG, index);
 	mv_pp2x_write(hw, MVPP2_PRS_TCAM_DATA_REG(MVPP2_PRS_TCAM_INV_WORD),
 		      MVPP2_PRS_TCAM_INV_MASK);
+
+	/* Update SW mirror */
+	hash_del(&hw->prs_shadow[index].node);
+	hw->prs_shadow[index].entry.index = index;
+	hw->prs_shadow[index].entry.tcam.word[MVPP2_PRS_TCAM_INV_WORD] =
+		MVPP2_PRS_TCAM_INV_MASK;
 }
 EXPORT_SYMBOL(mv_pp2x_prs_hw_inv);
 
@@ -474,6 +567,14 @@ static void mv_pp2x_prs_shadow_set(struct mv_pp2x_hw *hw, int index, int lu)
 {
 	hw->prs_shadow[index].valid = true;
 	hw->prs_shadow[index].lu = lu;
+	set_bit(index, hw->prs_used);
+}
+
+/* Disable shadow table entry and release its tcam index */
+static void mv_pp2x_prs_shadow_clear(struct mv_pp2x_hw *hw, int index)
+{
+	hw->prs_shadow[index].valid = false;
+	clear_bit(index, hw->prs_used);
 }
 
 /* Update ri fields in shadow table entry */
@@ -825,25 +926,30 @@ static struct mv_pp2x_prs_entry *mv_pp2x_prs_flow_find(struct mv_pp2x_hw *hw,
 						       unsigned int ri,
 						       unsigned int ri_mask)
 {
+	struct mv_pp2x_prs_shadow *shadow;
 	struct mv_pp2x_prs_entry *pe;
-	int tid;
 	unsigned int dword, enable;
+	u8 data[4];
+	u32 key;
+	int i;
 
 	pe = kzalloc(sizeof(*pe), GFP_KERNEL);
 	if (!pe)
 		return NULL;
-	mv_pp2x_prs_tcam_lu_set(pe, MVPP2_PRS_LU_FLOWS);
 
-	/* Go through the all entires with MVPP2_PRS_LU_FLOWS */
-	for (tid = MVPP2_PRS_TCAM_SRAM_SIZE - 1; tid >= 0; tid--) {
+	for (i = 0; i < 4; i++)
+		data[i] = ((u8 *)&ri)[HW_BYTE_OFFS(i)];
+	key = mv_pp2x_prs_key(MVPP2_PRS_LU_FLOWS, data, 4);
+
+	/* Go through the indexed entries with MVPP2_PRS_LU_FLOWS */
+	hash_for_each_possible(hw->prs_hash, shadow, node, key) {
 		u8 bits;
 
-		if (!hw->prs_shadow[tid].valid ||
-		    hw->prs_shadow[tid].lu != MVPP2_PRS_LU_FLOWS)
+		if (!shadow->valid || shadow->lu != MVPP2_PRS_LU_FLOWS)
 			continue;
 
-		pe->index = tid;
-		mv_pp2x_prs_hw_read(hw, pe);
+		pe->index = shadow - hw->prs_shadow;
+		mv_pp2x_prs_sw_read(hw, pe);
 
 		/* Check result info, because there maybe several
 		 * TCAM lines to generate the same flow
@@ -863,6 +969,99 @@ static struct mv_pp2x_prs_entry *mv_pp2x_prs_flow_find(struct mv_pp2x_hw *hw,
 	return NULL;
 }
 
+/* Parser tcam regions of dynamic entries */
+static const struct mv_pp2x_prs_region
+mv_pp2x_prs_regions[MVPP2_PRS_REGION_LAST] = {
+	[MVPP2_PRS_REGION_FREE] = {
+		.name = "free", .start = MVPP2_PE_FIRST_FREE_TID,
+		.end = MVPP2_PE_LAST_FREE_TID },
+	[MVPP2_PRS_REGION_MAC] = {
+		.name = "mac", .start = MVPP2_PE_MAC_RANGE_START,
+		.end = MVPP2_PE_MAC_RANGE_END },
+	[MVPP2_PRS_REGION_VID] = {
+		.name = "vid", .start = MVPP2_PE_VID_FILT_RANGE_START,
+		.end = MVPP2_PE_VID_FILT_RANGE_END },
+};
+
+/* Check that moving tcam entry does not change its priority, i.e. no
+ * entry of the same lookup ID lies between the old and the new index.
+ */
+static bool mv_pp2x_prs_tcam_move_allowed(struct mv_pp2x_hw *hw,
+					  int from, int to)
+{
+	int lu = hw->prs_shadow[from].lu;
+	int tid, first, last;
+
+	first = min(from, to) + 1;
+	last = max(from, to);
+
+	for (tid = find_next_bit(hw->prs_used, last, first); tid < last;
+	     tid = find_next_bit(hw->prs_used, last, tid + 1)) {
+		if (hw->prs_shadow[tid].lu == lu)
+			return false;
+	}
+
+	return true;
+}
+
+/* Move valid tcam entry to free index. The copy is written before the
+ * original is invalidated, and both match with the same result, so
+ * there is no window in which traffic is misparsed.
+ */
+static void mv_pp2x_prs_tcam_move(struct mv_pp2x_hw *hw, int from, int to)
+{
+	struct mv_pp2x_prs_shadow *src = &hw->prs_shadow[from];
+	struct mv_pp2x_prs_shadow *dst = &hw->prs_shadow[to];
+	struct mv_pp2x_prs_entry pe;
+
+	pe.index = from;
+	mv_pp2x_prs_sw_read(hw, &pe);
+	pe.index = to;
+	mv_pp2x_prs_hw_write(hw, &pe);
+
+	dst->finish = src->finish;
+	dst->udf = src->udf;
+	dst->ri = src->ri;
+	dst->ri_mask = src->ri_mask;
+	mv_pp2x_prs_shadow_set(hw, to, src->lu);
+
+	mv_pp2x_prs_hw_inv(hw, from);
+	mv_pp2x_prs_shadow_clear(hw, from);
+
+	hw->prs_moves++;
+}
+
+/* Free a tcam index in [start, end] by moving one of its entries to a
+ * free index elsewhere in the free region.
+ */
+static int mv_pp2x_prs_tcam_compact(struct mv_pp2x_hw *hw, int start, int end)
+{
+	const struct mv_pp2x_prs_region *region =
+		&mv_pp2x_prs_regions[MVPP2_PRS_REGION_FREE];
+	int tid, to;
+
+	if (start < region->start || end > region->end)
+		return -ENOSPC;
+
+	for (tid = start; tid <= end; tid++) {
+		for (to = find_next_zero_bit(hw->prs_used, region->end + 1,
+					     region->start);
+		     to <= region->end;
+		     to = find_next_zero_bit(hw->prs_used, region->end + 1,
+					     to + 1)) {
+			if (to >= start && to <= end)
+				continue;
+
+			if (mv_pp2x_prs_tcam_move_allowed(hw, tid, to)) {
+				mv_pp2x_prs_tcam_move(hw, tid, to);
+				return tid;
+			}
+		}
+	}
+
+	return -ENOSPC;
+}
+
 /* Return first free tcam index, seeking from start to end */
 static int mv_pp2x_prs_tcam_first_free(struct mv_pp2x_hw *hw,
 				       unsigned char start,
@@ -876,14 +1075,51 @@ static int mv_pp2x_prs_tcam_first_free(struct mv_pp2x_hw *hw,
 	if (end >= MVPP2_PRS_TCAM_SRAM_SIZE)
 		end = MVPP2_PRS_TCAM_SRAM_SIZE - 1;
 
-	for (tid = start; tid <= end; tid++) {
-		if (!hw->prs_shadow[tid].valid)
-			return tid;
-	}
+	tid = find_next_zero_bit(hw->prs_used, end + 1, start);
+	if (tid <= end)
+		return tid;
+
+	/* Range is full, try to make room in it */
+	tid = mv_pp2x_prs_tcam_compact(hw, start, end);
+	if (tid >= 0)
+		return tid;
+
 	pr_err("Out of TCAM Entries !!: %s(%d)\n", __FILENAME__, __LINE__);
 	return -EINVAL;
 }
 
+/* Get occupancy and fragmentation of parser tcam region */
+int mv_pp2x_prs_region_stats_get(struct mv_pp2x_hw *hw, int region_id,
+				 struct mv_pp2x_prs_region_stats *stats)
+{
+	const struct mv_pp2x_prs_region *region;
+	int tid, next;
+
+	if (region_id < 0 || region_id >= MVPP2_PRS_REGION_LAST)
+		return -EINVAL;
+
+	region = &mv_pp2x_prs_regions[region_id];
+	memset(stats, 0, sizeof(*stats));
+	stats->name = region->name;
+	stats->start = region->start;
+	stats->end = region->end;
+
+	for (tid = find_next_zero_bit(hw->prs_used, region->end + 1,
+				      region->start);
+	     tid <= region->end;
+	     tid = find_next_zero_bit(hw->prs_used, region->end + 1, next)) {
+		next = find_next_bit(hw->prs_used, region->end + 1, tid);
+		stats->free += next - tid;
+		stats->free_runs++;
+		stats->largest_free_run = max(stats->largest_free_run,
+					      next - tid);
+	}
+	stats->used = region->end - region->start + 1 - stats->free;
+
+	return 0;
+}
+EXPORT_SYMBOL(mv_pp2x_prs_region_stats_get);
+
 /* Enable/disable dropping all mac da's */
 static void mv_pp2x_prs_mac_drop_all_set(struct mv_pp2x_hw *hw,
 					 int port, bool add)
@@ -893,7 +1129,7 @@ static void mv_pp2x_prs_mac_drop_all_set(struct mv_pp2x_hw *hw,
 	if (hw->prs_shadow[MVPP2_PE_DROP_ALL].valid) {
 		/* Entry exist - update port only */
 		pe.index = MVPP2_PE_DROP_ALL;
-		mv_pp2x_prs_hw_read(hw, &pe);
+		mv_pp2x_prs_sw_read(hw, &pe);
 	} else {
 		/* Entry doesn't exist - create new */
 		memset(&pe, 0, sizeof(struct mv_pp2x_prs_entry));
@@ -930,7 +1166,7 @@ void mv_pp2x_prs_mac_promisc_set(struct mv_pp2x_hw *hw, int port, bool add)
 	if (hw->prs_shadow[MVPP2_PE_MAC_PROMISCUOUS].valid) {
 		/* Entry exist - update port only */
 		pe.index = MVPP2_PE_MAC_PROMISCUOUS;
-		mv_pp2x_prs_hw_read(hw, &pe);
+		mv_pp2x_prs_sw_read(hw, &pe);
 	} else {
 		/* Entry doesn't exist - create new */
 		memset(&pe, 0, sizeof(struct mv_pp2x_prs_entry));
@@ -976,7 +1212,7 @@ void mv_pp2x_prs_mac_multi_set(struct mv_pp2x_hw *hw, int port, int index,
 	if (hw->prs_shadow[index].valid) {
 		/* Entry exist - update port only */
 		pe.index = index;
-		mv_pp2x_prs_hw_read(hw, &pe);
+		mv_pp2x_prs_sw_read(hw, &pe);
 	} else {
 		/* Entry doesn't exist - create new */
 		memset(&pe, 0, sizeof(struct mv_pp2x_prs_entry));
@@ -1028,7 +1264,7 @@ static void mv_pp2x_prs_dsa_tag_set(struct mv_pp2x_hw *hw, int port, bool add,
 	if (hw->prs_shadow[tid].valid) {
 		/* Entry exist - update port only */
 		pe.index = tid;
-		mv_pp2x_prs_hw_read(hw, &pe);
+		mv_pp2x_prs_sw_read(hw, &pe);
 	} else {
 		/* Entry doesn't exist - create new */
 		memset(&pe, 0, sizeof(struct mv_pp2x_prs_entry));
@@ -1092,7 +1328,7 @@ static void mv_pp2x_prs_dsa_tag_ethertype_set(struct mv_pp2x_hw *hw, int port,
 	if (hw->prs_shadow[tid].valid) {
 		/* Entry exist - update port only */
 		pe.index = tid;
-		mv_pp2x_prs_hw_read(hw, &pe);
+		mv_pp2x_prs_sw_read(hw, &pe);
 	} else {
 		/* Entry doesn't exist - create new */
 		memset(&pe, 0, sizeof(struct mv_pp2x_prs_entry));
@@ -1144,27 +1380,32 @@ static struct mv_pp2x_prs_entry *mv_pp2x_prs_vlan_find(struct mv_pp2x_hw *hw,
 						       unsigned short tpid,
 						       int ai)
 {
+	struct mv_pp2x_prs_shadow *shadow;
 	struct mv_pp2x_prs_entry *pe;
+	u8 data[2] = { tpid >> 8, tpid & 0xff };
+	u32 key;
 	int tid;
 
 	pe = kzalloc(sizeof(*pe), GFP_KERNEL);
 	if (!pe)
 		return NULL;
-	mv_pp2x_prs_tcam_lu_set(pe, MVPP2_PRS_LU_VLAN);
 
-	/* Go through the all entries with MVPP2_PRS_LU_VLAN */
-	for (tid = MVPP2_PE_FIRST_FREE_TID;
-	     tid <= MVPP2_PE_LAST_FREE_TID; tid++) {
+	key = mv_pp2x_prs_key(MVPP2_PRS_LU_VLAN, data, 2);
+
+	/* Go through the indexed entries with MVPP2_PRS_LU_VLAN */
+	hash_for_each_possible(hw->prs_hash, shadow, node, key) {
 		unsigned int ri_bits, ai_bits;
 		bool match;
 
-		if (!hw->prs_shadow[tid].valid ||
-		    hw->prs_shadow[tid].lu != MVPP2_PRS_LU_VLAN)
+		tid = shadow - hw->prs_shadow;
+		if (tid < MVPP2_PE_FIRST_FREE_TID ||
+		    tid > MVPP2_PE_LAST_FREE_TID ||
+		    !shadow->valid || shadow->lu != MVPP2_PRS_LU_VLAN)
 			continue;
 
 		pe->index = tid;
 
-		mv_pp2x_prs_hw_read(hw, pe);
+		mv_pp2x_prs_sw_read(hw, pe);
 		match = mv_pp2x_prs_tcam_data_cmp(pe, 0, swab16(tpid));
 		if (!match)
 			continue;
@@ -1201,12 +1442,6 @@ static int mv_pp2x_prs_vlan_add(struct mv_pp2x_hw *hw, unsigned short tpid,
 	pe = mv_pp2x_prs_vlan_find(hw, tpid, ai);
 
 	if (!pe) {
-		/* Create new tcam entry */
-		tid = mv_pp2x_prs_tcam_first_free(hw, MVPP2_PE_LAST_FREE_TID,
-						  MVPP2_PE_FIRST_FREE_TID);
-		if (tid < 0)
-			return tid;
-
 		pe = kzalloc(sizeof(*pe), GFP_KERNEL);
 		if (!pe)
 			return -ENOMEM;
@@ -1221,17 +1456,24 @@ static int mv_pp2x_prs_vlan_add(struct mv_pp2x_hw *hw, unsigned short tpid,
 				continue;
 
 			pe->index = tid_aux;
-			mv_pp2x_prs_hw_read(hw, pe);
+			mv_pp2x_prs_sw_read(hw, pe);
 			ri_bits = mv_pp2x_prs_sram_ri_get(pe);
 			if ((ri_bits & MVPP2_PRS_RI_VLAN_MASK) ==
 			    MVPP2_PRS_RI_VLAN_DOUBLE)
 				break;
 		}
 
-		if (tid <= tid_aux) {
+		/* Create new tcam entry after all double vlan entries */
+		if (tid_aux >= MVPP2_PE_LAST_FREE_TID) {
 			ret = -EINVAL;
 			goto error;
 		}
+		tid = mv_pp2x_prs_tcam_first_free(hw, tid_aux + 1,
+						  MVPP2_PE_LAST_FREE_TID);
+		if (tid < 0) {
+			ret = tid;
+			goto error;
+		}
 
 		memset(pe, 0, sizeof(struct mv_pp2x_prs_entry));
 		mv_pp2x_prs_tcam_lu_set(pe, MVPP2_PRS_LU_VLAN);
@@ -1286,26 +1528,31 @@ static int mv_pp2x_prs_double_vlan_ai_free_get(struct mv_pp2x_hw *hw)
 static struct mv_pp2x_prs_entry *mv_pp2x_prs_double_vlan_find(
 	struct mv_pp2x_hw *hw, unsigned short tpid1, unsigned short tpid2)
 {
+	struct mv_pp2x_prs_shadow *shadow;
 	struct mv_pp2x_prs_entry *pe;
+	u8 data[2] = { tpid1 >> 8, tpid1 & 0xff };
+	u32 key;
 	int tid;
 
 	pe = kzalloc(sizeof(*pe), GFP_KERNEL);
 	if (!pe)
 		return NULL;
-	mv_pp2x_prs_tcam_lu_set(pe, MVPP2_PRS_LU_VLAN);
 
-	/* Go through the all entries with MVPP2_PRS_LU_VLAN */
-	for (tid = MVPP2_PE_FIRST_FREE_TID;
-	     tid <= MVPP2_PE_LAST_FREE_TID; tid++) {
+	key = mv_pp2x_prs_key(MVPP2_PRS_LU_VLAN, data, 2);
+
+	/* Go through the indexed entries with MVPP2_PRS_LU_VLAN */
+	hash_for_each_possible(hw->prs_hash, shadow, node, key) {
 		unsigned int ri_mask;
 		bool match;
 
-		if (!hw->prs_shadow[tid].valid ||
-		    hw->prs_shadow[tid].lu != MVPP2_PRS_LU_VLAN)
+		tid = shadow - hw->prs_shadow;
+		if (tid < MVPP2_PE_FIRST_FREE_TID ||
+		    tid > MVPP2_PE_LAST_FREE_TID ||
+		    !shadow->valid || shadow->lu != MVPP2_PRS_LU_VLAN)
 			continue;
 
 		pe->index = tid;
-		mv_pp2x_prs_hw_read(hw, pe);
+		mv_pp2x_prs_sw_read(hw, pe);
 
 		match = mv_pp2x_prs_tcam_data_cmp(pe, 0, swab16(tpid1))	&&
 			mv_pp2x_prs_tcam_data_cmp(pe, 4, swab16(tpid2));
@@ -1334,12 +1581,6 @@ static int mv_pp2x_prs_double_vlan_add(struct mv_pp2x_hw *hw,
 	pe = mv_pp2x_prs_double_vlan_find(hw, tpid1, tpid2);
 
 	if (!pe) {
-		/* Create new tcam entry */
-		tid = mv_pp2x_prs_tcam_first_free(hw, MVPP2_PE_FIRST_FREE_TID,
-						  MVPP2_PE_LAST_FREE_TID);
-		if (tid < 0)
-			return tid;
-
 		pe = kzalloc(sizeof(*pe), GFP_KERNEL);
 		if (!pe)
 			return -ENOMEM;
@@ -1361,7 +1602,7 @@ static int mv_pp2x_prs_double_vlan_add(struct mv_pp2x_hw *hw,
 				continue;
 
 			pe->index = tid_aux;
-			mv_pp2x_prs_hw_read(hw, pe);
+			mv_pp2x_prs_sw_read(hw, pe);
 			ri_bits = mv_pp2x_prs_sram_ri_get(pe);
 			ri_bits &= MVPP2_PRS_RI_VLAN_MASK;
 			if (ri_bits == MVPP2_PRS_RI_VLAN_SINGLE ||
@@ -1369,10 +1610,17 @@ static int mv_pp2x_prs_double_vlan_add(struct mv_pp2x_hw *hw,
 				break;
 		}
 
-		if (tid >= tid_aux) {
+		/* Create new tcam entry before all single/triple vlan entries */
+		if (tid_aux <= MVPP2_PE_FIRST_FREE_TID) {
 			ret = -ERANGE;
 			goto error;
 		}
+		tid = mv_pp2x_prs_tcam_first_free(hw, MVPP2_PE_FIRST_FREE_TID,
+						  tid_aux - 1);
+		if (tid < 0) {
+			ret = tid;
+			goto error;
+		}
 
 		memset(pe, 0, sizeof(struct mv_pp2x_prs_entry));
 		mv_pp2x_prs_tcam_lu_set(pe, MVPP2_PRS_LU_VLAN);
@@ -2429,27 +2677,32 @@ static struct mv_pp2x_prs_entry *
 mv_pp2x_prs_mac_da_range_find(struct mv_pp2x_hw *hw, int pmap, const u8 *da,
 			      unsigned char *mask, int udf_type)
 {
+	struct mv_pp2x_prs_shadow *shadow;
 	struct mv_pp2x_prs_entry *pe;
+	u8 data[ETH_ALEN];
+	u32 key;
 	int tid;
 
 	pe = kzalloc(sizeof(*pe), GFP_KERNEL);
 	if (!pe)
 		return NULL;
-	mv_pp2x_prs_tcam_lu_set(pe, MVPP2_PRS_LU_MAC);
-
-	/* Go through the all entires with MVPP2_PRS_LU_MAC */
-	for (tid = MVPP2_PE_MAC_RANGE_START;
-	     tid <= MVPP2_PE_MAC_RANGE_END; tid++) {
-		unsigned int entry_pmap;
 
-		if (!hw->prs_shadow[tid].valid ||
-		    (hw->prs_shadow[tid].lu != MVPP2_PRS_LU_MAC) ||
-		    (hw->prs_shadow[tid].udf != udf_type))
+	for (tid = 0; tid < ETH_ALEN; tid++)
+		data[tid] = da[tid] & mask[tid];
+	key = mv_pp2x_prs_key(MVPP2_PRS_LU_MAC, data, ETH_ALEN);
+
+	/* Go through the indexed entries with MVPP2_PRS_LU_MAC */
+	hash_for_each_possible(hw->prs_hash, shadow, node, key) {
+		tid = shadow - hw->prs_shadow;
+		if (tid < MVPP2_PE_MAC_RANGE_START ||
+		    tid > MVPP2_PE_MAC_RANGE_END ||
+		    !shadow->valid ||
+		    (shadow->lu != MVPP2_PRS_LU_MAC) ||
+		    (shadow->udf != udf_type))
 			continue;
 
 		pe->index = tid;
-		mv_pp2x_prs_hw_read(hw, pe);
-		entry_pmap = mv_pp2x_prs_tcam_port_map_get(pe);
+		mv_pp2x_prs_sw_read(hw, pe);
 
 		if (mv_pp2x_prs_mac_range_equals(pe, da, mask))
 			return pe;
@@ -2504,7 +2757,7 @@ int mv_pp2x_prs_mac_da_accept(struct mv_pp2x_port *port, const u8 *da, bool add)
 			return -1;
 		}
 		mv_pp2x_prs_hw_inv(hw, pe->index);
-		hw->prs_shadow[pe->index].valid = false;
+		mv_pp2x_prs_shadow_clear(hw, pe->index);
 		kfree(pe);
 		return 0;
 	}
@@ -2628,7 +2881,7 @@ void mv_pp2x_prs_mac_entry_del(struct mv_pp2x_port *port,
 
 		/* Only simple mac entries */
 		pe.index = tid;
-		mv_pp2x_prs_hw_read(hw, &pe);
+		mv_pp2x_prs_sw_read(hw, &pe);
 
 		/* Read mac addr from entry */
 		for (index = 0; index < ETH_ALEN; index++)
@@ -2688,7 +2941,7 @@ static int mv_pp2x_prs_vid_drop_entry_accept(struct net_device *dev, unsigned in
 		/* Mask all ports */
 		mv_pp2x_prs_tcam_port_map_set(pe, 0);
 	} else {
-		mv_pp2x_prs_hw_read(hw, pe);
+		mv_pp2x_prs_sw_read(hw, pe);
 	}
 
 	/* Update port mask */
@@ -2702,7 +2955,7 @@ static int mv_pp2x_prs_vid_drop_entry_accept(struct net_device *dev, unsigned in
 			return -EPERM;
 		}
 		mv_pp2x_prs_hw_inv(hw, pe->index);
-		hw->prs_shadow[pe->index].valid = false;
+		mv_pp2x_prs_shadow_clear(hw, pe->index);
 		kfree(pe);
 		return 0;
 	}
@@ -2741,25 +2994,33 @@ static bool mv_pp2x_prs_tcam_vid_empty(struct mv_pp2x_hw *hw, unsigned char star
 static struct mv_pp2x_prs_entry *
 mv_pp2x_prs_vid_range_find(struct mv_pp2x_hw *hw, int pmap, u16 vid, u16 mask)
 {
+	struct mv_pp2x_prs_shadow *shadow;
 	struct mv_pp2x_prs_entry *pe;
 	unsigned char byte[2], enable[2];
+	u8 data[2];
 	u16 rvid, rmask;
+	u32 key;
 	int tid;
 
 	pe = kzalloc(sizeof(*pe), GFP_KERNEL);
 	if (!pe)
 		return NULL;
-	mv_pp2x_prs_tcam_lu_set(pe, MVPP2_PRS_LU_VID);
 
-	/* Go through the all entires with MVPP2_PRS_LU_VID */
-	for (tid = MVPP2_PE_VID_FILT_RANGE_START;
-	     tid <= MVPP2_PE_VID_FILT_RANGE_END; tid++) {
-		if (!hw->prs_shadow[tid].valid ||
-		    (hw->prs_shadow[tid].lu != MVPP2_PRS_LU_VID))
+	data[0] = (vid >> MVPP2_PRS_VID_H_WORD_SHIFT) &
+		  MVPP2_PRS_VID_H_WORD_MASK;
+	data[1] = vid & 0xff;
+	key = mv_pp2x_prs_key(MVPP2_PRS_LU_VID, data, 2);
+
+	/* Go through the indexed entries with MVPP2_PRS_LU_VID */
+	hash_for_each_possible(hw->prs_hash, shadow, node, key) {
+		tid = shadow - hw->prs_shadow;
+		if (tid < MVPP2_PE_VID_FILT_RANGE_START ||
+		    tid > MVPP2_PE_VID_FILT_RANGE_END ||
+		    !shadow->valid || (shadow->lu != MVPP2_PRS_LU_VID))
 			continue;
 
 		pe->index = tid;
-		mv_pp2x_prs_hw_read(hw, pe);
+		mv_pp2x_prs_sw_read(hw, pe);
 		mv_pp2x_prs_tcam_data_byte_get(pe, 2, &byte[0], &enable[0]);
 		mv_pp2x_prs_tcam_data_byte_get(pe, 3, &byte[1], &enable[1]);
 		rvid = ((byte[0] & MVPP2_PRS_VID_H_WORD_MASK) << MVPP2_PRS_VID_H_WORD_SHIFT) + byte[1];
@@ -2838,7 +3099,7 @@ int mv_pp2x_prs_vid_entry_accept(struct net_device *dev, u16 proto, u16 vid, boo
 			return -EPERM;
 		}
 		mv_pp2x_prs_hw_inv(hw, pe->index);
-		hw->prs_shadow[pe->index].valid = false;
+		mv_pp2x_prs_shadow_clear(hw, pe->index);
 		empty = mv_pp2x_prs_tcam_vid_empty(hw, vid_start, vid_start + MVPP2_PRS_VLAN_FILT_MAX_ENTRY);
 		if (empty) {
 			rc = mv_pp2x_prs_vid_drop_entry_accept(dev, vid_start + MVPP2_PRS_VLAN_FILT_DFLT_ENTRY, false);
@@ -3230,92 +3491,102 @@ static void mv_pp2x_cls_flow_cos(struct mv_pp2x_hw *hw,
 	hw->cls_shadow->flow_free_start++;
 }
 
-/* Init flow entry for RSS hash in PP22 */
+/* Init flow entries for RSS hash in PP22, one per port. A port is added to
+ * its entry when its hash fields are set.
+ */
 static void mv_pp2x_cls_flow_rss_hash(struct mv_pp2x_hw *hw,
 				      struct mv_pp2x_cls_flow_entry *fe,
-				      int lkpid, int rss_mode)
+				      int lkpid)
 {
-	int field_id[4] = {0};
-	int entry_idx = hw->cls_shadow->flow_free_start;
-	int lkpid_attr = mv_pp2x_prs_flow_id_attr_get(lkpid);
+	int port;
 
-	/* IP4 packet */
-	if (lkpid_attr & MVPP2_PRS_FL_ATTR_IP4_BIT) {
-		field_id[0] = MVPP2_CLS_FIELD_IP4SA;
-		field_id[1] = MVPP2_CLS_FIELD_IP4DA;
-	} else if (lkpid_attr & MVPP2_PRS_FL_ATTR_IP6_BIT) {
-		field_id[0] = MVPP2_CLS_FIELD_IP6SA;
-		field_id[1] = MVPP2_CLS_FIELD_IP6DA;
-	}
-	/* L4 port */
-	field_id[2] = MVPP2_CLS_FIELD_L4SIP;
-	field_id[3] = MVPP2_CLS_FIELD_L4DIP;
+	hw->cls_shadow->flow_info[lkpid -
+		MVPP2_PRS_FL_START].flow_entry_rss =
+			hw->cls_shadow->flow_free_start;
 
-	/* Set SW */
-	memset(fe, 0, sizeof(struct mv_pp2x_cls_flow_entry));
-	if (rss_mode == MVPP2_RSS_HASH_2T) {
-		mv_pp2x_cls_sw_flow_hek_num_set(fe, 2);
-		mv_pp2x_cls_sw_flow_eng_set(fe, MVPP2_CLS_ENGINE_C3HA, 1);
-		mv_pp2x_cls_sw_flow_hek_set(fe, 0, field_id[0]);
-		mv_pp2x_cls_sw_flow_hek_set(fe, 1, field_id[1]);
-	} else {
-		mv_pp2x_cls_sw_flow_hek_num_set(fe, 4);
-		mv_pp2x_cls_sw_flow_hek_set(fe, 0, field_id[0]);
-		mv_pp2x_cls_sw_flow_hek_set(fe, 1, field_id[1]);
-		mv_pp2x_cls_sw_flow_hek_set(fe, 2, field_id[2]);
-		mv_pp2x_cls_sw_flow_hek_set(fe, 3, field_id[3]);
-		mv_pp2x_cls_sw_flow_eng_set(fe, MVPP2_CLS_ENGINE_C3HB, 1);
+	for (port = 0; port < MVPP2_MAX_PORTS; port++) {
+		memset(fe, 0, sizeof(struct mv_pp2x_cls_flow_entry));
+		mv_pp2x_cls_sw_flow_hek_num_set(fe, 0);
+		mv_pp2x_cls_sw_flow_eng_set(fe, MVPP2_CLS_ENGINE_C3HA,
+					    port == MVPP2_MAX_PORTS - 1);
+		mv_pp2x_cls_sw_flow_extra_set(fe, MVPP2_CLS_LKP_HASH,
+					      MVPP2_CLS_FL_RSS_PRI);
+		fe->index = hw->cls_shadow->flow_free_start++;
+		mv_pp2x_cls_flow_write(hw, fe);
 	}
-	mv_pp2x_cls_sw_flow_extra_set(fe,
-				      MVPP2_CLS_LKP_HASH, MVPP2_CLS_FL_RSS_PRI);
-	fe->index = entry_idx;
+}
 
-	/* Update last for TCP & UDP NF flow */
-	if (((lkpid_attr & (MVPP2_PRS_FL_ATTR_TCP_BIT | MVPP2_PRS_FL_ATTR_UDP_BIT)) &&
-	     !(lkpid_attr & MVPP2_PRS_FL_ATTR_FRAG_BIT))) {
-		if (!hw->cls_shadow->flow_info[lkpid -
-			MVPP2_PRS_FL_START].flow_entry_rss1) {
-			if (rss_mode == MVPP2_RSS_HASH_2T)
-				mv_pp2x_cls_sw_flow_eng_set(fe,
-							    MVPP2_CLS_ENGINE_C3HA, 0);
-			else
-				mv_pp2x_cls_sw_flow_eng_set(fe,
-							    MVPP2_CLS_ENGINE_C3HB, 0);
-		}
+/* Init flow entries of ntuple rules, no port until a rule is set */
+static void mv_pp2x_cls_flow_ntuple(struct mv_pp2x_hw *hw,
+				    struct mv_pp2x_cls_flow_entry *fe,
+				    int lkpid)
+{
+	int i;
+
+	hw->cls_shadow->flow_info[lkpid -
+		MVPP2_PRS_FL_START].flow_entry_ntuple =
+			hw->cls_shadow->flow_free_start;
+
+	for (i = 0; i < MVPP2_CLS_NTUPLE_FLOW_ENTRIES; i++) {
+		memset(fe, 0, sizeof(struct mv_pp2x_cls_flow_entry));
+		mv_pp2x_cls_sw_flow_hek_num_set(fe, 0);
+		mv_pp2x_cls_sw_flow_eng_set(fe, MVPP2_CLS_ENGINE_C2, 0);
+		mv_pp2x_cls_sw_flow_extra_set(fe, MVPP2_CLS_LKP_MAX + i,
+					      MVPP2_CLS_FL_COS_PRI);
+		fe->index = hw->cls_shadow->flow_free_start++;
+		mv_pp2x_cls_flow_write(hw, fe);
 	}
+}
+
+/* Init flow entry of aRFS C3 exact match on the IPv4 4-tuple, ports are
+ * added when aRFS is enabled
+ */
+static void mv_pp2x_cls_flow_arfs(struct mv_pp2x_hw *hw,
+				  struct mv_pp2x_cls_flow_entry *fe,
+				  int lkpid)
+{
+	int entry_idx = hw->cls_shadow->flow_free_start;
+
+	memset(fe, 0, sizeof(struct mv_pp2x_cls_flow_entry));
+	mv_pp2x_cls_sw_flow_hek_num_set(fe, 4);
+	mv_pp2x_cls_sw_flow_hek_set(fe, 0, MVPP2_CLS_FIELD_IP4SA);
+	mv_pp2x_cls_sw_flow_hek_set(fe, 1, MVPP2_CLS_FIELD_IP4DA);
+	mv_pp2x_cls_sw_flow_hek_set(fe, 2, MVPP2_CLS_FIELD_L4SIP);
+	mv_pp2x_cls_sw_flow_hek_set(fe, 3, MVPP2_CLS_FIELD_L4DIP);
+	mv_pp2x_cls_sw_flow_eng_set(fe, MVPP2_CLS_ENGINE_C3A, 0);
+	mv_pp2x_cls_sw_flow_extra_set(fe, MVPP2_CLS_LKP_ARFS,
+				      MVPP2_CLS_FL_COS_PRI);
+	fe->index = entry_idx;
 
-	/* Write HW */
 	mv_pp2x_cls_flow_write(hw, fe);
 
-	/* Update Shadow */
-	if (hw->cls_shadow->flow_info[lkpid -
-		MVPP2_PRS_FL_START].flow_entry_rss1 == 0)
-		hw->cls_shadow->flow_info[lkpid -
-			MVPP2_PRS_FL_START].flow_entry_rss1 = entry_idx;
-	else
-		hw->cls_shadow->flow_info[lkpid -
-			MVPP2_PRS_FL_START].flow_entry_rss2 = entry_idx;
+	hw->cls_shadow->flow_info[lkpid -
+		MVPP2_PRS_FL_START].flow_entry_arfs = entry_idx;
 
-	/* Update first available flow entry */
 	hw->cls_shadow->flow_free_start++;
 }
 
 /* Init cls flow table according to different flow id */
 void mv_pp2x_cls_flow_tbl_config(struct mv_pp2x_hw *hw)
 {
-	int lkpid, rss_mode, lkpid_attr;
+	int lkpid, lkpid_attr;
 	struct mv_pp2x_cls_flow_entry fe;
 
+	/* The static layout must leave room for one temporary flow copy */
+	BUILD_BUG_ON(MVPP2_CLS_FLOW_ENTRIES_INIT + MVPP2_CLS_FLOW_ENTRIES_MAX >
+		     MVPP2_CLS_FLOWS_TBL_SIZE);
+
 	for (lkpid = MVPP2_PRS_FL_START; lkpid < MVPP2_PRS_FL_LAST; lkpid++) {
+		/* Ntuple rules head the flow */
+		mv_pp2x_cls_flow_ntuple(hw, &fe, lkpid);
 		/* Get lookup id attribute */
 		lkpid_attr = mv_pp2x_prs_flow_id_attr_get(lkpid);
-		/* Default rss hash is based on 5T */
-		rss_mode = MVPP2_RSS_HASH_5T;
-		/* For frag packets or non-TCP&UDP, rss must be based on 2T */
-		if ((lkpid_attr & MVPP2_PRS_FL_ATTR_FRAG_BIT) ||
-		    !(lkpid_attr & (MVPP2_PRS_FL_ATTR_TCP_BIT |
-		    MVPP2_PRS_FL_ATTR_UDP_BIT)))
-			rss_mode = MVPP2_RSS_HASH_2T;
+		/* aRFS steers non-frag IPv4 TCP & UDP before CoS */
+		if ((lkpid_attr & MVPP2_PRS_FL_ATTR_IP4_BIT) &&
+		    (lkpid_attr & (MVPP2_PRS_FL_ATTR_TCP_BIT |
+		     MVPP2_PRS_FL_ATTR_UDP_BIT)) &&
+		    !(lkpid_attr & MVPP2_PRS_FL_ATTR_FRAG_BIT))
+			mv_pp2x_cls_flow_arfs(hw, &fe, lkpid);
 
 		/* For untagged IP packets, only need default
 		 * rule and dscp rule
@@ -3329,19 +3600,8 @@ void mv_pp2x_cls_flow_tbl_config(struct mv_pp2x_hw *hw)
 			/* DSCP rule */
 			mv_pp2x_cls_flow_cos(hw, &fe, lkpid,
 					     MVPP2_COS_TYPE_DSCP);
-			/* RSS hash rule */
-			if ((!(lkpid_attr & MVPP2_PRS_FL_ATTR_FRAG_BIT)) &&
-			    (lkpid_attr & (MVPP2_PRS_FL_ATTR_TCP_BIT |
-				MVPP2_PRS_FL_ATTR_UDP_BIT))) {
-				/* RSS hash rules for TCP & UDP rss mode update */
-				mv_pp2x_cls_flow_rss_hash(hw, &fe, lkpid,
-							  MVPP2_RSS_HASH_2T);
-				mv_pp2x_cls_flow_rss_hash(hw, &fe, lkpid,
-							  MVPP2_RSS_HASH_5T);
-			} else {
-				mv_pp2x_cls_flow_rss_hash(hw, &fe, lkpid,
-							  rss_mode);
-			}
+			/* RSS hash rules */
+			mv_pp2x_cls_flow_rss_hash(hw, &fe, lkpid);
 		}
 
 		/* For tagged IP packets, only need vlan rule and dscp rule */
@@ -3354,19 +3614,8 @@ void mv_pp2x_cls_flow_tbl_config(struct mv_pp2x_hw *hw)
 			/* DSCP rule */
 			mv_pp2x_cls_flow_cos(hw, &fe, lkpid,
 					     MVPP2_COS_TYPE_DSCP);
-			/* RSS hash rule */
-			if ((!(lkpid_attr & MVPP2_PRS_FL_ATTR_FRAG_BIT)) &&
-			    (lkpid_attr & (MVPP2_PRS_FL_ATTR_TCP_BIT |
-				MVPP2_PRS_FL_ATTR_UDP_BIT))) {
-				/* RSS hash rules for TCP & UDP rss mode update */
-				mv_pp2x_cls_flow_rss_hash(hw, &fe, lkpid,
-							  MVPP2_RSS_HASH_2T);
-				mv_pp2x_cls_flow_rss_hash(hw, &fe, lkpid,
-							  MVPP2_RSS_HASH_5T);
-			} else {
-				mv_pp2x_cls_flow_rss_hash(hw, &fe, lkpid,
-							  rss_mode);
-			}
+			/* RSS hash rules */
+			mv_pp2x_cls_flow_rss_hash(hw, &fe, lkpid);
 		}
 
 		/* For non-IP packets, only need default rule if untagged,
@@ -3453,6 +3702,18 @@ int mv_pp2x_cls_hw_udf_set(struct mv_pp2x_hw *hw, int udf_no, int offs_id,
 }
 EXPORT_SYMBOL(mv_pp2x_cls_hw_udf_set);
 
+/* Get the lookup table pointer of a flow, given the first CoS/RSS entry */
+int mv_pp2x_cls_flow_head(struct mv_pp2x_cls_flow_info *flow_info,
+			  int flow_idx)
+{
+	if (flow_info->flow_entry_ntuple &&
+	    flow_info->flow_entry_ntuple < flow_idx)
+		return flow_info->flow_entry_ntuple;
+
+	return flow_idx;
+}
+EXPORT_SYMBOL(mv_pp2x_cls_flow_head);
+
 /* Init lookup decoding table with lookup id */
 void mv_pp2x_cls_lookup_tbl_config(struct mv_pp2x_hw *hw)
 {
@@ -3490,6 +3751,7 @@ void mv_pp2x_cls_lookup_tbl_config(struct mv_pp2x_hw *hw)
 			if (flow_idx > data[i])
 				flow_idx = data[i];
 		}
+		flow_idx = mv_pp2x_cls_flow_head(flow_info, flow_idx);
 
 		/* Set flow pointer index */
 		mv_pp2x_cls_sw_lkp_flow_set(&le, flow_idx);
@@ -3563,6 +3825,9 @@ int mv_pp2x_cls_init(struct platform_device *pdev, struct mv_pp2x_hw *hw)
 	/* Init lookup table */
 	mv_pp2x_cls_lookup_tbl_config(hw);
 
+	/* Init C3 for aRFS */
+	mv_pp2x_cls_c3_arfs_init(hw);
+
 	return 0;
 }
 
@@ -3702,6 +3967,24 @@ void mv_pp2x_rx_time_coal_set(struct mv_pp2x_port *port,
 		      MVPP2_ISR_RX_THRESHOLD_REG(rxq->id), val);
 }
 
+/* Program Rx interrupt thresholds, rxq coalescing configuration is kept */
+void mv_pp2x_rx_coal_thresh_set(struct mv_pp2x_port *port,
+				struct mv_pp2x_rx_queue *rxq, u32 pkts, u32 usec)
+{
+	u32 val;
+
+	val = (port->priv->hw.tclk / USEC_PER_SEC) * usec;
+	if (val > MVPP2_MAX_ISR_RX_THRESHOLD)
+		val = MVPP2_MAX_ISR_RX_THRESHOLD;
+	if (pkts > MVPP2_MAX_OCCUPIED_THRESH)
+		pkts = MVPP2_MAX_OCCUPIED_THRESH;
+
+	mv_pp2x_write(&port->priv->hw, MVPP2_RXQ_NUM_REG, rxq->id);
+	mv_pp2x_write(&port->priv->hw, MVPP2_RXQ_THRESH_REG, pkts);
+	mv_pp2x_write(&port->priv->hw,
+		      MVPP2_ISR_RX_THRESHOLD_REG(rxq->id), val);
+}
+
 /* Set threshold for TX_DONE pkts coalescing */
 void mv_pp2x_tx_done_pkts_coal_set(void *arg)
 {
@@ -3721,6 +4004,28 @@ void mv_pp2x_tx_done_pkts_coal_set(void *arg)
 	}
 }
 
+/* Set TX_DONE pkts threshold of all port TXQs in sw_thread address space,
+ * txq coalescing configuration is kept
+ */
+void mv_pp22_tx_done_pkts_thresh_set(struct mv_pp2x_port *port, int sw_thread,
+				     u32 pkts)
+{
+	int queue;
+	u32 val;
+
+	if (pkts > MVPP2_MAX_TRANSMITTED_THRESH)
+		pkts = MVPP2_MAX_TRANSMITTED_THRESH;
+	val = (pkts << MVPP2_TRANSMITTED_THRESH_OFFSET) &
+	       MVPP2_TRANSMITTED_THRESH_MASK;
+
+	for (queue = 0; queue < port->num_tx_queues; queue++) {
+		mv_pp22_thread_write(&port->priv->hw, sw_thread,
+				     MVPP2_TXQ_NUM_REG, port->txqs[queue]->id);
+		mv_pp22_thread_write(&port->priv->hw, sw_thread,
+				     MVPP2_TXQ_THRESH_REG, val);
+	}
+}
+
 /* Set the time delay in usec before Rx interrupt */
 void mv_pp2x_tx_done_time_coal_set(struct mv_pp2x_port *port, u32 usec)
 {
@@ -3795,6 +4100,67 @@ void mv_pp2x_txp_max_tx_size_set(struct mv_pp2x_port *port)
 	}
 }
 
+/* Limit TXQ of port to rate Mbps, 0 for no limit. Refill period is 1 usec,
+ * so the refill tokens are rate bits. The bucket holds 1 msec at rate and
+ * no less than the TXP MTU.
+ */
+int mv_pp2x_txq_rate_set(struct mv_pp2x_port *port, int txq, u32 rate)
+{
+	struct mv_pp2x_hw *hw = &port->priv->hw;
+	u32 val, tokens, size, mtu;
+
+	if (txq >= MVPP2_MAX_TXQ || rate > MVPP2_TXQ_REFILL_TOKENS_MAX)
+		return -EINVAL;
+
+	mv_pp2x_write(hw, MVPP2_TXP_SCHED_PORT_INDEX_REG,
+		      mv_pp2x_egress_port(port));
+
+	if (rate) {
+		tokens = rate;
+		mtu = mv_pp2x_read(hw, MVPP2_TXP_SCHED_MTU_REG) &
+		      MVPP2_TXP_MTU_MAX;
+		size = max(rate * 1000, mtu);
+	} else {
+		tokens = MVPP2_TXQ_REFILL_TOKENS_MAX;
+		size = MVPP2_TXQ_TOKEN_SIZE_MAX;
+	}
+
+	val = mv_pp2x_read(hw, MVPP2_TXQ_SCHED_REFILL_REG(txq));
+	val &= ~(MVPP2_TXQ_REFILL_TOKENS_ALL_MASK |
+		 MVPP2_TXQ_REFILL_PERIOD_ALL_MASK);
+	val |= MVPP2_TXQ_REFILL_TOKENS_MASK(tokens) |
+	       MVPP2_TXQ_REFILL_PERIOD_MASK(1);
+	mv_pp2x_write(hw, MVPP2_TXQ_SCHED_REFILL_REG(txq), val);
+	mv_pp2x_write(hw, MVPP2_TXQ_SCHED_TOKEN_SIZE_REG(txq), size);
+
+	return 0;
+}
+EXPORT_SYMBOL(mv_pp2x_txq_rate_set);
+
+/* TXQs of port in fixed priority, a higher TXQ is served first. The other
+ * TXQs share the remaining bandwidth by WRR.
+ */
+u32 mv_pp2x_txq_fixed_prio_get(struct mv_pp2x_port *port)
+{
+	struct mv_pp2x_hw *hw = &port->priv->hw;
+
+	mv_pp2x_write(hw, MVPP2_TXP_SCHED_PORT_INDEX_REG,
+		      mv_pp2x_egress_port(port));
+
+	return mv_pp2x_read(hw, MVPP2_TXP_SCHED_FIXED_PRIO_REG);
+}
+EXPORT_SYMBOL(mv_pp2x_txq_fixed_prio_get);
+
+void mv_pp2x_txq_fixed_prio_set(struct mv_pp2x_port *port, u32 txqs)
+{
+	struct mv_pp2x_hw *hw = &port->priv->hw;
+
+	mv_pp2x_write(hw, MVPP2_TXP_SCHED_PORT_INDEX_REG,
+		      mv_pp2x_egress_port(port));
+	mv_pp2x_write(hw, MVPP2_TXP_SCHED_FIXED_PRIO_REG, txqs);
+}
+EXPORT_SYMBOL(mv_pp2x_txq_fixed_prio_set);
+
 /* Set Tx descriptors fields relevant for CSUM calculation */
 u32 mv_pp2x_txq_desc_csum(int l3_offs, int l3_proto,
 			  int ip_hdr_len, int l4_proto)
@@ -4211,6 +4577,17 @@ int mv_pp2x_prs_default_init(struct platform_device *pdev,
 {
 	int err, index, i;
 
+	hw->prs_shadow = devm_kcalloc(&pdev->dev, MVPP2_PRS_TCAM_SRAM_SIZE,
+				      sizeof(struct mv_pp2x_prs_shadow),
+				      GFP_KERNEL);
+
+	if (!hw->prs_shadow)
+		return -ENOMEM;
+
+	hash_init(hw->prs_hash);
+	bitmap_zero(hw->prs_used, MVPP2_PRS_TCAM_SRAM_SIZE);
+	hw->prs_moves = 0;
+
 	/* Enable tcam table */
 	mv_pp2x_write(hw, MVPP2_PRS_TCAM_CTRL_REG, MVPP2_PRS_TCAM_EN_MASK);
 
@@ -4229,13 +4606,6 @@ int mv_pp2x_prs_default_init(struct platform_device *pdev,
 	for (index = 0; index < MVPP2_PRS_TCAM_SRAM_SIZE; index++)
 		mv_pp2x_prs_hw_inv(hw, index);
 
-	hw->prs_shadow = devm_kcalloc(&pdev->dev, MVPP2_PRS_TCAM_SRAM_SIZE,
-				      sizeof(struct mv_pp2x_prs_shadow),
-				      GFP_KERNEL);
-
-	if (!hw->prs_shadow)
-		return -ENOMEM;
-
 	/* Always start from lookup = 0 */
 	for (index = 0; index < MVPP2_MAX_PORTS; index++)
 		mv_pp2x_prs_hw_port_init(hw, index, MVPP2_PRS_LU_MH,
@@ -5416,19 +5786,153 @@ void mv_pp2x_cls_flow_port_del(struct mv_pp2x_hw *hw, int index, int port_id)
 	mv_pp2x_write(hw, MVPP2_CLS_FLOW_TBL0_REG, data);
 }
 
+static int mv_pp2x_cls_field_bytes(int field_id)
+{
+	switch (field_id) {
+	case MVPP2_CLS_FIELD_MAC_DA:
+		return ETH_ALEN;
+	case MVPP2_CLS_FIELD_L3_PROTO:
+		return 1;
+	case MVPP2_CLS_FIELD_IP4SA:
+	case MVPP2_CLS_FIELD_IP4DA:
+		return 4;
+	case MVPP2_CLS_FIELD_IP6SA:
+	case MVPP2_CLS_FIELD_IP6DA:
+		return 16;
+	default:
+		return 2;
+	}
+}
+
+/* Get the HEK fields of the RSS hash of flow ID lkpid with the hash fields
+ * hek_opts, MVPP2_RSS_HEK_* bits. L4 ports are not extracted from fragments
+ * and non-TCP/UDP packets. Return the number of fields.
+ */
+int mv_pp2x_cls_rss_hek_fields(int lkpid, u32 hek_opts, int *field_id)
+{
+	int lkpid_attr = mv_pp2x_prs_flow_id_attr_get(lkpid);
+	bool ip6 = lkpid_attr & MVPP2_PRS_FL_ATTR_IP6_BIT;
+	bool l4 = (lkpid_attr & (MVPP2_PRS_FL_ATTR_TCP_BIT |
+				 MVPP2_PRS_FL_ATTR_UDP_BIT)) &&
+		  !(lkpid_attr & MVPP2_PRS_FL_ATTR_FRAG_BIT);
+	int ids[MVPP2_CLS_FLOWS_TBL_FIELDS_MAX + 3];
+	int i, num = 0, bytes = 0;
+
+	if (hek_opts & MVPP2_RSS_HEK_MAC_DA)
+		ids[num++] = MVPP2_CLS_FIELD_MAC_DA;
+	if ((hek_opts & MVPP2_RSS_HEK_VLAN) &&
+	    (lkpid_attr & MVPP2_PRS_FL_ATTR_VLAN_BIT))
+		ids[num++] = MVPP2_CLS_FIELD_VLAN;
+	if (hek_opts & MVPP2_RSS_HEK_L3_PROTO)
+		ids[num++] = MVPP2_CLS_FIELD_L3_PROTO;
+	if (hek_opts & MVPP2_RSS_HEK_IP_SA)
+		ids[num++] = ip6 ? MVPP2_CLS_FIELD_IP6SA :
+				   MVPP2_CLS_FIELD_IP4SA;
+	if (hek_opts & MVPP2_RSS_HEK_IP_DA)
+		ids[num++] = ip6 ? MVPP2_CLS_FIELD_IP6DA :
+				   MVPP2_CLS_FIELD_IP4DA;
+	if (l4 && (hek_opts & MVPP2_RSS_HEK_L4_SP))
+		ids[num++] = MVPP2_CLS_FIELD_L4SIP;
+	if (l4 && (hek_opts & MVPP2_RSS_HEK_L4_DP))
+		ids[num++] = MVPP2_CLS_FIELD_L4DIP;
+
+	if (num > MVPP2_CLS_FLOWS_TBL_FIELDS_MAX)
+		return -EINVAL;
+
+	for (i = 0; i < num; i++) {
+		bytes += mv_pp2x_cls_field_bytes(ids[i]);
+		field_id[i] = ids[i];
+	}
+	if (bytes > MVPP2_CLS_C3_EXT_HEK_WORDS * 4)
+		return -EINVAL;
+
+	return num;
+}
+EXPORT_SYMBOL(mv_pp2x_cls_rss_hek_fields);
+
+/* Set the RSS hash fields of the port flow entry of flow ID lkpid, and add
+ * the port to it
+ */
+int mv_pp2x_cls_flow_rss_hek_set(struct mv_pp2x_hw *hw, int lkpid,
+				 int port_id, u32 hek_opts)
+{
+	struct mv_pp2x_cls_flow_info *flow_info;
+	struct mv_pp2x_cls_flow_entry fe;
+	int field_id[MVPP2_CLS_FLOWS_TBL_FIELDS_MAX];
+	int i, num, engine, index;
+
+	flow_info = &hw->cls_shadow->flow_info[lkpid - MVPP2_PRS_FL_START];
+	if (!flow_info->flow_entry_rss)
+		return -EINVAL;
+
+	num = mv_pp2x_cls_rss_hek_fields(lkpid, hek_opts, field_id);
+	if (num < 0)
+		return num;
+
+	/* Hash on L4 ports is done by engine C3HB */
+	engine = MVPP2_CLS_ENGINE_C3HA;
+	for (i = 0; i < num; i++) {
+		if (field_id[i] == MVPP2_CLS_FIELD_L4SIP ||
+		    field_id[i] == MVPP2_CLS_FIELD_L4DIP)
+			engine = MVPP2_CLS_ENGINE_C3HB;
+	}
+
+	index = flow_info->flow_entry_rss + port_id;
+	mv_pp2x_cls_flow_read(hw, index, &fe);
+	mv_pp2x_cls_sw_flow_hek_num_set(&fe, num);
+	for (i = 0; i < num; i++)
+		mv_pp2x_cls_sw_flow_hek_set(&fe, i, field_id[i]);
+	mv_pp2x_cls_sw_flow_eng_set(&fe, engine,
+				    fe.data[0] & MVPP2_FLOW_LAST_MASK);
+	fe.data[0] |= (1 << port_id) << MVPP2_FLOW_PORT_ID;
+	mv_pp2x_cls_flow_write(hw, &fe);
+
+	return 0;
+}
+EXPORT_SYMBOL(mv_pp2x_cls_flow_rss_hek_set);
+
 /* The function prepare a temporary flow table for lkpid flow,
  * in order to change the original one
  */
-void mv_pp2x_cls_flow_tbl_temp_copy(struct mv_pp2x_hw *hw, int lkpid,
-				    int *temp_flow_idx)
+int mv_pp2x_cls_flow_tbl_temp_copy(struct mv_pp2x_hw *hw, int lkpid,
+				   int *temp_flow_idx)
 {
 	struct mv_pp2x_cls_flow_entry fe;
 	int index = lkpid - MVPP2_PRS_FL_START;
 	int flow_start = hw->cls_shadow->flow_free_start;
 	struct mv_pp2x_cls_flow_info *flow_info;
+	int entries = 0;
 
 	flow_info = &hw->cls_shadow->flow_info[index];
 
+	if (flow_info->flow_entry_ntuple)
+		entries += MVPP2_CLS_NTUPLE_FLOW_ENTRIES;
+	entries += !!flow_info->flow_entry_arfs + !!flow_info->flow_entry_dflt +
+		   !!flow_info->flow_entry_vlan + !!flow_info->flow_entry_dscp;
+	if (flow_info->flow_entry_rss)
+		entries += MVPP2_MAX_PORTS;
+	if (flow_start + entries > MVPP2_CLS_FLOWS_TBL_SIZE) {
+		pr_err("No room for temp copy of flow %d: %d entries from %d\n",
+		       lkpid, entries, flow_start);
+		return -ENOSPC;
+	}
+
+	if (flow_info->flow_entry_ntuple) {
+		int i;
+
+		for (i = 0; i < MVPP2_CLS_NTUPLE_FLOW_ENTRIES; i++) {
+			mv_pp2x_cls_flow_read(hw,
+					      flow_info->flow_entry_ntuple + i,
+					      &fe);
+			fe.index = flow_start++;
+			mv_pp2x_cls_flow_write(hw, &fe);
+		}
+	}
+	if (flow_info->flow_entry_arfs) {
+		mv_pp2x_cls_flow_read(hw, flow_info->flow_entry_arfs, &fe);
+		fe.index = flow_start++;
+		mv_pp2x_cls_flow_write(hw, &fe);
+	}
 	if (flow_info->flow_entry_dflt) {
 		mv_pp2x_cls_flow_read(hw, flow_info->flow_entry_dflt, &fe);
 		fe.index = flow_start++;
@@ -5444,18 +5948,21 @@ void mv_pp2x_cls_flow_tbl_temp_copy(struct mv_pp2x_hw *hw, int lkpid,
 		fe.index = flow_start++;
 		mv_pp2x_cls_flow_write(hw, &fe);
 	}
-	if (flow_info->flow_entry_rss1) {
-		mv_pp2x_cls_flow_read(hw, flow_info->flow_entry_rss1, &fe);
-		fe.index = flow_start++;
-		mv_pp2x_cls_flow_write(hw, &fe);
-	}
-	if (flow_info->flow_entry_rss2) {
-		mv_pp2x_cls_flow_read(hw, flow_info->flow_entry_rss2, &fe);
-		fe.index = flow_start++;
-		mv_pp2x_cls_flow_write(hw, &fe);
+	if (flow_info->flow_entry_rss) {
+		int port;
+
+		for (port = 0; port < MVPP2_MAX_PORTS; port++) {
+			mv_pp2x_cls_flow_read(hw,
+					      flow_info->flow_entry_rss + port,
+					      &fe);
+			fe.index = flow_start++;
+			mv_pp2x_cls_flow_write(hw, &fe);
+		}
 	}
 
 	*temp_flow_idx = hw->cls_shadow->flow_free_start;
+
+	return 0;
 }
 
 /* C2 rule and Qos table */
@@ -5771,6 +6278,27 @@ int mv_pp2x_cls_c2_rss_set(struct mv_pp2x_cls_c2_entry *c2, int cmd, int rss_en)
 }
 EXPORT_SYMBOL(mv_pp2x_cls_c2_rss_set);
 
+int mv_pp2x_cls_c2_plcr_set(struct mv_pp2x_cls_c2_entry *c2, int cmd,
+			    int plcr_id, int bank)
+{
+	if (!c2 || cmd > MVPP2_ACTION_TYPE_UPDT_LOCK ||
+	    plcr_id >= (1 << MVPP2_CLS2_ACT_DUP_ATTR_PLCRID_BITS) ||
+	    bank >= (1 << MVPP2_CLS2_ACT_DUP_ATTR_PLCRBK_BITS))
+		return -EINVAL;
+
+	c2->sram.regs.actions &= ~MVPP2_CLS2_ACT_PLCR_MASK;
+	c2->sram.regs.actions |= (cmd << MVPP2_CLS2_ACT_PLCR_OFF);
+
+	c2->sram.regs.rss_attr &= ~(MVPP2_CLS2_ACT_DUP_ATTR_PLCRID_MASK |
+				    MVPP2_CLS2_ACT_DUP_ATTR_PLCRBK_MASK);
+	c2->sram.regs.rss_attr |=
+		(plcr_id << MVPP2_CLS2_ACT_DUP_ATTR_PLCRID_OFF) |
+		(bank << MVPP2_CLS2_ACT_DUP_ATTR_PLCRBK_OFF);
+
+	return 0;
+}
+EXPORT_SYMBOL(mv_pp2x_cls_c2_plcr_set);
+
 int mv_pp2x_cls_c2_flow_id_en(struct mv_pp2x_cls_c2_entry *c2, int flowid_en)
 {
 	if (!c2)
@@ -5887,6 +6415,13 @@ static int mv_pp2x_c2_tcam_set(struct mv_pp2x_hw *hw,
 	if (ret_code)
 		return ret_code;
 
+	/* Set policer, bank 0 */
+	ret_code = mv_pp2x_cls_c2_plcr_set(&c2_entry,
+					   c2_add_entry->action.plcr_act,
+					   c2_add_entry->qos_info.policer_id, 0);
+	if (ret_code)
+		return ret_code;
+
 	/* Set flowID(not for multicast) */
 	ret_code = mv_pp2x_cls_c2_flow_id_en(&c2_entry,
 					     c2_add_entry->action.flowid_act);
@@ -5897,6 +6432,10 @@ static int mv_pp2x_c2_tcam_set(struct mv_pp2x_hw *hw,
 	memset(hek_byte, 0, MVPP2_CLS_C2_HEK_OFF_MAX);
 	memset(hek_byte_mask, 0, MVPP2_CLS_C2_HEK_OFF_MAX);
 
+	/* HEK offs 0-7, fields extracted by the flow entry */
+	memcpy(hek_byte, c2_add_entry->hek, MVPP2_CLS_C2_HEK_BYTES);
+	memcpy(hek_byte_mask, c2_add_entry->hek_mask, MVPP2_CLS_C2_HEK_BYTES);
+
 	/* HEK offs 8, lookup type, port type */
 	hek_byte[MVPP2_CLS_C2_HEK_OFF_LKP_PORT_TYPE] =
 		(c2_add_entry->port.port_type <<
@@ -6016,6 +6555,12 @@ static int mv_pp2x_c2_rule_add(struct mv_pp2x_port *port,
 		return -EINVAL;
 	}
 
+	/* Entries at the end of the TCAM are kept for ntuple rules and tc
+	 * flower filters
+	 */
+	if (c2_index >= MVPP2_CLS_C2_RSVD_START)
+		return -ENOSPC;
+
 	/* Write C2 TCAM HW */
 	ret = mv_pp2x_c2_tcam_set(&port->priv->hw, c2_add_entry, c2_index);
 	if (ret)
@@ -6157,6 +6702,13 @@ int mv_pp2x_cls_c2_rule_set(struct mv_pp2x_port *port, u8 start_queue)
 		/* RSS En in PP22 */
 		c2_init_entry.rss_en = port->rss_cfg.rss_en;
 
+		/* Port policer, unless an ntuple rule locked another one */
+		if (port->plcr != MVPP2_PLCR_NONE) {
+			c2_init_entry.action.plcr_act =
+				MVPP2_ACTION_TYPE_UPDT_LOCK;
+			c2_init_entry.qos_info.policer_id = port->plcr;
+		}
+
 		/* Add rule to C2 TCAM */
 		ret = mv_pp2x_c2_rule_add(port, &c2_init_entry);
 		if (ret)
@@ -6167,6 +6719,318 @@ int mv_pp2x_cls_c2_rule_set(struct mv_pp2x_port *port, u8 start_queue)
 }
 EXPORT_SYMBOL(mv_pp2x_cls_c2_rule_set);
 
+/* Append a field to the HEK of ntuple rule, fields must be added in the
+ * order the flow entry extracts them, i.e. ascending field ID
+ */
+int mv_pp2x_cls_ntuple_field_add(struct mv_pp2x_cls_ntuple *rule,
+				 int *hek_offs, int field_id,
+				 u64 val, u64 mask, int bytes)
+{
+	int i;
+
+	if (!mask)
+		return 0;
+
+	if (rule->field_num == MVPP2_CLS_FLOWS_TBL_FIELDS_MAX ||
+	    *hek_offs + bytes > MVPP2_CLS_C2_HEK_BYTES)
+		return -EOPNOTSUPP;
+
+	rule->field_id[rule->field_num++] = field_id;
+	for (i = 0; i < bytes; i++) {
+		rule->hek[*hek_offs + i] = (val >> (8 * i)) & 0xff;
+		rule->hek_mask[*hek_offs + i] = (mask >> (8 * i)) & 0xff;
+	}
+	*hek_offs += bytes;
+
+	return 0;
+}
+EXPORT_SYMBOL(mv_pp2x_cls_ntuple_field_add);
+
+/* Enable the flow entries of an ntuple rule location in the flows the rule
+ * applies to and disable them in the others, rule NULL disables them all.
+ * Only the flow attributes and fields of rule are used.
+ */
+void mv_pp2x_cls_ntuple_lkp_set(struct mv_pp2x_hw *hw, int port_id, int loc,
+				struct mv_pp2x_cls_ntuple *rule)
+{
+	struct mv_pp2x_cls_flow_entry fe;
+	struct mv_pp2x_cls_flow_info *flow_info;
+	int lkpid, index, i;
+	u32 attr;
+
+	for (lkpid = MVPP2_PRS_FL_START; lkpid < MVPP2_PRS_FL_LAST; lkpid++) {
+		flow_info = &hw->cls_shadow->flow_info[lkpid -
+			MVPP2_PRS_FL_START];
+		if (!flow_info->flow_entry_ntuple)
+			continue;
+		index = flow_info->flow_entry_ntuple +
+			MVPP2_CLS_NTUPLE_IDX(port_id, loc);
+		attr = mv_pp2x_prs_flow_id_attr_get(lkpid);
+
+		if (!rule || (attr & rule->flow_attr_mask) != rule->flow_attr) {
+			mv_pp2x_cls_flow_port_del(hw, index, port_id);
+			continue;
+		}
+
+		/* Port bit is set last, once the fields are in place */
+		mv_pp2x_cls_flow_read(hw, index, &fe);
+		fe.data[2] = 0;
+		mv_pp2x_cls_sw_flow_hek_num_set(&fe, rule->field_num);
+		for (i = 0; i < rule->field_num; i++)
+			mv_pp2x_cls_sw_flow_hek_set(&fe, i, rule->field_id[i]);
+		mv_pp2x_cls_flow_write(hw, &fe);
+		mv_pp2x_cls_flow_port_add(hw, index, port_id);
+	}
+}
+EXPORT_SYMBOL(mv_pp2x_cls_ntuple_lkp_set);
+
+/* Write the C2 entry matching rule in the lookup of ntuple location loc at
+ * TCAM index c2_index
+ */
+int mv_pp2x_cls_ntuple_c2_set(struct mv_pp2x_port *port, int loc,
+			      struct mv_pp2x_cls_ntuple *rule, int c2_index)
+{
+	struct mv_pp2x_c2_add_entry c2_entry;
+
+	mv_pp2x_cls_c2_entry_common_set(&c2_entry, port->id,
+					MVPP2_CLS_LKP_NTUPLE(port->id, loc));
+	memcpy(c2_entry.hek, rule->hek, MVPP2_CLS_C2_HEK_BYTES);
+	memcpy(c2_entry.hek_mask, rule->hek_mask, MVPP2_CLS_C2_HEK_BYTES);
+
+	if (rule->drop)
+		c2_entry.action.color_act = MVPP2_COLOR_ACTION_TYPE_RED_LOCK;
+
+	if (rule->police) {
+		c2_entry.action.plcr_act = MVPP2_ACTION_TYPE_UPDT_LOCK;
+		c2_entry.qos_info.policer_id = rule->plcr;
+	}
+
+	/* QoS info from C2 action table. Unless the rule spreads over an RSS
+	 * context, RSS is disabled by rss_en 0.
+	 */
+	c2_entry.rss_en = rule->rss;
+	c2_entry.qos_info.q_low_src = MVPP2_QOS_SRC_ACTION_TBL;
+	c2_entry.qos_info.q_high_src = MVPP2_QOS_SRC_ACTION_TBL;
+	c2_entry.qos_value.q_low = ((u16)rule->rxq) &
+		((1 << MVPP2_CLS2_ACT_QOS_ATTR_QL_BITS) - 1);
+	c2_entry.qos_value.q_high = ((u16)rule->rxq) >>
+		MVPP2_CLS2_ACT_QOS_ATTR_QL_BITS;
+
+	return mv_pp2x_c2_tcam_set(&port->priv->hw, &c2_entry, c2_index);
+}
+EXPORT_SYMBOL(mv_pp2x_cls_ntuple_c2_set);
+
+/* Set ntuple rule of port in location loc, replacing the previous one */
+int mv_pp2x_cls_ntuple_set(struct mv_pp2x_port *port, int loc,
+			   struct mv_pp2x_cls_ntuple *rule)
+{
+	struct mv_pp2x_hw *hw = &port->priv->hw;
+	int ret;
+
+	if (loc < 0 || loc >= MVPP2_CLS_NTUPLE_RULES || !rule ||
+	    rule->field_num > MVPP2_CLS_FLOWS_TBL_FIELDS_MAX)
+		return -EINVAL;
+
+	/* Stop matching the previous rule before its C2 entry is rewritten */
+	mv_pp2x_cls_ntuple_lkp_set(hw, port->id, loc, NULL);
+
+	ret = mv_pp2x_cls_ntuple_c2_set(port, loc, rule,
+					MVPP2_CLS_C2_NTUPLE_IDX(port->id, loc));
+	if (ret)
+		return ret;
+
+	mv_pp2x_cls_ntuple_lkp_set(hw, port->id, loc, rule);
+
+	return 0;
+}
+EXPORT_SYMBOL(mv_pp2x_cls_ntuple_set);
+
+/* Delete ntuple rule of port in location loc */
+int mv_pp2x_cls_ntuple_del(struct mv_pp2x_port *port, int loc)
+{
+	struct mv_pp2x_hw *hw = &port->priv->hw;
+
+	if (loc < 0 || loc >= MVPP2_CLS_NTUPLE_RULES)
+		return -EINVAL;
+
+	mv_pp2x_cls_ntuple_lkp_set(hw, port->id, loc, NULL);
+
+	return mv_pp2x_cls_c2_hw_inv(hw,
+				     MVPP2_CLS_C2_NTUPLE_IDX(port->id, loc));
+}
+EXPORT_SYMBOL(mv_pp2x_cls_ntuple_del);
+
+/* Read C2 hit counter of ntuple rule of port in location loc */
+u32 mv_pp2x_cls_ntuple_hits_get(struct mv_pp2x_port *port, int loc)
+{
+	u32 cnt = 0;
+
+	mv_pp2x_cls_c2_hit_cntr_read(&port->priv->hw,
+				     MVPP2_CLS_C2_NTUPLE_IDX(port->id, loc),
+				     &cnt);
+
+	return cnt;
+}
+EXPORT_SYMBOL(mv_pp2x_cls_ntuple_hits_get);
+
+/* C3 exact match for aRFS. The HEK is the IPv4 4-tuple extracted by the
+ * aRFS flow entry, 12 bytes so no extension table entry is needed.
+ * Callers hold hw->c3_lock.
+ */
+static int mv_pp2x_cls_c3_cpu_done_wait(struct mv_pp2x_hw *hw)
+{
+	int iter = 0;
+
+	while (!(mv_pp2x_read(hw, MVPP2_CLS3_STATE_REG) &
+		 MVPP2_CLS3_STATE_CPU_DONE_MASK)) {
+		if (++iter >= RETRIES_EXCEEDED) {
+			pr_err("%s: C3 access timeout\n", __func__);
+			return -ETIMEDOUT;
+		}
+	}
+
+	return 0;
+}
+
+static void mv_pp2x_cls_c3_arfs_key_write(struct mv_pp2x_hw *hw, int port_id,
+					  struct mv_pp2x_cls_c3_flow *flow)
+{
+	u32 hek[MVPP2_CLS_C3_EXT_HEK_WORDS] = {0};
+	u32 key_ctrl, l4;
+	int i;
+
+	l4 = (flow->ip_proto == IPPROTO_TCP ? MVPP2_PRS_RI_L4_TCP :
+	      MVPP2_PRS_RI_L4_UDP) >> MVPP2_PRS_RI_L4_PROTO_OFFS;
+
+	key_ctrl = (MVPP2_CLS_C3_HEK_BYTES << KEY_CTRL_HEK_SIZE) |
+		   ((1 << port_id) << KEY_CTRL_PRT_ID) |
+		   (MVPP2_SRC_PORT_TYPE_PHY << KEY_CTRL_PRT_ID_TYPE) |
+		   (MVPP2_CLS_LKP_ARFS << KEY_CTRL_LKP_TYPE) |
+		   (l4 << KEY_CTRL_L4);
+
+	/* Short HEK takes the last words, first field first */
+	hek[6] = flow->sip;
+	hek[7] = flow->dip;
+	hek[8] = (flow->sport << 16) | flow->dport;
+
+	mv_pp2x_write(hw, MVPP2_CLS3_KEY_CTRL_REG, key_ctrl);
+	for (i = 0; i < MVPP2_CLS_C3_EXT_HEK_WORDS; i++)
+		mv_pp2x_write(hw, MVPP2_CLS3_KEY_HEK_REG(i), hek[i]);
+}
+
+/* Add aRFS flow of port steered to physical rxq, return the C3 hash index */
+int mv_pp2x_cls_c3_arfs_add(struct mv_pp2x_hw *hw, int port_id,
+			    struct mv_pp2x_cls_c3_flow *flow, u8 rxq)
+{
+	u32 occupied, val;
+	int bank, index, ret;
+
+	mv_pp2x_cls_c3_arfs_key_write(hw, port_id, flow);
+
+	/* Query the candidate index in each bank */
+	mv_pp2x_write(hw, MVPP2_CLS3_QRY_ACT_REG, BIT(MVPP2_CLS3_QRY_ACT));
+	ret = mv_pp2x_cls_c3_cpu_done_wait(hw);
+	if (ret)
+		return ret;
+
+	occupied = (mv_pp2x_read(hw, MVPP2_CLS3_STATE_REG) &
+		    MVPP2_CLS3_STATE_OCCIPIED_MASK) >> MVPP2_CLS3_STATE_OCCIPIED;
+	for (bank = 0; bank < MVPP2_CLS3_HASH_BANKS_NUM; bank++)
+		if (!(occupied & BIT(bank)))
+			break;
+	/* No relocation of other keys, the flow stays on RSS */
+	if (bank == MVPP2_CLS3_HASH_BANKS_NUM)
+		return -ENOSPC;
+	index = mv_pp2x_read(hw, MVPP2_CLS3_QRY_RES_HASH_REG(bank)) &
+		MVPP2_CLS3_HASH_OP_TBL_ADDR_MASK;
+
+	mv_pp2x_write(hw, MVPP2_CLS3_INIT_HIT_CNT_REG, 0);
+	mv_pp2x_write(hw, MVPP2_CLS3_HASH_OP_REG,
+		      (index << MVPP2_CLS3_HASH_OP_TBL_ADDR) |
+		      BIT(MVPP2_CLS3_HASH_OP_ADD));
+	ret = mv_pp2x_cls_c3_cpu_done_wait(hw);
+	if (ret)
+		return ret;
+
+	/* Queue from the action, RSS disabled, all locked */
+	val = (MVPP2_ACTION_TYPE_UPDT_LOCK << MVPP2_CLS2_ACT_QL_OFF) |
+	      (MVPP2_ACTION_TYPE_UPDT_LOCK << MVPP2_CLS2_ACT_QH_OFF) |
+	      (MVPP2_ACTION_TYPE_UPDT_LOCK << MVPP2_CLS2_ACT_RSS_OFF) |
+	      (MVPP2_FRWD_ACTION_TYPE_SWF_LOCK << MVPP2_CLS2_ACT_FRWD_OFF);
+	mv_pp2x_write(hw, MVPP2_CLS3_ACT_REG, val);
+	val = ((rxq & ((1 << MVPP2_CLS2_ACT_QOS_ATTR_QL_BITS) - 1)) <<
+	       MVPP2_CLS2_ACT_QOS_ATTR_QL_OFF) |
+	      ((rxq >> MVPP2_CLS2_ACT_QOS_ATTR_QL_BITS) <<
+	       MVPP2_CLS2_ACT_QOS_ATTR_QH_OFF);
+	mv_pp2x_write(hw, MVPP2_CLS3_ACT_QOS_ATTR_REG, val);
+	mv_pp2x_write(hw, MVPP2_CLS3_ACT_HWF_ATTR_REG, 0);
+	mv_pp2x_write(hw, MVPP2_CLS3_ACT_DUP_ATTR_REG, 0);
+	mv_pp2x_write(hw, MVPP2_CLS3_ACT_SEQ_L_ATTR_REG, 0);
+	mv_pp2x_write(hw, MVPP2_CLS3_ACT_SEQ_H_ATTR_REG, 0);
+
+	return index;
+}
+EXPORT_SYMBOL(mv_pp2x_cls_c3_arfs_add);
+
+int mv_pp2x_cls_c3_arfs_del(struct mv_pp2x_hw *hw, int index)
+{
+	mv_pp2x_write(hw, MVPP2_CLS3_HASH_OP_REG,
+		      (index << MVPP2_CLS3_HASH_OP_TBL_ADDR) |
+		      BIT(MVPP2_CLS3_HASH_OP_DEL));
+
+	return mv_pp2x_cls_c3_cpu_done_wait(hw);
+}
+EXPORT_SYMBOL(mv_pp2x_cls_c3_arfs_del);
+
+/* Hits of C3 entry since the previous read, the counter clears on read */
+u32 mv_pp2x_cls_c3_hits_get(struct mv_pp2x_hw *hw, int index)
+{
+	mv_pp2x_write(hw, MVPP2_CLS3_DB_INDEX_REG, index);
+
+	return mv_pp2x_read(hw, MVPP2_CLS3_HIT_COUNTER_REG) &
+		MVPP2_CLS3_HIT_COUNTER_MASK;
+}
+EXPORT_SYMBOL(mv_pp2x_cls_c3_hits_get);
+
+/* Enable or disable aRFS lookup of port in all flows */
+void mv_pp2x_cls_arfs_port_set(struct mv_pp2x_hw *hw, int port_id, bool en)
+{
+	struct mv_pp2x_cls_flow_info *flow_info;
+	int index;
+
+	for (index = 0; index < (MVPP2_PRS_FL_LAST - MVPP2_PRS_FL_START);
+		index++) {
+		flow_info = &hw->cls_shadow->flow_info[index];
+		if (!flow_info->flow_entry_arfs)
+			continue;
+		if (en)
+			mv_pp2x_cls_flow_port_add(hw,
+						  flow_info->flow_entry_arfs,
+						  port_id);
+		else
+			mv_pp2x_cls_flow_port_del(hw,
+						  flow_info->flow_entry_arfs,
+						  port_id);
+	}
+}
+EXPORT_SYMBOL(mv_pp2x_cls_arfs_port_set);
+
+/* aRFS miss entry leaves the packet to CoS and RSS */
+void mv_pp2x_cls_c3_arfs_init(struct mv_pp2x_hw *hw)
+{
+	spin_lock_init(&hw->c3_lock);
+
+	mv_pp2x_write(hw, MVPP2_CLS3_HASH_OP_REG,
+		      (MVPP2_CLS_LKP_ARFS << MVPP2_CLS3_HASH_OP_TBL_ADDR) |
+		      MVPP2_CLS3_MISS_PTR_MASK | BIT(MVPP2_CLS3_HASH_OP_ADD));
+	mv_pp2x_write(hw, MVPP2_CLS3_ACT_REG, 0);
+	mv_pp2x_write(hw, MVPP2_CLS3_ACT_QOS_ATTR_REG, 0);
+	mv_pp2x_write(hw, MVPP2_CLS3_ACT_HWF_ATTR_REG, 0);
+	mv_pp2x_write(hw, MVPP2_CLS3_ACT_DUP_ATTR_REG, 0);
+	mv_pp2x_write(hw, MVPP2_CLS3_ACT_SEQ_L_ATTR_REG, 0);
+	mv_pp2x_write(hw, MVPP2_CLS3_ACT_SEQ_H_ATTR_REG, 0);
+}
+
 /* The function get the queue in the C2 rule with input index */
 u8 mv_pp2x_cls_c2_rule_queue_get(struct mv_pp2x_hw *hw, u32 rule_idx)
 {
@@ -6433,7 +7297,7 @@ void mv_pp2x_counters_stat_update(struct mv_pp2x_port *port,
 				  struct gop_stat *gop_statistics)
 {
 	struct mv_pp2x_hw *hw = &port->priv->hw;
-	int val, queue;
+	int val, queue, plcr;
 
 	val = mv_pp2x_read(hw, MV_PP2_OVERRUN_DROP_REG(port->id));
 	gop_statistics->rx_ppv2_overrun += val;
@@ -6461,13 +7325,120 @@ void mv_pp2x_counters_stat_update(struct mv_pp2x_port *port,
 		gop_statistics->rx_hw_drop += val;
 	}
 	preempt_enable();
+
+	for (plcr = 0; plcr < MVPP2_PLCR_BANK_NUM; plcr++) {
+		if (hw->plcr_owner[plcr] != port->id)
+			continue;
+		gop_statistics->rx_police_green +=
+			mv_pp2x_read(hw, MVPP2_PLCR_GREEN_CNTR_REG(plcr));
+		gop_statistics->rx_police_yellow +=
+			mv_pp2x_read(hw, MVPP2_PLCR_YELLOW_CNTR_REG(plcr));
+		gop_statistics->rx_police_red +=
+			mv_pp2x_read(hw, MVPP2_PLCR_RED_CNTR_REG(plcr));
+	}
 }
 
+/* Policer */
+
+/* Policer counters are clear on read, like the rest of the 0x7000 counter
+ * block (port overrun and classifier drops, RXQ and BM drops) that
+ * mv_pp2x_counters_stat_update() accumulates and mv_pp2x_counters_stat_clear()
+ * clears by reading.
+ */
+static void mv_pp2x_plcr_cntrs_clear(struct mv_pp2x_hw *hw, int plcr)
+{
+	mv_pp2x_read(hw, MVPP2_PLCR_GREEN_CNTR_REG(plcr));
+	mv_pp2x_read(hw, MVPP2_PLCR_YELLOW_CNTR_REG(plcr));
+	mv_pp2x_read(hw, MVPP2_PLCR_RED_CNTR_REG(plcr));
+}
+
+/* Disable all policers and start the token update every
+ * 1/MVPP2_PLCR_PERIOD_HZ sec
+ */
+void mv_pp2x_plcr_init(struct mv_pp2x_hw *hw)
+{
+	u32 period = hw->tclk / MVPP2_PLCR_PERIOD_HZ;
+	int plcr;
+
+	mv_pp2x_write(hw, MVPP2_PLCR_BASE_PERIOD_REG,
+		      MVPP2_PLCR_BASE_PERIOD_MASK(period) |
+		      MVPP2_PLCR_ADD_TOKENS_EN_MASK);
+
+	for (plcr = 0; plcr < MVPP2_PLCR_NUM; plcr++) {
+		mv_pp2x_write(hw, MVPP2_PLCR_TABLE_INDEX_REG, plcr);
+		mv_pp2x_write(hw, MVPP2_PLCR_TOKEN_CFG_REG, 0);
+	}
+
+	for (plcr = 0; plcr < MVPP2_PLCR_BANK_NUM; plcr++)
+		hw->plcr_owner[plcr] = MVPP2_PLCR_NONE;
+}
+EXPORT_SYMBOL(mv_pp2x_plcr_init);
+
+/* Allocate a disabled bank 0 policer to port, callers hold rtnl */
+int mv_pp2x_plcr_alloc(struct mv_pp2x_hw *hw, int port_id)
+{
+	int plcr;
+
+	for (plcr = 0; plcr < MVPP2_PLCR_BANK_NUM; plcr++) {
+		if (hw->plcr_owner[plcr] != MVPP2_PLCR_NONE)
+			continue;
+		mv_pp2x_plcr_cntrs_clear(hw, plcr);
+		hw->plcr_owner[plcr] = port_id;
+		return plcr;
+	}
+
+	return -ENOSPC;
+}
+EXPORT_SYMBOL(mv_pp2x_plcr_alloc);
+
+/* Free policer, no C2 entry may use it anymore */
+void mv_pp2x_plcr_free(struct mv_pp2x_hw *hw, int plcr)
+{
+	mv_pp2x_write(hw, MVPP2_PLCR_TABLE_INDEX_REG, plcr);
+	mv_pp2x_write(hw, MVPP2_PLCR_TOKEN_CFG_REG, 0);
+	hw->plcr_owner[plcr] = MVPP2_PLCR_NONE;
+}
+EXPORT_SYMBOL(mv_pp2x_plcr_free);
+
+/* Meter policer at rate bytes/sec with a burst bytes commit bucket. The
+ * excess bucket is empty, so packets over the rate are colored red and
+ * dropped. The commit bucket gets the token value in bytes on each base
+ * period update (token type 0), so the rate is rounded to a multiple of
+ * MVPP2_PLCR_PERIOD_HZ bytes/sec.
+ */
+int mv_pp2x_plcr_set(struct mv_pp2x_hw *hw, int plcr, u64 rate, u64 burst)
+{
+	u32 period = hw->tclk / MVPP2_PLCR_PERIOD_HZ;
+	u64 tokens;
+
+	if (!burst || burst > MVPP2_PLCR_COMMIT_SIZE_ALL_MASK)
+		return -ERANGE;
+
+	tokens = div_u64(rate * period + hw->tclk / 2, hw->tclk);
+	if (!tokens || tokens > MVPP2_PLCR_TOKEN_VALUE_ALL_MASK)
+		return -ERANGE;
+
+	mv_pp2x_write(hw, MVPP2_PLCR_TABLE_INDEX_REG, plcr);
+	mv_pp2x_write(hw, MVPP2_PLCR_BUCKET_SIZE_REG,
+		      MVPP2_PLCR_COMMIT_SIZE_MASK(burst));
+	mv_pp2x_write(hw, MVPP2_PLCR_COMMIT_TOKENS_REG, burst);
+	mv_pp2x_write(hw, MVPP2_PLCR_EXCESS_TOKENS_REG, 0);
+	mv_pp2x_write(hw, MVPP2_PLCR_TOKEN_CFG_REG,
+		      MVPP2_PLCR_TOKEN_VALUE_MASK(tokens) |
+		      MVPP2_PLCR_TOKEN_TYPE_MASK(0) |
+		      MVPP2_PLCR_TOKEN_UNIT_BYTES |
+		      MVPP2_PLCR_COLOR_MODE_BLIND |
+		      MVPP2_PLCR_ENABLE_MASK);
+
+	return 0;
+}
+EXPORT_SYMBOL(mv_pp2x_plcr_set);
+
 /*  Clear Mvpp2x counter statistic */
 void mv_pp2x_counters_stat_clear(struct mv_pp2x_port *port)
 {
 	struct mv_pp2x_hw *hw = &port->priv->hw;
-	int queue;
+	int queue, plcr;
 
 	mv_pp2x_read(hw, MV_PP2_OVERRUN_DROP_REG(port->id));
 	mv_pp2x_read(hw, MV_PP2_CLS_DROP_REG(port->id));
@@ -6481,4 +7452,8 @@ void mv_pp2x_counters_stat_clear(struct mv_pp2x_port *port)
 		mv_pp2x_read(hw, MVPP2_RX_PKT_BM_DROP_REG);
 	}
 	preempt_enable();
+
+	for (plcr = 0; plcr < MVPP2_PLCR_BANK_NUM; plcr++)
+		if (hw->plcr_owner[plcr] == port->id)
+			mv_pp2x_plcr_cntrs_clear(hw, plcr);
 }
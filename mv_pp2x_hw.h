@@ -300,7 +300,9 @@ static inline void mv_pp2x_bm_pool_put_virtual(struct mv_pp2x_hw *hw, u32 pool,
 			      lower_32_bits(buf_phys_addr), cpu);
 }
 
-/* Release buffer to BM */
+/* Release buffer to BM. High and low address writes must not interleave
+ * with other releases on the CPU, see mv_pp2x_bm_pool_put_bulk().
+ */
 static inline void mv_pp2x_bm_pool_put(struct mv_pp2x_hw *hw, u32 pool,
 				       dma_addr_t buf_phys_addr, int cpu)
 {
@@ -313,6 +315,36 @@ static inline void mv_pp2x_bm_pool_put(struct mv_pp2x_hw *hw, u32 pool,
 			      lower_32_bits(buf_phys_addr), cpu);
 }
 
+/* Release array of buffers to BM. The per-CPU high address register is
+ * written by every release on the CPU, so it is set at the start of each
+ * call and then only when the high bits change within the burst. Releases
+ * from process context run with BH disabled and can't interleave with it.
+ * Caller must order buffer memory accesses before the release.
+ */
+static inline void mv_pp2x_bm_pool_put_bulk(struct mv_pp2x_hw *hw, u32 pool,
+					    dma_addr_t *buf_phys_addr,
+					    int num, int cpu)
+{
+	int i;
+#if defined(CONFIG_ARCH_DMA_ADDR_T_64BIT) && defined(CONFIG_PHYS_ADDR_T_64BIT)
+	u32 high = upper_32_bits(buf_phys_addr[0]);
+
+	mv_pp2x_relaxed_write(hw, MVPP22_BM_PHY_VIRT_HIGH_RLS_REG, high, cpu);
+#endif
+
+	for (i = 0; i < num; i++) {
+#if defined(CONFIG_ARCH_DMA_ADDR_T_64BIT) && defined(CONFIG_PHYS_ADDR_T_64BIT)
+		if (unlikely(upper_32_bits(buf_phys_addr[i]) != high)) {
+			high = upper_32_bits(buf_phys_addr[i]);
+			mv_pp2x_relaxed_write(hw, MVPP22_BM_PHY_VIRT_HIGH_RLS_REG,
+					      high, cpu);
+		}
+#endif
+		mv_pp2x_relaxed_write(hw, MVPP2_BM_PHY_RLS_REG(pool),
+				      lower_32_bits(buf_phys_addr[i]), cpu);
+	}
+}
+
 /* Release multicast buffer */
 static inline void mv_pp2x_bm_pool_mc_put(struct mv_pp2x_port *port, int pool,
 					  u32 buf_phys_addr,
@@ -553,15 +585,25 @@ void mv_pp2x_cls_config(struct mv_pp2x_hw *hw);
 void mv_pp2x_cls_oversize_rxq_set(struct mv_pp2x_port *port);
 void mv_pp2x_cls_lookup_read(struct mv_pp2x_hw *hw, int lkpid, int way,
 			     struct mv_pp2x_cls_lookup_entry *le);
-void mv_pp2x_cls_flow_tbl_temp_copy(struct mv_pp2x_hw *hw, int lkpid,
-				    int *temp_flow_idx);
+int mv_pp2x_cls_flow_tbl_temp_copy(struct mv_pp2x_hw *hw, int lkpid,
+				   int *temp_flow_idx);
 void mv_pp2x_cls_lkp_flow_set(struct mv_pp2x_hw *hw, int lkpid, int way,
 			      int flow_idx);
 void mv_pp2x_cls_flow_port_add(struct mv_pp2x_hw *hw, int index, int port_id);
 void mv_pp2x_cls_flow_port_del(struct mv_pp2x_hw *hw, int index, int port_id);
+int mv_pp2x_cls_rss_hek_fields(int lkpid, u32 hek_opts, int *field_id);
+int mv_pp2x_cls_flow_rss_hek_set(struct mv_pp2x_hw *hw, int lkpid,
+				 int port_id, u32 hek_opts);
+int mv_pp2x_cls_flow_head(struct mv_pp2x_cls_flow_info *flow_info,
+			  int flow_idx);
 
 void mv_pp2x_txp_max_tx_size_set(struct mv_pp2x_port *port);
+int mv_pp2x_txq_rate_set(struct mv_pp2x_port *port, int txq, u32 rate);
+u32 mv_pp2x_txq_fixed_prio_get(struct mv_pp2x_port *port);
+void mv_pp2x_txq_fixed_prio_set(struct mv_pp2x_port *port, u32 txqs);
 void mv_pp2x_tx_done_time_coal_set(struct mv_pp2x_port *port, u32 usec);
+void mv_pp22_tx_done_pkts_thresh_set(struct mv_pp2x_port *port, int sw_thread,
+				     u32 pkts);
 void mv_pp21_gmac_max_rx_size_set(struct mv_pp2x_port *port);
 
 int mv_pp2x_txq_pend_desc_num_get(struct mv_pp2x_port *port,
@@ -618,6 +660,8 @@ void mv_pp2x_rx_pkts_coal_set(struct mv_pp2x_port *port,
 			      struct mv_pp2x_rx_queue *rxq);
 void mv_pp2x_rx_time_coal_set(struct mv_pp2x_port *port,
 			      struct mv_pp2x_rx_queue *rxq);
+void mv_pp2x_rx_coal_thresh_set(struct mv_pp2x_port *port,
+				struct mv_pp2x_rx_queue *rxq, u32 pkts, u32 usec);
 void mv_pp2x_tx_done_pkts_coal_set(void *arg);
 void mv_pp2x_cause_error(struct net_device *dev, int cause);
 void mv_pp2x_rx_error(struct mv_pp2x_port *port,
@@ -655,6 +699,8 @@ void mv_pp2x_prs_hw_port_init(struct mv_pp2x_hw *hw, int port,
 			      int lu_first, int lu_max, int offset);
 void mv_pp2x_prs_sw_clear(struct mv_pp2x_prs_entry *pe);
 void mv_pp2x_prs_hw_inv(struct mv_pp2x_hw *hw, int index);
+int mv_pp2x_prs_region_stats_get(struct mv_pp2x_hw *hw, int region_id,
+				 struct mv_pp2x_prs_region_stats *stats);
 void mv_pp2x_prs_tcam_lu_set(struct mv_pp2x_prs_entry *pe, unsigned int lu);
 void mv_pp2x_prs_tcam_port_set(struct mv_pp2x_prs_entry *pe,
 			       unsigned int port, bool add);
@@ -751,6 +797,23 @@ int mv_pp2x_cls_c2_hw_read(struct mv_pp2x_hw *hw, int index,
 int mv_pp2x_cls_c2_hit_cntr_clear_all(struct mv_pp2x_hw *hw);
 int mv_pp2x_cls_c2_hit_cntr_read(struct mv_pp2x_hw *hw, int index, u32 *cntr);
 int mv_pp2x_cls_c2_rule_set(struct mv_pp2x_port *port, u8 start_queue);
+int mv_pp2x_cls_ntuple_field_add(struct mv_pp2x_cls_ntuple *rule,
+				 int *hek_offs, int field_id,
+				 u64 val, u64 mask, int bytes);
+void mv_pp2x_cls_ntuple_lkp_set(struct mv_pp2x_hw *hw, int port_id, int loc,
+				struct mv_pp2x_cls_ntuple *rule);
+int mv_pp2x_cls_ntuple_c2_set(struct mv_pp2x_port *port, int loc,
+			      struct mv_pp2x_cls_ntuple *rule, int c2_index);
+int mv_pp2x_cls_ntuple_set(struct mv_pp2x_port *port, int loc,
+			   struct mv_pp2x_cls_ntuple *rule);
+int mv_pp2x_cls_ntuple_del(struct mv_pp2x_port *port, int loc);
+u32 mv_pp2x_cls_ntuple_hits_get(struct mv_pp2x_port *port, int loc);
+void mv_pp2x_cls_c3_arfs_init(struct mv_pp2x_hw *hw);
+int mv_pp2x_cls_c3_arfs_add(struct mv_pp2x_hw *hw, int port_id,
+			    struct mv_pp2x_cls_c3_flow *flow, u8 rxq);
+int mv_pp2x_cls_c3_arfs_del(struct mv_pp2x_hw *hw, int index);
+u32 mv_pp2x_cls_c3_hits_get(struct mv_pp2x_hw *hw, int index);
+void mv_pp2x_cls_arfs_port_set(struct mv_pp2x_hw *hw, int port_id, bool en);
 u8 mv_pp2x_cls_c2_rule_queue_get(struct mv_pp2x_hw *hw, u32 rule_idx);
 void mv_pp2x_cls_c2_rule_queue_set(struct mv_pp2x_hw *hw, u32 rule_idx,
 				   u8 queue);
@@ -781,6 +844,13 @@ int mv_pp2x_cls_c2_rss_set(struct mv_pp2x_cls_c2_entry *c2, int cmd,
 			   int rss_en);
 int mv_pp2x_cls_c2_flow_id_en(struct mv_pp2x_cls_c2_entry *c2,
 			      int flowid_en);
+int mv_pp2x_cls_c2_plcr_set(struct mv_pp2x_cls_c2_entry *c2, int cmd,
+			    int plcr_id, int bank);
+
+void mv_pp2x_plcr_init(struct mv_pp2x_hw *hw);
+int mv_pp2x_plcr_alloc(struct mv_pp2x_hw *hw, int port_id);
+void mv_pp2x_plcr_free(struct mv_pp2x_hw *hw, int plcr);
+int mv_pp2x_plcr_set(struct mv_pp2x_hw *hw, int plcr, u64 rate, u64 burst);
 
 int mv_pp22_rss_tbl_entry_set(struct mv_pp2x_hw *hw,
 			      struct mv_pp22_rss_entry *rss);
@@ -1262,6 +1262,12 @@
 
 #define MVPP2_RX_BUF_SIZE(pkt_size)	((pkt_size) + NET_SKB_PAD)
 #define MVPP2_RX_TOTAL_SIZE(buf_size)	((buf_size) + MVPP2_SKB_SHINFO_SIZE)
+
+/* Max number of buffers released to BM in one refill burst */
+#define MVPP2_BM_REFILL_BATCH		64
+
+/* Number of RX pages per CPU kept mapped while owned by the stack */
+#define MVPP2_PAGE_RING_SIZE		512
 #define MVPP2_RX_MAX_PKT_SIZE(total_size) \
 	((total_size) - NET_SKB_PAD - MVPP2_SKB_SHINFO_SIZE)
 
@@ -1273,6 +1279,8 @@
 #define MVPP2_F_IFCAP_NETMAP		BIT(1) /* netmap port */
 #define MVPP2_F_IF_MUSDK		BIT(2) /* musdk port */
 #define MVPP2_F_IF_MUSDK_DOWN		BIT(3) /* musdk port that has been put stopped */
+#define MVPP2_F_DIM_RX			BIT(4) /* adaptive RX coalescing */
+#define MVPP2_F_DIM_TX			BIT(5) /* adaptive TX done coalescing */
 
 /* Marvell tag types */
 enum mv_pp2x_tag_type {
@@ -1289,6 +1297,7 @@ enum mv_pp2x_tag_type {
 #define MVPP2_PRS_TCAM_WORDS		6
 #define MVPP2_PRS_SRAM_WORDS		4
 #define MVPP2_PRS_FLOW_ID_SIZE		64
+#define MVPP2_PRS_HASH_BITS		6
 #define MVPP2_PRS_FLOW_ID_MASK		0x3f
 #define MVPP2_PRS_TCAM_ENTRY_VALID	0
 #define MVPP2_PRS_TCAM_ENTRY_INVALID	1
@@ -1461,6 +1470,7 @@ enum mv_pp2x_tag_type {
 #define MVPP2_PRS_RI_IP_FRAG_FALSE		0x0
 #define MVPP2_PRS_RI_UDF3_MASK			0x300000
 #define MVPP2_PRS_RI_UDF3_RX_SPECIAL		BIT(21)
+#define MVPP2_PRS_RI_L4_PROTO_OFFS		22
 #define MVPP2_PRS_RI_L4_PROTO_MASK		0x1c00000
 #define MVPP2_PRS_RI_L4_TCP			BIT(22)
 #define MVPP2_PRS_RI_L4_UDP			BIT(23)
@@ -1724,6 +1734,10 @@ enum mv_pp2x_cls_fl_pri {
 };
 
 enum mv_pp2x_cls_filed_id {
+	MVPP2_CLS_FIELD_MAC_DA = 0x03,
+	MVPP2_CLS_FIELD_VLAN = 0x06,
+	MVPP2_CLS_FIELD_ETH_TYPE = 0x08,
+	MVPP2_CLS_FIELD_L3_PROTO = 0x0F,
 	MVPP2_CLS_FIELD_IP4SA = 0x10,
 	MVPP2_CLS_FIELD_IP4DA = 0x11,
 	MVPP2_CLS_FIELD_IP6SA = 0x17,
@@ -1738,10 +1752,34 @@ enum mv_pp2x_cos_type {
 	MVPP2_COS_TYPE_DSCP,
 };
 
-enum mv_pp2x_rss_hash_mode {
-	MVPP2_RSS_HASH_2T = 0,
-	MVPP2_RSS_HASH_5T,
-};
+/* RSS flow types, each with its own hash fields. Fragmented TCP/UDP packets
+ * are hashed as the other IP packets, without L4 ports.
+ */
+enum mv_pp2x_rss_flow {
+	MVPP2_RSS_FLOW_TCP4 = 0,
+	MVPP2_RSS_FLOW_UDP4,
+	MVPP2_RSS_FLOW_IP4,
+	MVPP2_RSS_FLOW_TCP6,
+	MVPP2_RSS_FLOW_UDP6,
+	MVPP2_RSS_FLOW_IP6,
+	MVPP2_RSS_FLOW_NUM
+};
+
+/* RSS hash fields, extracted to the HEK in this order. VLAN is extracted
+ * from tagged packets only.
+ */
+#define MVPP2_RSS_HEK_MAC_DA		BIT(0)
+#define MVPP2_RSS_HEK_VLAN		BIT(1)
+#define MVPP2_RSS_HEK_L3_PROTO		BIT(2)
+#define MVPP2_RSS_HEK_IP_SA		BIT(3)
+#define MVPP2_RSS_HEK_IP_DA		BIT(4)
+#define MVPP2_RSS_HEK_L4_SP		BIT(5)
+#define MVPP2_RSS_HEK_L4_DP		BIT(6)
+#define MVPP2_RSS_HEK_2T		(MVPP2_RSS_HEK_IP_SA | \
+					 MVPP2_RSS_HEK_IP_DA)
+#define MVPP2_RSS_HEK_5T		(MVPP2_RSS_HEK_2T | \
+					 MVPP2_RSS_HEK_L4_SP | \
+					 MVPP2_RSS_HEK_L4_DP)
 
 enum mv_pp2x_mac_del_option {
 	MVPP2_DEL_MAC_ALL = 0,
@@ -1990,6 +2028,37 @@ struct mv_pp2x_prs_shadow {
 	/* Result info */
 	u32 ri;
 	u32 ri_mask;
+
+	/* SW mirror of tcam and sram hw entry */
+	struct mv_pp2x_prs_entry entry;
+
+	/* Lookup index, keyed by lookup ID and match data */
+	struct hlist_node node;
+};
+
+/* Parser tcam regions of dynamically allocated entries */
+enum mv_pp2x_prs_region_id {
+	MVPP2_PRS_REGION_FREE,
+	MVPP2_PRS_REGION_MAC,
+	MVPP2_PRS_REGION_VID,
+	MVPP2_PRS_REGION_LAST
+};
+
+struct mv_pp2x_prs_region {
+	const char *name;
+	int start;
+	int end;
+};
+
+struct mv_pp2x_prs_region_stats {
+	const char *name;
+	int start;
+	int end;
+	int used;
+	int free;
+	/* Number of contiguous free ranges */
+	int free_runs;
+	int largest_free_run;
 };
 
 struct mv_pp2x_cls_flow_entry {
@@ -2011,12 +2080,14 @@ struct mv_pp2x_cls_flow_info {
 	u32 flow_entry_vlan;
 	/* The flow table entry index of CoS DSCP rule */
 	u32 flow_entry_dscp;
-	/* The flow table entry index of RSS rule */
-	u32 flow_entry_rss1;
-	/* The flow table entry index of RSS rule for UDP packet to
-	 * update hash mode
+	/* The first flow table entry index of RSS hash rules, one per port
+	 * with the hash fields of the port
 	 */
-	u32 flow_entry_rss2;
+	u32 flow_entry_rss;
+	/* The first flow table entry index of ntuple rules */
+	u32 flow_entry_ntuple;
+	/* The flow table entry index of aRFS C3 exact match */
+	u32 flow_entry_arfs;
 };
 
 /* The flow entry could become lkp pointer in lookup table */
@@ -2037,6 +2108,7 @@ struct mv_pp2x_cls_shadow {
 
 /* C2  constants */
 #define MVPP2_CLS_C2_TCAM_SIZE			256
+#define MVPP2_CLS_C2_HEK_BYTES			8
 #define MVPP2_CLS_C2_TCAM_WORDS			5
 #define MVPP2_CLS_C2_TCAM_DATA_BYTES		10
 #define MVPP2_CLS_C2_SRAM_WORDS			5
@@ -2198,6 +2270,8 @@ struct mv_pp2x_engine_pkt_action {
 	enum mv_pp2x_general_action_type	rss_act;
 	enum mv_pp2x_flowid_action_type		flowid_act;
 	enum mv_pp2x_frwd_action_type		frwd_act;
+	/* policer from qos_info.policer_id */
+	enum mv_pp2x_general_action_type	plcr_act;
 };
 
 struct mv_pp2x_qos_value {
@@ -2226,6 +2300,9 @@ struct mv_pp2x_c2_add_entry {
 	struct mv_pp2x_src_port		port;
 	u8				lkp_type;
 	u8				lkp_type_mask;
+	/* HEK bytes 0-7 extracted by the flow entry fields */
+	u8				hek[MVPP2_CLS_C2_HEK_BYTES];
+	u8				hek_mask[MVPP2_CLS_C2_HEK_BYTES];
 	/* priority in this look_type */
 	u32				priority;
 	/* all the qos input */
@@ -2257,6 +2334,89 @@ struct mv_pp2x_c2_shadow {
 	struct mv_pp2x_c2_rule_idx rule_idx_info[8];
 };
 
+/* Classifier ntuple rules. Each flow ID heads its flow table sequence with
+ * one C2 entry per port rule location, the entry of a location carries its
+ * own lookup type above the CoS ones and the port bit only while the rule
+ * applies to the flow. The C2 TCAM entries of the rules are taken from the
+ * end of the TCAM, CoS rules are allocated from its start.
+ */
+#define MVPP2_CLS_NTUPLE_RULES		4
+#define MVPP2_CLS_NTUPLE_FLOW_ENTRIES	(MVPP2_MAX_PORTS * \
+					 MVPP2_CLS_NTUPLE_RULES)
+#define MVPP2_CLS_NTUPLE_IDX(port, loc)	((port) * MVPP2_CLS_NTUPLE_RULES + (loc))
+
+/* Flow table entries of one flow ID at most: ntuple rules, aRFS, two CoS
+ * rules and one RSS hash entry per port. A CoS or hash update copies that
+ * many into the free tail of the table before rewriting the original.
+ */
+#define MVPP2_CLS_FLOW_ENTRIES_MAX	(MVPP2_CLS_NTUPLE_FLOW_ENTRIES + 3 + \
+					 MVPP2_MAX_PORTS)
+/* Flow table entries used at init: the reserved entry 0, ntuple rules of
+ * every flow ID, aRFS of non-frag IPv4 TCP & UDP, two CoS rules and the RSS
+ * hash entries of IP flows, default plus VLAN rule of the non-IP flows.
+ */
+#define MVPP2_CLS_FLOW_ENTRIES_INIT	(1 + \
+	(MVPP2_PRS_FL_LAST - MVPP2_PRS_FL_START) * \
+	MVPP2_CLS_NTUPLE_FLOW_ENTRIES + \
+	(MVPP2_PRS_FL_IP6_TCP_NF_UNTAG - MVPP2_PRS_FL_START) + \
+	(MVPP2_PRS_FL_NON_IP_UNTAG - MVPP2_PRS_FL_START) * \
+	(2 + MVPP2_MAX_PORTS) + 3)
+#define MVPP2_CLS_LKP_NTUPLE(port, loc)	(MVPP2_CLS_LKP_MAX + \
+					 MVPP2_CLS_NTUPLE_IDX(port, loc))
+#define MVPP2_CLS_C2_NTUPLE_IDX(port, loc)	(MVPP2_CLS_C2_TCAM_SIZE - 1 - \
+					 MVPP2_CLS_NTUPLE_IDX(port, loc))
+
+/* tc flower filters share the ntuple lookups, a lookup per set of match
+ * keys. Their C2 TCAM entries are a per port range below the ntuple rule
+ * entries, where a port keeps its filters in priority order.
+ */
+#define MVPP2_CLS_C2_FLOWER_ENTRIES	32
+#define MVPP2_CLS_C2_RSVD_START		(MVPP2_CLS_C2_TCAM_SIZE - \
+					 MVPP2_CLS_NTUPLE_FLOW_ENTRIES - \
+					 MVPP2_MAX_PORTS * \
+					 MVPP2_CLS_C2_FLOWER_ENTRIES)
+#define MVPP2_CLS_C2_FLOWER_IDX(port, i)	(MVPP2_CLS_C2_RSVD_START + \
+					 (port) * MVPP2_CLS_C2_FLOWER_ENTRIES + \
+					 (i))
+
+/* C3 lookup type of aRFS entries, keyed by port and IPv4 4-tuple */
+#define MVPP2_CLS_LKP_ARFS		(MVPP2_CLS_LKP_MAX + \
+					 MVPP2_CLS_NTUPLE_FLOW_ENTRIES)
+
+struct mv_pp2x_cls_ntuple {
+	/* Rule applies to the flow IDs with (attr & flow_attr_mask) ==
+	 * flow_attr, MVPP2_PRS_FL_ATTR_* bits
+	 */
+	u32 flow_attr;
+	u32 flow_attr_mask;
+	/* HEK fields, in the order they are packed in hek[] */
+	int field_num;
+	int field_id[MVPP2_CLS_FLOWS_TBL_FIELDS_MAX];
+	u8 hek[MVPP2_CLS_C2_HEK_BYTES];
+	u8 hek_mask[MVPP2_CLS_C2_HEK_BYTES];
+	bool drop;
+	/* Physical RXQ to steer to, or with rss the RXQ selecting the RSS
+	 * context table
+	 */
+	u8 rxq;
+	bool rss;
+	/* Meter the matching packets with policer plcr */
+	bool police;
+	u8 plcr;
+};
+
+struct mv_pp2x_page_buf {
+	struct page *page;
+	dma_addr_t phys_addr;
+};
+
+/* Per-CPU FIFO of pool pages handed to the stack, oldest at head */
+struct mv_pp2x_page_ring {
+	u16 head;
+	u16 count;
+	struct mv_pp2x_page_buf bufs[MVPP2_PAGE_RING_SIZE];
+};
+
 struct mv_pp2x_bm_pool {
 	/* Pool number in the range 0-7 */
 	int id;
@@ -2284,6 +2444,15 @@ struct mv_pp2x_bm_pool {
 	u32 port_map;
 
 	int in_use_thresh;
+
+	/* DMA direction of pool buffers, bidirectional when XDP_TX may
+	 * transmit from them
+	 */
+	enum dma_data_direction dma_dir;
+
+	/* Page pool, NULL if buffers are page frags / kmalloc'ed */
+	struct mv_pp2x_page_ring __percpu *page_ring;
+	int page_order;
 };
 
 struct mv_pp2x_buff_hdr {
@@ -2291,7 +2460,9 @@ struct mv_pp2x_buff_hdr {
 	u32 next_buff_virt_addr;
 	u16 byte_count;
 	u16 info;
-	u8  reserved1;		/* bm_qset (for future use, BM) */
+	u16 reserved1;		/* bm_qset (for future use, BM) */
+	u8  next_buff_phys_addr_high;	/* PPv2.2 only */
+	u8  next_buff_virt_addr_high;	/* PPv2.2 only */
 };
 
 /* Buffer header info bits */
@@ -2420,6 +2591,15 @@ struct mv_pp2x_cls_c3_entry {
 	} sram;
 };
 
+/* aRFS flow, host order */
+struct mv_pp2x_cls_c3_flow {
+	u32 sip;
+	u32 dip;
+	u16 sport;
+	u16 dport;
+	u8 ip_proto;	/* IPPROTO_TCP or IPPROTO_UDP */
+};
+
 struct mv_pp2x_cls_c3_shadow_hash_entry {
 	/* valid if size > 0 */
 	/* size include the extension*/
@@ -2751,6 +2931,11 @@ struct mv_pp2x_mc_entry {
 
 /* Policer */
 #define MVPP2_PLCR_NUM		48
+/* Policers of bank 0, the ones a 5 bit C2 policer ID selects */
+#define MVPP2_PLCR_BANK_NUM	(1 << MVPP2_CLS2_ACT_DUP_ATTR_PLCRID_BITS)
+#define MVPP2_PLCR_NONE		(-1)
+/* Token update base period of 500 ns */
+#define MVPP2_PLCR_PERIOD_HZ	2000000
 
 /*********************************** RX Policer Registers *******************/
 /* exist only in ppv2.0 */
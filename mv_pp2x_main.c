@@ -47,6 +47,9 @@
 #include <net/ip.h>
 #include <net/ipv6.h>
 #include <net/busy_poll.h>
+#include <net/flow_dissector.h>
+#include <linux/jhash.h>
+#include <linux/cpu_rmap.h>
 #include <asm/cacheflush.h>
 #include <linux/dma-mapping.h>
 #include <dt-bindings/phy/phy-comphy-mvebu.h>
@@ -55,6 +58,11 @@
 #include "mv_pp2x_hw.h"
 #include "mv_gop110_hw.h"
 
+#ifdef MVPP2_XDP
+#include <linux/bpf.h>
+#include <linux/filter.h>
+#endif
+
 #if defined(CONFIG_NETMAP) || defined(CONFIG_NETMAP_MODULE)
 #include <if_mv_pp2x_netmap.h>
 #endif
@@ -96,6 +104,8 @@ static u8 first_log_rxq_queue;
 static u8 uc_filter_max = 4;
 static u16 stats_delay_msec = STATS_DELAY;
 static u16 stats_delay;
+static bool rx_page_pool;
+static bool rx_multi_buf;
 
 u32 debug_param;
 
@@ -155,7 +165,13 @@ MODULE_PARM_DESC(debug_param,
 		 "Ad-hoc parameter, which can be used for various debug operations.");
 
 module_param(stats_delay_msec, ushort, S_IRUGO);
-MODULE_PARM_DESC(stats_delay_msec, "Set statistic delay in msec, def=250");
+MODULE_PARM_DESC(stats_delay_msec, "Set statistic delay in msec, def=5000");
+
+module_param(rx_page_pool, bool, S_IRUGO);
+MODULE_PARM_DESC(rx_page_pool, "Back SWF BM pools with DMA mapped recyclable pages, def=0");
+
+module_param(rx_multi_buf, bool, S_IRUGO);
+MODULE_PARM_DESC(rx_multi_buf, "Receive jumbo frames over chained long pool buffers, def=0");
 
 module_param_named(short_pool, mv_pp2x_pools[MVPP2_BM_SWF_SHORT_POOL].buf_num, uint, S_IRUGO);
 MODULE_PARM_DESC(short_pool, "Short pool size (0-8192), def=2048");
@@ -228,21 +244,24 @@ void mv_pp2x_txq_inc_error(struct mv_pp2x_txq_pcpu *txq_pcpu, int num)
 			txq_pcpu->txq_put_index = txq_pcpu->size - 1;
 		else
 			txq_pcpu->txq_put_index--;
-		txq_pcpu->tx_skb[txq_pcpu->txq_put_index] = 0;
-		txq_pcpu->data_size[txq_pcpu->txq_put_index] = 0;
-		txq_pcpu->tx_buffs[txq_pcpu->txq_put_index] = 0;
+		memset(&txq_pcpu->shadow[txq_pcpu->txq_put_index], 0,
+		       sizeof(struct mv_pp2x_tx_shadow));
 	}
 }
 
 void mv_pp2x_txq_inc_put(enum mvppv2_version pp2_ver,
 			 struct mv_pp2x_txq_pcpu *txq_pcpu,
-			 struct sk_buff *skb,
+			 void *cookie, u8 type,
 			 struct mv_pp2x_tx_desc *tx_desc)
 {
-	txq_pcpu->tx_skb[txq_pcpu->txq_put_index] = skb;
-	txq_pcpu->data_size[txq_pcpu->txq_put_index] = tx_desc->data_size;
-	txq_pcpu->tx_buffs[txq_pcpu->txq_put_index] =
-				mv_pp2x_txdesc_phys_addr_get(pp2_ver, tx_desc);
+	struct mv_pp2x_tx_shadow *shadow = &txq_pcpu->shadow[txq_pcpu->txq_put_index];
+	u64 buf_phys_addr = mv_pp2x_txdesc_phys_addr_get(pp2_ver, tx_desc);
+
+	shadow->cookie = cookie;
+	shadow->buf_phys_addr = lower_32_bits(buf_phys_addr);
+	shadow->buf_phys_addr_high = upper_32_bits(buf_phys_addr);
+	shadow->data_size = tx_desc->data_size;
+	shadow->type = type;
 	if (unlikely(txq_pcpu->txq_put_index == txq_pcpu->size - 1))
 		txq_pcpu->txq_put_index = 0;
 	else
@@ -263,20 +282,47 @@ static void mv_pp2x_txq_dec_put(struct mv_pp2x_txq_pcpu *txq_pcpu)
 		txq_pcpu->txq_put_index--;
 }
 
-static void mv_pp2x_extra_pool_inc(struct mv_pp2x_ext_buf_pool *ext_buf_pool)
+/* Object cache routines, caller is responsible for per-CPU context */
+static inline void *mv_pp2x_obj_cache_get(struct mv_pp2x_obj_cache *cache)
 {
-	if (unlikely(ext_buf_pool->buf_pool_next_free == ext_buf_pool->buf_pool_size - 1))
-		ext_buf_pool->buf_pool_next_free = 0;
-	else
-		ext_buf_pool->buf_pool_next_free++;
+	if (unlikely(!cache->count))
+		return NULL;
+
+	return cache->objs[--cache->count];
 }
 
-static void mv_pp2x_skb_pool_inc(struct mv_pp2x_skb_pool *skb_pool)
+static inline bool mv_pp2x_obj_cache_put(struct mv_pp2x_obj_cache *cache,
+					 void *obj)
 {
-	if (unlikely(skb_pool->skb_pool_next_free == skb_pool->skb_pool_size - 1))
-		skb_pool->skb_pool_next_free = 0;
-	else
-		skb_pool->skb_pool_next_free++;
+	if (unlikely(cache->count == cache->size))
+		return false;
+
+	cache->objs[cache->count++] = obj;
+	return true;
+}
+
+/* Store up to num objects, return number of objects stored */
+static inline int mv_pp2x_obj_cache_put_bulk(struct mv_pp2x_obj_cache *cache,
+					     void **objs, int num)
+{
+	num = min(num, cache->size - cache->count);
+	memcpy(&cache->objs[cache->count], objs, num * sizeof(void *));
+	cache->count += num;
+
+	return num;
+}
+
+static int mv_pp2x_obj_cache_init(struct device *dev,
+				  struct mv_pp2x_obj_cache *cache, int size)
+{
+	cache->objs = devm_kcalloc(dev, size, sizeof(void *), GFP_KERNEL);
+	if (!cache->objs)
+		return -ENOMEM;
+
+	cache->size = size;
+	cache->count = 0;
+
+	return 0;
 }
 
 static u8 mv_pp2x_first_pool_get(struct mv_pp2x *priv)
@@ -317,12 +363,148 @@ static void mv_pp2x_frag_free(const struct mv_pp2x_bm_pool *pool, void *data)
 		kfree(data);
 }
 
+/* Size passed to build_skb(), 0 for kmalloc'ed jumbo buffers */
+static inline unsigned int mv_pp2x_bm_frag_size(const struct mv_pp2x_bm_pool *bm_pool)
+{
+	if (bm_pool->page_ring || bm_pool->frag_size <= PAGE_SIZE)
+		return bm_pool->frag_size;
+	return 0;
+}
+
+/* Page pool.
+ * Pool buffers are whole (compound for jumbo) pages mapped once when
+ * allocated. Page handed to the stack is also kept with an extra reference
+ * on the per-CPU ring of its pool, and goes back to HW still mapped once
+ * the stack dropped the skb. Ring is only accessed from NAPI context.
+ */
+static int mv_pp2x_page_get(struct mv_pp2x_port *port,
+			    struct mv_pp2x_bm_pool *bm_pool,
+			    dma_addr_t *phys_addr, int is_recycle)
+{
+	struct mv_pp2x_pcpu_stats *stats = this_cpu_ptr(port->stats);
+	struct device *dev = port->dev->dev.parent;
+	struct mv_pp2x_page_ring *ring;
+	struct page *page;
+
+	ring = this_cpu_ptr(bm_pool->page_ring);
+	if (is_recycle && ring->count) {
+		struct mv_pp2x_page_buf buf = ring->bufs[ring->head];
+
+		ring->head = (ring->head + 1) & (MVPP2_PAGE_RING_SIZE - 1);
+		if (likely(page_count(buf.page) == 1)) {
+			ring->count--;
+			/* Stack may have written anywhere in the buffer */
+			dma_sync_single_for_device(dev, buf.phys_addr,
+						   MVPP2_RX_BUF_SIZE(bm_pool->pkt_size),
+						   bm_pool->dma_dir);
+			*phys_addr = buf.phys_addr;
+
+			u64_stats_update_begin(&stats->syncp);
+			stats->rx_page_reuse++;
+			u64_stats_update_end(&stats->syncp);
+			return 0;
+		}
+		/* Still owned by the stack, move it to the tail */
+		ring->bufs[(ring->head + ring->count - 1) &
+			   (MVPP2_PAGE_RING_SIZE - 1)] = buf;
+	}
+
+	page = dev_alloc_pages(bm_pool->page_order);
+	if (unlikely(!page))
+		return -ENOMEM;
+
+	*phys_addr = dma_map_page(dev, page, 0, PAGE_SIZE << bm_pool->page_order,
+				  bm_pool->dma_dir);
+	if (unlikely(dma_mapping_error(dev, *phys_addr))) {
+		__free_pages(page, bm_pool->page_order);
+		return -ENOMEM;
+	}
+
+	u64_stats_update_begin(&stats->syncp);
+	stats->rx_page_alloc++;
+	u64_stats_update_end(&stats->syncp);
+	return 0;
+}
+
+/* Keep the page of a received buffer for reuse. Return false if the ring is
+ * full, buffer must be unmapped by the caller in that case.
+ */
+static bool mv_pp2x_page_keep(struct mv_pp2x_bm_pool *bm_pool,
+			      unsigned char *data, dma_addr_t phys_addr)
+{
+	struct mv_pp2x_page_ring *ring = this_cpu_ptr(bm_pool->page_ring);
+	struct page *page = virt_to_head_page(data);
+	struct mv_pp2x_page_buf *buf;
+
+	/* Do not hold on emergency reserves */
+	if (unlikely(ring->count == MVPP2_PAGE_RING_SIZE ||
+		     page_is_pfmemalloc(page)))
+		return false;
+
+	buf = &ring->bufs[(ring->head + ring->count) &
+			  (MVPP2_PAGE_RING_SIZE - 1)];
+	get_page(page);
+	buf->page = page;
+	buf->phys_addr = phys_addr;
+	ring->count++;
+
+	return true;
+}
+
+static void mv_pp2x_page_ring_drain(struct device *dev,
+				    struct mv_pp2x_bm_pool *bm_pool)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct mv_pp2x_page_ring *ring;
+
+		ring = per_cpu_ptr(bm_pool->page_ring, cpu);
+		while (ring->count) {
+			struct mv_pp2x_page_buf *buf = &ring->bufs[ring->head];
+
+			dma_unmap_page(dev, buf->phys_addr,
+				       PAGE_SIZE << bm_pool->page_order,
+				       bm_pool->dma_dir);
+			put_page(buf->page);
+			ring->head = (ring->head + 1) &
+				     (MVPP2_PAGE_RING_SIZE - 1);
+			ring->count--;
+		}
+	}
+}
+
+/* Allocate and map new buffer for the pool */
+static int mv_pp2x_rx_buf_alloc(struct mv_pp2x_port *port,
+				struct mv_pp2x_bm_pool *bm_pool,
+				dma_addr_t *phys_addr, int is_recycle)
+{
+	void *data;
+
+	if (bm_pool->page_ring)
+		return mv_pp2x_page_get(port, bm_pool, phys_addr, is_recycle);
+
+	data = mv_pp2x_frag_alloc(bm_pool);
+	if (!data)
+		return -ENOMEM;
+
+	*phys_addr = dma_map_single(port->dev->dev.parent, data,
+				    MVPP2_RX_BUF_SIZE(bm_pool->pkt_size),
+				    bm_pool->dma_dir);
+
+	if (unlikely(dma_mapping_error(port->dev->dev.parent, *phys_addr))) {
+		mv_pp2x_frag_free(bm_pool, data);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 static int mv_pp2x_rx_refill_new(struct mv_pp2x_port *port,
 				 struct mv_pp2x_bm_pool *bm_pool,
 			   u32 pool, int is_recycle, int cpu)
 {
 	dma_addr_t phys_addr;
-	void *data;
 	struct mv_pp2x_cp_pcpu *cp_pcpu = this_cpu_ptr(port->priv->pcpu);
 
 	/* BM pool is refilled only if number of used buffers is bellow
@@ -333,18 +515,8 @@ static int mv_pp2x_rx_refill_new(struct mv_pp2x_port *port,
 	    (cp_pcpu->in_use[bm_pool->id] < bm_pool->in_use_thresh))
 		return 0;
 
-	data = mv_pp2x_frag_alloc(bm_pool);
-	if (!data)
-		return -ENOMEM;
-
-	phys_addr = dma_map_single(port->dev->dev.parent, data,
-				   MVPP2_RX_BUF_SIZE(bm_pool->pkt_size),
-				   DMA_FROM_DEVICE);
-
-	if (unlikely(dma_mapping_error(port->dev->dev.parent, phys_addr))) {
-		mv_pp2x_frag_free(bm_pool, data);
+	if (mv_pp2x_rx_buf_alloc(port, bm_pool, &phys_addr, is_recycle))
 		return -ENOMEM;
-	}
 
 	mv_pp2x_pool_refill(port->priv, pool, phys_addr, cpu);
 
@@ -355,6 +527,51 @@ static int mv_pp2x_rx_refill_new(struct mv_pp2x_port *port,
 	return 0;
 }
 
+/* Refill BM pool with buffers consumed by RX, same as num calls of
+ * mv_pp2x_rx_refill_new(). Buffers are staged in per-CPU array and released
+ * to BM in bursts of relaxed writes behind a single barrier.
+ * Return number of buffers left unrefilled.
+ */
+static int mv_pp2x_rx_refill_bulk(struct mv_pp2x_port *port,
+				  struct mv_pp2x_bm_pool *bm_pool,
+				  int num, int cpu)
+{
+	struct mv_pp2x_cp_pcpu *cp_pcpu = this_cpu_ptr(port->priv->pcpu);
+	struct mv_pp2x_pcpu_stats *stats = this_cpu_ptr(port->stats);
+	dma_addr_t *stage = cp_pcpu->refill_stage;
+	int refill, done = 0, err = 0;
+
+	/* Buffers recycled by TX are not refilled */
+	refill = cp_pcpu->in_use[bm_pool->id] - bm_pool->in_use_thresh + 1;
+	refill = clamp(refill, 0, num);
+
+	while (done < refill && !err) {
+		int i, batch = min(refill - done, MVPP2_BM_REFILL_BATCH);
+
+		for (i = 0; i < batch; i++) {
+			err = mv_pp2x_rx_buf_alloc(port, bm_pool, &stage[i],
+						   true);
+			if (unlikely(err))
+				break;
+		}
+		if (unlikely(!i))
+			break;
+
+		wmb();
+		mv_pp2x_bm_pool_put_bulk(&port->priv->hw, bm_pool->id, stage,
+					 i, cpu);
+		cp_pcpu->in_use[bm_pool->id] -= i;
+		done += i;
+
+		u64_stats_update_begin(&stats->syncp);
+		stats->rx_refill_bursts++;
+		stats->rx_refill_bufs += i;
+		u64_stats_update_end(&stats->syncp);
+	}
+
+	return err ? num - done : 0;
+}
+
 /* Create pool */
 static int mv_pp2x_bm_pool_create(struct device *dev,
 				  struct mv_pp2x_hw *hw,
@@ -369,13 +586,19 @@ static int mv_pp2x_bm_pool_create(struct device *dev,
 	if (!IS_ALIGNED(size, (1 << MVPP21_BM_POOL_SIZE_OFFSET)))
 		return -EINVAL;
 
+	if (rx_page_pool && !bm_pool->external_pool) {
+		bm_pool->page_ring = alloc_percpu(struct mv_pp2x_page_ring);
+		if (!bm_pool->page_ring)
+			return -ENOMEM;
+	}
+
 	/*YuvalC: Two pointers per buffer, existing bug fixed. */
 	size_bytes = 2 * sizeof(uintptr_t) * size;
 	bm_pool->virt_addr = dma_alloc_coherent(dev, size_bytes,
 						&bm_pool->phys_addr,
 						GFP_KERNEL);
 	if (!bm_pool->virt_addr)
-		return -ENOMEM;
+		goto err_free_ring;
 
 	if (!IS_ALIGNED((uintptr_t)bm_pool->virt_addr,
 			MVPP2_BM_POOL_PTR_ALIGN)) {
@@ -383,7 +606,7 @@ static int mv_pp2x_bm_pool_create(struct device *dev,
 				  bm_pool->phys_addr);
 		dev_err(dev, "BM pool %d is not %d bytes aligned\n",
 			bm_pool->id, MVPP2_BM_POOL_PTR_ALIGN);
-		return -ENOMEM;
+		goto err_free_ring;
 	}
 
 	mv_pp2x_bm_hw_pool_create(hw, bm_pool->id, bm_pool->phys_addr, size);
@@ -393,10 +616,21 @@ static int mv_pp2x_bm_pool_create(struct device *dev,
 	bm_pool->frag_size = SKB_DATA_ALIGN(MVPP2_RX_BUF_SIZE(
 				bm_pool->pkt_size)) + MVPP2_SKB_SHINFO_SIZE;
 	bm_pool->buf_num = 0;
+
+	if (bm_pool->page_ring) {
+		bm_pool->page_order = get_order(bm_pool->frag_size);
+		bm_pool->frag_size = PAGE_SIZE << bm_pool->page_order;
+	}
+
 	mv_pp2x_bm_pool_bufsize_set(hw, bm_pool,
 				    MVPP2_RX_BUF_SIZE(bm_pool->pkt_size));
 
 	return 0;
+
+err_free_ring:
+	free_percpu(bm_pool->page_ring);
+	bm_pool->page_ring = NULL;
+	return -ENOMEM;
 }
 
 void mv_pp2x_bm_bufs_free(struct device *dev, struct mv_pp2x *priv,
@@ -417,9 +651,16 @@ void mv_pp2x_bm_bufs_free(struct device *dev, struct mv_pp2x *priv,
 		phys_addr = mv_pp2x_bm_phys_addr_get(&priv->hw, bm_pool->id);
 		if (!phys_addr)
 			break;
-		if (!bm_pool->external_pool) {
+		if (bm_pool->page_ring) {
+			virt_addr = phys_to_virt(dma_to_phys(dev, phys_addr));
+			dma_unmap_page(dev, phys_addr,
+				       PAGE_SIZE << bm_pool->page_order,
+				       bm_pool->dma_dir);
+			put_page(virt_to_head_page(virt_addr));
+		} else if (!bm_pool->external_pool) {
 			dma_unmap_single(dev, phys_addr,
-					 MVPP2_RX_BUF_SIZE(bm_pool->pkt_size), DMA_TO_DEVICE);
+					 MVPP2_RX_BUF_SIZE(bm_pool->pkt_size),
+					 bm_pool->dma_dir);
 			virt_addr = phys_to_virt(dma_to_phys(dev, phys_addr));
 			mv_pp2x_frag_free(bm_pool, virt_addr);
 		}
@@ -440,6 +681,12 @@ int mv_pp2x_bm_pool_destroy(struct device *dev, struct mv_pp2x *priv,
 
 	mv_pp2x_bm_bufs_free(dev, priv, bm_pool, buf_num);
 
+	if (bm_pool->page_ring) {
+		mv_pp2x_page_ring_drain(dev, bm_pool);
+		free_percpu(bm_pool->page_ring);
+		bm_pool->page_ring = NULL;
+	}
+
 	/* Check buffer counters after free */
 	buf_num = mv_pp2x_check_hw_buf_num(priv, bm_pool);
 
@@ -447,7 +694,7 @@ int mv_pp2x_bm_pool_destroy(struct device *dev, struct mv_pp2x *priv,
 		WARN(1, "cannot free all buffers in pool %d, buf_num left %d\n",
 		     bm_pool->id,
 		     bm_pool->buf_num);
-		return 0;
+		return -EBUSY;
 	}
 
 	val = mv_pp2x_read(&priv->hw, MVPP2_BM_POOL_CTRL_REG(bm_pool->id));
@@ -476,6 +723,11 @@ int mv_pp2x_bm_pool_ext_add(struct device *dev, struct mv_pp2x *priv,
 			priv->num_pools + 1);
 		return -ENOMEM;
 	}
+	if (first_pool + pool >= MVPP2_BM_POOLS_NUM) {
+		dev_err(dev, "Unable to add pool. No HW BM pool past %d\n",
+			first_pool + pool - 1);
+		return -ENOSPC;
+	}
 
 	/* Check if pool is already active. Ignore request */
 	enabled = mv_pp2x_read(hw, MVPP2_BM_POOL_CTRL_REG(pool)) &
@@ -500,6 +752,7 @@ int mv_pp2x_bm_pool_ext_add(struct device *dev, struct mv_pp2x *priv,
 	bm_pool->log_id = pool;
 	bm_pool->id = first_pool + pool;
 	bm_pool->external_pool = true;
+	bm_pool->dma_dir = DMA_FROM_DEVICE;
 	err = mv_pp2x_bm_pool_create(dev, hw, bm_pool, size, pkt_size);
 	if (err)
 		return err;
@@ -524,6 +777,15 @@ static int mv_pp2x_bm_pools_init(struct platform_device *pdev,
 		bm_pool->log_id = i;
 		bm_pool->id = first_pool + i;
 		bm_pool->external_pool = false;
+#ifdef MVPP2_XDP
+		/* Buffers of shared pools can't be remapped once handed to HW,
+		 * map them for XDP_TX from the start. PPv2.1 does not run XDP.
+		 */
+		bm_pool->dma_dir = priv->pp2_version == PPV22 ?
+				   DMA_BIDIRECTIONAL : DMA_FROM_DEVICE;
+#else
+		bm_pool->dma_dir = DMA_FROM_DEVICE;
+#endif
 		err = mv_pp2x_bm_pool_create(&pdev->dev, hw, bm_pool, size,
 					     mv_pp2x_pool_pkt_size_get(bm_pool->log_id));
 		if (err)
@@ -593,10 +855,12 @@ int mv_pp2x_bm_bufs_add(struct mv_pp2x_port *port,
 		return 0;
 	}
 
-	cpu = get_cpu();
+	/* NAPI releases to BM on this CPU must not interleave */
+	local_bh_disable();
+	cpu = smp_processor_id();
 	for (i = 0; i < buf_num; i++)
 		mv_pp2x_rx_refill_new(port, bm_pool, (u32)bm_pool->id, 0, cpu);
-	put_cpu();
+	local_bh_enable();
 
 	/* Update BM driver with number of buffers added to pool */
 	bm_pool->buf_num += i;
@@ -699,6 +963,142 @@ int mv_pp2x_swf_bm_pool_assign(struct mv_pp2x_port *port, u32 rxq,
 	return 0;
 }
 
+/* Hand RXQ over to user space (MUSDK) together with a dedicated BM pool.
+ * Kernel does not allocate the RXQ ring, does not poll the RXQ and never
+ * fills or drains the pool: the owner configures the ring and releases
+ * buffers from its own DMA memory to the pool for zero-copy reception.
+ * Port must be down.
+ */
+int mv_pp2x_rxq_ext_pool_bind(struct mv_pp2x_port *port, u32 rxq_id,
+			      u32 pkt_size, u32 *pool_id)
+{
+	struct mv_pp2x *priv = port->priv;
+	struct mv_pp2x_rx_queue *rxq;
+	u32 log_pool = MVPP2_BM_POOLS_NUM;
+	int err;
+
+	if (rxq_id >= port->num_rx_queues)
+		return -EINVAL;
+
+	if (netif_running(port->dev)) {
+		netdev_err(port->dev, "port must be down to bind rxq %d\n", rxq_id);
+		return -EBUSY;
+	}
+
+	rxq = port->rxqs[rxq_id];
+	if (rxq->ext_pool)
+		return -EEXIST;
+
+#ifdef MVPP2_XDP
+	/* XDP program would miss the frames of the RXQ */
+	if (port->xdp_prog)
+		return -EOPNOTSUPP;
+#endif
+
+	err = mv_pp2x_bm_pool_ext_add(port->dev->dev.parent, priv, &log_pool,
+				      pkt_size);
+	if (err)
+		return err;
+	if (log_pool == MVPP2_BM_POOLS_NUM)
+		return -EBUSY;
+
+	rxq->ext_pool = &priv->bm_pools[log_pool];
+	mv_pp2x_swf_bm_pool_assign(port, rxq_id, rxq->ext_pool->id,
+				   rxq->ext_pool->id);
+
+	/* Owner polls the RXQ, keep occupied interrupt out of kernel way */
+	rxq->pkts_coal = MVPP2_MAX_OCCUPIED_THRESH;
+	mv_pp2x_rx_pkts_coal_set(port, rxq);
+
+	*pool_id = rxq->ext_pool->id;
+
+	return 0;
+}
+EXPORT_SYMBOL(mv_pp2x_rxq_ext_pool_bind);
+
+/* Return RXQ handed over by mv_pp2x_rxq_ext_pool_bind back to kernel */
+int mv_pp2x_rxq_ext_pool_unbind(struct mv_pp2x_port *port, u32 rxq_id)
+{
+	struct mv_pp2x *priv = port->priv;
+	struct mv_pp2x_bm_pool *bm_pool;
+	struct mv_pp2x_rx_queue *rxq;
+	int err;
+
+	if (rxq_id >= port->num_rx_queues)
+		return -EINVAL;
+
+	if (netif_running(port->dev)) {
+		netdev_err(port->dev, "port must be down to unbind rxq %d\n", rxq_id);
+		return -EBUSY;
+	}
+
+	rxq = port->rxqs[rxq_id];
+	bm_pool = rxq->ext_pool;
+	if (!bm_pool)
+		return -EINVAL;
+
+	/* External pools are allocated on top of SWF pools in stack order */
+	if (bm_pool->log_id != priv->num_pools - 1) {
+		netdev_err(port->dev, "pool %d should be unbound after pool %d\n",
+			   bm_pool->id, priv->bm_pools[priv->num_pools - 1].id);
+		return -EBUSY;
+	}
+
+	/* Buffers belong to the owner, only drop them from the HW pool.
+	 * RXQ stays bound to the pool if it can't be emptied.
+	 */
+	bm_pool->buf_num = mv_pp2x_check_hw_buf_num(priv, bm_pool);
+	err = mv_pp2x_bm_pool_destroy(port->dev->dev.parent, priv, bm_pool);
+	if (err) {
+		netdev_err(port->dev, "pool %d of rxq %d is not empty\n",
+			   bm_pool->id, rxq_id);
+		return err;
+	}
+
+	rxq->ext_pool = NULL;
+	mv_pp2x_swf_bm_pool_assign(port, rxq_id, port->pool_long->id,
+				   port->pool_short->id);
+
+	rxq->pkts_coal = MVPP2_RX_COAL_PKTS;
+
+	return 0;
+}
+EXPORT_SYMBOL(mv_pp2x_rxq_ext_pool_unbind);
+
+/* Unbind external pools left bound by their owner, top of the pool stack
+ * first. Pools stacked under a pool of another port stay bound.
+ */
+static void mv_pp2x_port_ext_pools_unbind(struct mv_pp2x_port *port)
+{
+	struct mv_pp2x *priv = port->priv;
+	bool unbound;
+	int rxq;
+
+	do {
+		unbound = false;
+		for (rxq = 0; rxq < port->num_rx_queues; rxq++) {
+			struct mv_pp2x_bm_pool *bm_pool = port->rxqs[rxq]->ext_pool;
+
+			if (!bm_pool || bm_pool->log_id != priv->num_pools - 1)
+				continue;
+			if (mv_pp2x_rxq_ext_pool_unbind(port, rxq))
+				return;
+			unbound = true;
+		}
+	} while (unbound);
+
+	for (rxq = 0; rxq < port->num_rx_queues; rxq++)
+		if (port->rxqs[rxq]->ext_pool)
+			netdev_warn(port->dev, "rxq %d is left bound to pool %d\n",
+				    rxq, port->rxqs[rxq]->ext_pool->id);
+}
+
+/* Dedicated jumbo pool is not used when HW chains long pool buffers */
+static inline bool mv_pp2x_jumbo_pool_needed(int pkt_size)
+{
+	return pkt_size > MVPP2_BM_LONG_PKT_SIZE && !rx_multi_buf;
+}
+
 /* Initialize pools for swf */
 static int mv_pp2x_swf_bm_pool_init(struct mv_pp2x_port *port)
 {
@@ -710,7 +1110,7 @@ static int mv_pp2x_swf_bm_pool_init(struct mv_pp2x_port *port)
 	* HW Long pool - SW Jumbo pool, HW Short pool - SW Short pool
 	* esle: HW Long pool - SW Long pool, HW Short pool - SW Short pool
 	*/
-	if (port->pkt_size > MVPP2_BM_LONG_PKT_SIZE) {
+	if (mv_pp2x_jumbo_pool_needed(port->pkt_size)) {
 		long_log_pool = MVPP2_BM_SWF_JUMBO_POOL;
 		short_log_pool = MVPP2_BM_SWF_LONG_POOL;
 	} else {
@@ -726,6 +1126,8 @@ static int mv_pp2x_swf_bm_pool_init(struct mv_pp2x_port *port)
 		port->pool_long->port_map |= (1 << port->id);
 
 		for (rxq = 0; rxq < port->num_rx_queues; rxq++) {
+			if (port->rxqs[rxq]->ext_pool)
+				continue;
 			port->priv->pp2xdata->mv_pp2x_rxq_long_pool_set(hw,
 				port->rxqs[rxq]->id, port->pool_long->id);
 		}
@@ -739,9 +1141,12 @@ static int mv_pp2x_swf_bm_pool_init(struct mv_pp2x_port *port)
 
 		port->pool_short->port_map |= (1 << port->id);
 
-		for (rxq = 0; rxq < port->num_rx_queues; rxq++)
+		for (rxq = 0; rxq < port->num_rx_queues; rxq++) {
+			if (port->rxqs[rxq]->ext_pool)
+				continue;
 			port->priv->pp2xdata->mv_pp2x_rxq_short_pool_set(hw,
 			port->rxqs[rxq]->id, port->pool_short->id);
+		}
 	}
 
 	return 0;
@@ -757,6 +1162,7 @@ static int mv_pp2x_bm_update_mtu(struct net_device *dev, int mtu)
 	enum mv_pp2x_bm_pool_log_num new_short_pool, old_short_pool;
 	int rxq;
 	int pkt_size = MVPP2_RX_PKT_SIZE(mtu);
+	bool jumbo = pkt_size > MVPP2_BM_LONG_PKT_SIZE;
 
 	old_long_pool = old_long_port_pool->log_id;
 
@@ -764,7 +1170,7 @@ static int mv_pp2x_bm_update_mtu(struct net_device *dev, int mtu)
 	* HW Long pool - SW Jumbo pool, HW Short pool - SW Short pool
 	* esle: HW Long pool - SW Long pool, HW Short pool - SW Short pool
 	*/
-	if (pkt_size > MVPP2_BM_LONG_PKT_SIZE) {
+	if (mv_pp2x_jumbo_pool_needed(pkt_size)) {
 		new_long_pool = MVPP2_BM_SWF_JUMBO_POOL;
 		new_short_pool = MVPP2_BM_SWF_LONG_POOL;
 	} else {
@@ -778,17 +1184,23 @@ static int mv_pp2x_bm_update_mtu(struct net_device *dev, int mtu)
 		if (!port->pool_long)
 			return -ENOMEM;
 		port->pool_long->port_map |= (1 << port->id);
-		for (rxq = 0; rxq < port->num_rx_queues; rxq++)
+		for (rxq = 0; rxq < port->num_rx_queues; rxq++) {
+			if (port->rxqs[rxq]->ext_pool)
+				continue;
 			port->priv->pp2xdata->mv_pp2x_rxq_long_pool_set(hw,
 			port->rxqs[rxq]->id, port->pool_long->id);
+		}
 
 		port->pool_short = mv_pp2x_bm_pool_use(port, new_short_pool);
 		if (!port->pool_short)
 			return -ENOMEM;
 		port->pool_short->port_map |= (1 << port->id);
-		for (rxq = 0; rxq < port->num_rx_queues; rxq++)
+		for (rxq = 0; rxq < port->num_rx_queues; rxq++) {
+			if (port->rxqs[rxq]->ext_pool)
+				continue;
 			port->priv->pp2xdata->mv_pp2x_rxq_short_pool_set(hw,
 			port->rxqs[rxq]->id, port->pool_short->id);
+		}
 
 		/* Remove port from old short&long pool */
 		mv_pp2x_bm_pool_stop_use(port, old_long_pool);
@@ -796,9 +1208,11 @@ static int mv_pp2x_bm_update_mtu(struct net_device *dev, int mtu)
 
 		mv_pp2x_bm_pool_stop_use(port, old_short_pool);
 		old_short_port_pool->port_map &= ~(1 << port->id);
+	}
 
-		/* Update L4 checksum when jumbo enable/disable on port */
-		if (new_long_pool == MVPP2_BM_SWF_JUMBO_POOL) {
+	/* Update L4 checksum when jumbo enable/disable on port */
+	if (jumbo != (MVPP2_RX_PKT_SIZE(dev->mtu) > MVPP2_BM_LONG_PKT_SIZE)) {
+		if (jumbo) {
 			if (port->id != port->priv->l4_chksum_jumbo_port) {
 				dev->features &=
 					~(NETIF_F_IP_CSUM | NETIF_F_IPV6_CSUM);
@@ -876,93 +1290,22 @@ static void mv_pp2x_defaults_set(struct mv_pp2x_port *port)
 	mv_pp2x_port_interrupts_disable(port);
 }
 
-static inline void *mv_pp2_extra_pool_get(struct mv_pp2x_port *port)
-{
-	void *ext_buf;
-	struct mv_pp2x_port_pcpu *port_pcpu = this_cpu_ptr(port->pcpu);
-	struct mv_pp2x_ext_buf_struct *ext_buf_struct;
-
-	if (!list_empty(&port_pcpu->ext_buf_port_list)) {
-		ext_buf_struct = list_last_entry(&port_pcpu->ext_buf_port_list,
-						 struct mv_pp2x_ext_buf_struct, ext_buf_list);
-		list_del(&ext_buf_struct->ext_buf_list);
-		port_pcpu->ext_buf_pool->buf_pool_in_use--;
-
-		ext_buf = ext_buf_struct->ext_buf_data;
-
-	} else {
-		ext_buf = kmalloc(MVPP2_EXTRA_BUF_SIZE, GFP_ATOMIC);
-	}
-
-	return ext_buf;
-}
-
-static inline int mv_pp2_extra_pool_put(struct mv_pp2x_port *port, void *ext_buf,
-					int cpu)
-{
-	struct mv_pp2x_port_pcpu *port_pcpu = per_cpu_ptr(port->pcpu, cpu);
-	struct mv_pp2x_ext_buf_struct *ext_buf_struct;
-
-	if (port_pcpu->ext_buf_pool->buf_pool_in_use >= port_pcpu->ext_buf_pool->buf_pool_size) {
-		kfree(ext_buf);
-		return 1;
-	}
-	port_pcpu->ext_buf_pool->buf_pool_in_use++;
-
-	ext_buf_struct =
-		&port_pcpu->ext_buf_pool->ext_buf_struct[port_pcpu->ext_buf_pool->buf_pool_next_free];
-	mv_pp2x_extra_pool_inc(port_pcpu->ext_buf_pool);
-	ext_buf_struct->ext_buf_data = ext_buf;
-
-	list_add(&ext_buf_struct->ext_buf_list,
-		 &port_pcpu->ext_buf_port_list);
-
-	return 0;
-}
-
 static inline struct sk_buff *mv_pp2_skb_pool_get(struct mv_pp2x_port *port)
 {
-	struct sk_buff *skb;
 	struct mv_pp2x_cp_pcpu *cp_pcpu = this_cpu_ptr(port->priv->pcpu);
-	struct mv_pp2x_skb_struct *skb_struct;
-
-	if (!list_empty(&cp_pcpu->skb_port_list)) {
-		skb_struct = list_last_entry(&cp_pcpu->skb_port_list,
-					     struct mv_pp2x_skb_struct, skb_list);
-		list_del(&skb_struct->skb_list);
-		cp_pcpu->skb_pool->skb_pool_in_use--;
 
-		skb = skb_struct->skb;
-
-	} else {
-		skb = NULL;
-	}
-
-	return skb;
+	return mv_pp2x_obj_cache_get(&cp_pcpu->skb_pool);
 }
 
-static inline int mv_pp2_skb_pool_put(struct mv_pp2x_port *port, struct sk_buff *skb,
-				      int cpu)
+static void mv_pp2_skb_pool_put_bulk(struct mv_pp2x_port *port,
+				     struct sk_buff **skbs, int num, int cpu)
 {
 	struct mv_pp2x_cp_pcpu *cp_pcpu = per_cpu_ptr(port->priv->pcpu, cpu);
-	struct mv_pp2x_skb_struct *skb_struct;
-
-	if (cp_pcpu->skb_pool->skb_pool_in_use >= cp_pcpu->skb_pool->skb_pool_size) {
-		dev_kfree_skb_any(skb);
-		return 1;
-	}
-	cp_pcpu->skb_pool->skb_pool_in_use++;
-
-	skb_struct =
-		&cp_pcpu->skb_pool->skb_struct[cp_pcpu->skb_pool->skb_pool_next_free];
-	mv_pp2x_skb_pool_inc(cp_pcpu->skb_pool);
-
-	skb_struct->skb = skb;
-
-	list_add(&skb_struct->skb_list,
-		 &cp_pcpu->skb_port_list);
+	int i;
 
-	return 0;
+	i = mv_pp2x_obj_cache_put_bulk(&cp_pcpu->skb_pool, (void **)skbs, num);
+	for (; i < num; i++)
+		dev_kfree_skb_any(skbs[i]);
 }
 
 /* Check if there are enough reserved descriptors for transmission.
@@ -1054,85 +1397,136 @@ int mv_pp2x_tso_txq_reserved_desc_num_proc(
  * mapping failures in the Tx path.
  */
 
-/* Free Tx queue skbuffs */
-static void mv_pp2x_txq_bufs_free(struct mv_pp2x_port *port,
-				  struct mv_pp2x_txq_pcpu *txq_pcpu,
-				  int num)
+/* Netdev TX queue served by the per-CPU TXQ of cpu */
+static inline struct netdev_queue *mv_pp2x_txq_pcpu_nq(struct mv_pp2x_port *port,
+						       struct mv_pp2x_tx_queue *txq,
+						       int cpu)
 {
-	int i;
+	return netdev_get_tx_queue(port->dev,
+				   mv_pp2x_txq_ndev_queue(port, txq->log_id, cpu));
+}
+
+/* Account sent skb to BQL of the netdev queue completed by this CPU.
+ * Returns whether doorbell could still be deferred: once BQL stopped the
+ * queue, the stack does not send the packets announced by xmit_more.
+ */
+static inline bool mv_pp2x_tx_bql_sent(struct mv_pp2x_port *port,
+				       struct mv_pp2x_tx_queue *txq,
+				       struct sk_buff *skb, int cpu)
+{
+	struct netdev_queue *nq = mv_pp2x_txq_pcpu_nq(port, txq, cpu);
+
+	netdev_tx_sent_queue(nq, skb->len);
+
+	return skb->xmit_more && !netif_xmit_stopped(nq);
+}
+
+/* Free Tx queue skbuffs. Non zero NAPI budget allows skbs to be bulk freed.
+ * Returns the number of completed packets, their length is added to bytes.
+ */
+static unsigned int mv_pp2x_txq_bufs_free(struct mv_pp2x_port *port,
+					  struct mv_pp2x_txq_pcpu *txq_pcpu,
+					  int num, int budget,
+					  unsigned int *bytes)
+{
+	struct sk_buff *rec_skbs[MVPP2_OBJ_CACHE_BULK];
+	unsigned int pkts = 0;
+	int i, rec_num = 0;
 
 	for (i = 0; i < num; i++) {
-		dma_addr_t buf_phys_addr =
-				    txq_pcpu->tx_buffs[txq_pcpu->txq_get_index];
-		uintptr_t skb = (uintptr_t)txq_pcpu->tx_skb[txq_pcpu->txq_get_index];
-		int data_size = txq_pcpu->data_size[txq_pcpu->txq_get_index];
-		struct sk_buff *skb_rec;
-
-		if (skb & MVPP2_ETH_SHADOW_EXT) {
-			/* Refill TSO external pool */
-			skb &= ~MVPP2_ETH_SHADOW_EXT;
-			mv_pp2_extra_pool_put(port, (void *)skb, txq_pcpu->cpu);
-			mv_pp2x_txq_inc_get(txq_pcpu);
-			dma_unmap_single(port->dev->dev.parent, buf_phys_addr,
-					 data_size, DMA_TO_DEVICE);
-			continue;
-		} else if (skb & MVPP2_ETH_SHADOW_REC) {
+		struct mv_pp2x_tx_shadow *shadow =
+				&txq_pcpu->shadow[txq_pcpu->txq_get_index];
+		int ahead = txq_pcpu->txq_get_index + MVPP2_TX_SHADOW_PREFETCH;
+
+		if (ahead >= txq_pcpu->size)
+			ahead -= txq_pcpu->size;
+		prefetch(&txq_pcpu->shadow[ahead]);
+
+		switch (shadow->type) {
+		case MVPP2_ETH_SHADOW_EXT:
+			/* TSO header lives in the coherent header area */
+		case MVPP2_ETH_SHADOW_XDP:
+			/* XDP_TX buffer is released by HW directly to its BM pool */
+			break;
+		case MVPP2_ETH_SHADOW_REC: {
 			/* Release skb without data buffer, if data buffer were marked as
 			 * recycled in TX routine.
 			 */
-			struct mv_pp2x_bm_pool *bm_pool;
 			struct mv_pp2x_cp_pcpu *cp_pcpu = this_cpu_ptr(port->priv->pcpu);
+			struct sk_buff *skb_rec = shadow->cookie;
+			struct mv_pp2x_bm_pool *bm_pool;
 
-			skb &= ~MVPP2_ETH_SHADOW_REC;
-			skb_rec = (struct sk_buff *)skb;
+			pkts++;
+			*bytes += skb_rec->len;
 			bm_pool = &port->priv->bm_pools[MVPP2X_SKB_BPID_GET(skb_rec)];
 			/* Do not release buffer of recycled skb */
 			skb_rec->head = NULL;
 			cp_pcpu->in_use[bm_pool->id]--;
 
-			mv_pp2_skb_pool_put(port, (struct sk_buff *)skb, txq_pcpu->cpu);
-
-			mv_pp2x_txq_inc_get(txq_pcpu);
-			continue;
+			rec_skbs[rec_num++] = skb_rec;
+			if (unlikely(rec_num == MVPP2_OBJ_CACHE_BULK)) {
+				mv_pp2_skb_pool_put_bulk(port, rec_skbs, rec_num,
+							 txq_pcpu->cpu);
+				rec_num = 0;
+			}
+			break;
 		}
-
-		dma_unmap_single(port->dev->dev.parent, buf_phys_addr,
-				 data_size, DMA_TO_DEVICE);
-
-		if (skb & MVPP2_ETH_SHADOW_SKB) {
-			skb &= ~MVPP2_ETH_SHADOW_SKB;
-			dev_kfree_skb_any((struct sk_buff *)skb);
+		case MVPP2_ETH_SHADOW_PAGE:
+			/* Fragment reference taken over from recycled skb */
+			dma_unmap_single(port->dev->dev.parent,
+					 mv_pp2x_tx_shadow_phys_addr(shadow),
+					 shadow->data_size, DMA_TO_DEVICE);
+			put_page(shadow->cookie);
+			break;
+		case MVPP2_ETH_SHADOW_SKB:
+			dma_unmap_single(port->dev->dev.parent,
+					 mv_pp2x_tx_shadow_phys_addr(shadow),
+					 shadow->data_size, DMA_TO_DEVICE);
+			pkts++;
+			*bytes += ((struct sk_buff *)shadow->cookie)->len;
+#ifdef MVPP2_NAPI_CONSUME
+			napi_consume_skb(shadow->cookie, budget);
+#else
+			dev_kfree_skb_any(shadow->cookie);
+#endif
+			break;
+		default:
+			dma_unmap_single(port->dev->dev.parent,
+					 mv_pp2x_tx_shadow_phys_addr(shadow),
+					 shadow->data_size, DMA_TO_DEVICE);
+			break;
 		}
 		mv_pp2x_txq_inc_get(txq_pcpu);
 	}
+
+	if (rec_num)
+		mv_pp2_skb_pool_put_bulk(port, rec_skbs, rec_num, txq_pcpu->cpu);
+
+	return pkts;
 }
 
-static void mv_pp2x_txq_buf_free(struct mv_pp2x_port *port, uintptr_t skb,
-				 dma_addr_t  buf_phys_addr, int data_size,
-				 int cpu)
+static void mv_pp2x_txq_buf_free(struct mv_pp2x_port *port,
+				 struct mv_pp2x_tx_shadow *shadow)
 {
-	dma_unmap_single(port->dev->dev.parent, buf_phys_addr,
-			 data_size, DMA_TO_DEVICE);
-
-	if (skb & MVPP2_ETH_SHADOW_EXT) {
-		skb &= ~MVPP2_ETH_SHADOW_EXT;
-		mv_pp2_extra_pool_put(port, (void *)skb, cpu);
+	if (shadow->type == MVPP2_ETH_SHADOW_EXT)
 		return;
-	}
 
-	if (skb & MVPP2_ETH_SHADOW_SKB) {
-		skb &= ~MVPP2_ETH_SHADOW_SKB;
-		dev_kfree_skb_any((struct sk_buff *)skb);
-	}
+	dma_unmap_single(port->dev->dev.parent,
+			 mv_pp2x_tx_shadow_phys_addr(shadow),
+			 shadow->data_size, DMA_TO_DEVICE);
+
+	if (shadow->type == MVPP2_ETH_SHADOW_SKB)
+		dev_kfree_skb_any(shadow->cookie);
 }
 
 /* Handle end of transmission */
 static void mv_pp2x_txq_done(struct mv_pp2x_port *port,
 			     struct mv_pp2x_tx_queue *txq,
-				   struct mv_pp2x_txq_pcpu *txq_pcpu)
+			     struct mv_pp2x_txq_pcpu *txq_pcpu, int budget)
 {
-	struct netdev_queue *nq = netdev_get_tx_queue(port->dev, (txq->log_id +
-						     (txq_pcpu->cpu * mv_pp2x_txq_number)));
+	struct netdev_queue *nq = mv_pp2x_txq_pcpu_nq(port, txq, txq_pcpu->cpu);
+	struct mv_pp2x_pcpu_stats *stats = this_cpu_ptr(port->stats);
+	unsigned int pkts, bytes = 0;
 	int tx_done;
 
 #ifdef DEV_NETMAP
@@ -1148,7 +1542,13 @@ static void mv_pp2x_txq_done(struct mv_pp2x_port *port,
 	if (!tx_done)
 		return;
 
-	mv_pp2x_txq_bufs_free(port, txq_pcpu, tx_done);
+	pkts = mv_pp2x_txq_bufs_free(port, txq_pcpu, tx_done, budget, &bytes);
+	netdev_tx_completed_queue(nq, pkts, bytes);
+
+	u64_stats_update_begin(&stats->syncp);
+	stats->tx_done_batches++;
+	stats->tx_done_descs += tx_done;
+	u64_stats_update_end(&stats->syncp);
 
 	if (netif_tx_queue_stopped(nq))
 		if (mv_pp2x_txq_free_count(txq_pcpu) >= port->txq_stop_limit)
@@ -1156,7 +1556,7 @@ static void mv_pp2x_txq_done(struct mv_pp2x_port *port,
 }
 
 static unsigned int mv_pp2x_tx_done(struct mv_pp2x_port *port, u32 cause,
-				    int cpu)
+				    int cpu, int budget)
 {
 	struct mv_pp2x_tx_queue *txq;
 	struct mv_pp2x_txq_pcpu *txq_pcpu;
@@ -1173,7 +1573,7 @@ static unsigned int mv_pp2x_tx_done(struct mv_pp2x_port *port, u32 cause,
 		txq_count = mv_pp2x_txq_count(txq_pcpu);
 
 		if (txq_count) {
-			mv_pp2x_txq_done(port, txq, txq_pcpu);
+			mv_pp2x_txq_done(port, txq, txq_pcpu, budget);
 			/*Recalc after tx_done*/
 			txq_count = mv_pp2x_txq_count(txq_pcpu);
 
@@ -1281,7 +1681,7 @@ static void mv_pp2x_rxq_drop_pkts(struct mv_pp2x_port *port,
 	u8 *buf_cookie;
 	dma_addr_t buf_phys_addr;
 	struct mv_pp2x_bm_pool *bm_pool;
-	struct mv_pp2x_cp_pcpu *cp_pcpu = this_cpu_ptr(port->priv->pcpu);
+	struct mv_pp2x_cp_pcpu *cp_pcpu;
 
 	preempt_disable();
 	rx_received = mv_pp2x_rxq_received(port, rxq->id);
@@ -1289,7 +1689,10 @@ static void mv_pp2x_rxq_drop_pkts(struct mv_pp2x_port *port,
 	if (!rx_received)
 		return;
 
-	cpu = get_cpu();
+	/* NAPI releases to BM on this CPU must not interleave */
+	local_bh_disable();
+	cpu = smp_processor_id();
+	cp_pcpu = this_cpu_ptr(port->priv->pcpu);
 	for (i = 0; i < rx_received; i++) {
 		struct mv_pp2x_rx_desc *rx_desc =
 			mv_pp2x_rxq_next_desc_get(rxq);
@@ -1314,7 +1717,7 @@ static void mv_pp2x_rxq_drop_pkts(struct mv_pp2x_port *port,
 				    buf_phys_addr, cpu);
 		cp_pcpu->in_use[bm_pool->id]--;
 	}
-	put_cpu();
+	local_bh_enable();
 	mv_pp2x_rxq_status_update(port, rxq->id, rx_received, rx_received);
 }
 
@@ -1326,11 +1729,12 @@ static void mv_pp2x_rxq_deinit(struct mv_pp2x_port *port,
 
 	mv_pp2x_rxq_drop_pkts(port, rxq);
 
-	if (rxq->desc_mem)
+	if (rxq->desc_mem) {
 		dma_free_coherent(port->dev->dev.parent,
 				  MVPP2_DESCQ_MEM_SIZE(rxq->size),
 				  rxq->desc_mem,
 				  rxq->descs_phys);
+	}
 
 	rxq->first_desc		= NULL;
 	rxq->desc_mem		= NULL;
@@ -1352,7 +1756,7 @@ static int mv_pp2x_txq_init(struct mv_pp2x_port *port,
 			    struct mv_pp2x_tx_queue *txq)
 {
 	u32 val;
-	int cpu, desc, desc_per_txq, tx_port_num;
+	int cpu, desc, desc_per_txq;
 	struct mv_pp2x_hw *hw = &port->priv->hw;
 	struct mv_pp2x_txq_pcpu *txq_pcpu;
 	dma_addr_t first_desc_phy;
@@ -1398,37 +1802,24 @@ static int mv_pp2x_txq_init(struct mv_pp2x_port *port,
 		      MVPP2_PREF_BUF_PTR(desc) | MVPP2_PREF_BUF_SIZE_16 |
 		      MVPP2_PREF_BUF_THRESH(desc_per_txq / 2));
 
-	/* WRR / EJP configuration - indirect access */
-	tx_port_num = mv_pp2x_egress_port(port);
-	mv_pp2x_write(hw, MVPP2_TXP_SCHED_PORT_INDEX_REG, tx_port_num);
-
-	val = mv_pp2x_read(hw, MVPP2_TXQ_SCHED_REFILL_REG(txq->log_id));
-	val &= ~MVPP2_TXQ_REFILL_PERIOD_ALL_MASK;
-	val |= MVPP2_TXQ_REFILL_PERIOD_MASK(1);
-	val |= MVPP2_TXQ_REFILL_TOKENS_ALL_MASK;
-	mv_pp2x_write(hw, MVPP2_TXQ_SCHED_REFILL_REG(txq->log_id), val);
-
-	val = MVPP2_TXQ_TOKEN_SIZE_MAX;
-	mv_pp2x_write(hw, MVPP2_TXQ_SCHED_TOKEN_SIZE_REG(txq->log_id),
-		      val);
+	/* TXQ shaper, open unless tx_maxrate was set */
+	mv_pp2x_txq_rate_set(port, txq->log_id,
+			     port->txq_maxrate[txq->log_id]);
 
 	for_each_present_cpu(cpu) {
 		txq_pcpu = per_cpu_ptr(txq->pcpu, cpu);
 		txq_pcpu->size = txq->size;
-		txq_pcpu->tx_skb = kmalloc(txq_pcpu->size *
-					   sizeof(*txq_pcpu->tx_skb),
+		txq_pcpu->shadow = kmalloc(txq_pcpu->size *
+					   sizeof(*txq_pcpu->shadow),
 					   GFP_KERNEL);
-		if (!txq_pcpu->tx_skb)
-			goto error;
-
-		txq_pcpu->tx_buffs = kmalloc(txq_pcpu->size *
-					     sizeof(dma_addr_t), GFP_KERNEL);
-		if (!txq_pcpu->tx_buffs)
+		if (!txq_pcpu->shadow)
 			goto error;
 
-		txq_pcpu->data_size = kmalloc(txq_pcpu->size *
-						sizeof(int), GFP_KERNEL);
-		if (!txq_pcpu->data_size)
+		txq_pcpu->tso_hdrs = dma_alloc_coherent(port->dev->dev.parent,
+							txq_pcpu->size * MVPP2_TSO_HDR_SIZE,
+							&txq_pcpu->tso_hdrs_phys,
+							GFP_KERNEL);
+		if (!txq_pcpu->tso_hdrs)
 			goto error;
 
 		txq_pcpu->reserved_num = 0;
@@ -1441,9 +1832,14 @@ static int mv_pp2x_txq_init(struct mv_pp2x_port *port,
 error:
 	for_each_present_cpu(cpu) {
 		txq_pcpu = per_cpu_ptr(txq->pcpu, cpu);
-		kfree(txq_pcpu->tx_skb);
-		kfree(txq_pcpu->tx_buffs);
-		kfree(txq_pcpu->data_size);
+		kfree(txq_pcpu->shadow);
+		txq_pcpu->shadow = NULL;
+		if (txq_pcpu->tso_hdrs)
+			dma_free_coherent(port->dev->dev.parent,
+					  txq_pcpu->size * MVPP2_TSO_HDR_SIZE,
+					  txq_pcpu->tso_hdrs,
+					  txq_pcpu->tso_hdrs_phys);
+		txq_pcpu->tso_hdrs = NULL;
 	}
 
 	dma_free_coherent(port->dev->dev.parent,
@@ -1464,10 +1860,16 @@ static void mv_pp2x_txq_deinit(struct mv_pp2x_port *port,
 	for_each_present_cpu(cpu) {
 		preempt_disable();
 		txq_pcpu = per_cpu_ptr(txq->pcpu, cpu);
-		kfree(txq_pcpu->tx_skb);
-		kfree(txq_pcpu->tx_buffs);
-		kfree(txq_pcpu->data_size);
+		kfree(txq_pcpu->shadow);
+		txq_pcpu->shadow = NULL;
 		preempt_enable();
+
+		if (txq_pcpu->tso_hdrs)
+			dma_free_coherent(port->dev->dev.parent,
+					  txq_pcpu->size * MVPP2_TSO_HDR_SIZE,
+					  txq_pcpu->tso_hdrs,
+					  txq_pcpu->tso_hdrs_phys);
+		txq_pcpu->tso_hdrs = NULL;
 	}
 
 	if (txq->desc_mem)
@@ -1548,6 +1950,7 @@ static void mv_pp2x_txq_clean(struct mv_pp2x_port *port,
 	mv_pp2x_write(hw, MVPP2_TXQ_PREF_BUF_REG, val);
 
 	for_each_present_cpu(cpu) {
+		unsigned int bytes = 0;
 		int txq_count;
 
 		preempt_disable();
@@ -1555,11 +1958,13 @@ static void mv_pp2x_txq_clean(struct mv_pp2x_port *port,
 
 		/* Release all packets */
 		txq_count = mv_pp2x_txq_count(txq_pcpu);
-		mv_pp2x_txq_bufs_free(port, txq_pcpu, txq_count);
+		mv_pp2x_txq_bufs_free(port, txq_pcpu, txq_count, 0, &bytes);
 
 		/* Reset queue */
 		txq_pcpu->txq_put_index = 0;
 		txq_pcpu->txq_get_index = 0;
+		if (cpu < mv_pp2x_txq_ncpus(port))
+			netdev_tx_reset_queue(mv_pp2x_txq_pcpu_nq(port, txq, cpu));
 		preempt_enable();
 	}
 }
@@ -1606,8 +2011,12 @@ void mv_pp2x_cleanup_rxqs(struct mv_pp2x_port *port)
 {
 	int queue;
 
-	for (queue = 0; queue < port->num_rx_queues; queue++)
+	for (queue = 0; queue < port->num_rx_queues; queue++) {
+		/* RXQ handed over to user space is not owned by kernel */
+		if (port->rxqs[queue]->ext_pool)
+			continue;
 		mv_pp2x_rxq_deinit(port, port->rxqs[queue]);
+	}
 }
 
 /* Init all Rx queues for port */
@@ -1616,6 +2025,8 @@ int mv_pp2x_setup_rxqs(struct mv_pp2x_port *port)
 	int queue, err;
 
 	for (queue = 0; queue < port->num_rx_queues; queue++) {
+		if (port->rxqs[queue]->ext_pool)
+			continue;
 		err = mv_pp2x_rxq_init(port, port->rxqs[queue]);
 		if (err)
 			goto err_cleanup;
@@ -1665,10 +2076,261 @@ err_cleanup:
 	return err;
 }
 
+#ifdef CONFIG_RFS_ACCEL
+/* Accelerated RFS: RPS asks, through ndo_rx_flow_steer, to steer a flow to
+ * the RX queue of the CPU consuming it. Each such flow gets a C3 exact match
+ * entry (IPv4 5-tuple) overriding the RSS queue. C3 accesses are indirect
+ * and poll for HW completion, so the HW update is done from a work item.
+ */
+static u8 mv_pp2x_arfs_phys_rxq(struct mv_pp2x_port *port, u16 rxq_index)
+{
+	struct queue_vector *q_vec = &port->q_vector[rxq_index];
+	int queue;
+
+	queue = q_vec->first_rx_queue +
+		mv_pp2x_cosval_queue_map(port, port->cos_cfg.default_cos);
+
+	return port->rxqs[queue]->id;
+}
+
+static void mv_pp2x_arfs_filter_free(struct mv_pp2x_hw *hw,
+				     struct mv_pp2x_arfs_filter *filter)
+{
+	if (filter->c3_idx >= 0)
+		mv_pp2x_cls_c3_arfs_del(hw, filter->c3_idx);
+	hash_del(&filter->node);
+	filter->c3_idx = -1;
+	filter->pending = false;
+	filter->used = false;
+}
+
+/* Program pending filter or expire it, return true if filter is kept.
+ * Called with hw->c3_lock held.
+ */
+static bool mv_pp2x_arfs_filter_update(struct mv_pp2x_port *port,
+				       struct mv_pp2x_arfs_filter *filter,
+				       int id, bool expire)
+{
+	struct mv_pp2x_hw *hw = &port->priv->hw;
+
+	if (filter->pending) {
+		if (filter->c3_idx >= 0)
+			mv_pp2x_cls_c3_arfs_del(hw, filter->c3_idx);
+		filter->c3_idx = mv_pp2x_cls_c3_arfs_add(hw, port->id,
+			&filter->flow,
+			mv_pp2x_arfs_phys_rxq(port, filter->rxq_index));
+		if (filter->c3_idx < 0)
+			filter->c3_idx = -1;
+		filter->pending = false;
+	} else if (expire) {
+		/* A flow hit since the last scan is kept without asking RPS */
+		if (filter->c3_idx >= 0 &&
+		    mv_pp2x_cls_c3_hits_get(hw, filter->c3_idx))
+			return true;
+		if (rps_may_expire_flow(port->dev, filter->rxq_index,
+					filter->flow_id, id)) {
+			mv_pp2x_arfs_filter_free(hw, filter);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void mv_pp2x_arfs_work(struct work_struct *work)
+{
+	struct mv_pp2x_arfs *arfs = container_of(to_delayed_work(work),
+						 struct mv_pp2x_arfs, work);
+	struct mv_pp2x_port *port = arfs->port;
+	struct mv_pp2x_hw *hw = &port->priv->hw;
+	struct mv_pp2x_arfs_filter *filter;
+	bool expire, active = false;
+	int i;
+
+	expire = time_after_eq(jiffies, arfs->expire_time);
+	if (expire)
+		arfs->expire_time = jiffies + MVPP2_ARFS_EXPIRE_PERIOD;
+
+	/* C3 accesses busy-poll HW, lock is taken per filter to let RX
+	 * softirq steering requests and other C3 users in between.
+	 */
+	for (i = 0; i < MVPP2_ARFS_FILTERS; i++) {
+		filter = &arfs->filters[i];
+
+		spin_lock_bh(&hw->c3_lock);
+		if (filter->used &&
+		    mv_pp2x_arfs_filter_update(port, filter, i, expire))
+			active = true;
+		spin_unlock_bh(&hw->c3_lock);
+	}
+
+	if (active)
+		queue_delayed_work(system_wq, &arfs->work,
+				   MVPP2_ARFS_EXPIRE_PERIOD);
+}
+
+static int mv_pp2x_rx_flow_steer(struct net_device *dev,
+				 const struct sk_buff *skb,
+				 u16 rxq_index, u32 flow_id)
+{
+	struct mv_pp2x_port *port = netdev_priv(dev);
+	struct mv_pp2x_arfs *arfs = port->arfs;
+	struct mv_pp2x_arfs_filter *filter = NULL, *tmp;
+	struct mv_pp2x_cls_c3_flow flow;
+	struct flow_keys fk;
+	bool sched = false;
+	u32 key;
+	int i, id;
+
+	if (!arfs || rxq_index >= port->num_qvector)
+		return -EINVAL;
+
+	if (!skb_flow_dissect_flow_keys(skb, &fk, 0))
+		return -EPROTONOSUPPORT;
+	if (fk.basic.n_proto != htons(ETH_P_IP) ||
+	    (fk.basic.ip_proto != IPPROTO_TCP &&
+	     fk.basic.ip_proto != IPPROTO_UDP) ||
+	    (fk.control.flags & FLOW_DIS_IS_FRAGMENT))
+		return -EPROTONOSUPPORT;
+
+	memset(&flow, 0, sizeof(flow));
+	flow.sip = ntohl(fk.addrs.v4addrs.src);
+	flow.dip = ntohl(fk.addrs.v4addrs.dst);
+	flow.sport = ntohs(fk.ports.src);
+	flow.dport = ntohs(fk.ports.dst);
+	flow.ip_proto = fk.basic.ip_proto;
+	key = jhash(&flow, sizeof(flow), 0);
+
+	spin_lock(&port->priv->hw.c3_lock);
+	hash_for_each_possible(arfs->hash, tmp, node, key) {
+		if (!memcmp(&tmp->flow, &flow, sizeof(flow))) {
+			filter = tmp;
+			break;
+		}
+	}
+
+	if (!filter) {
+		for (i = 0; i < MVPP2_ARFS_FILTERS; i++) {
+			if (!arfs->filters[i].used) {
+				filter = &arfs->filters[i];
+				break;
+			}
+		}
+		if (!filter) {
+			spin_unlock(&port->priv->hw.c3_lock);
+			return -EBUSY;
+		}
+		filter->flow = flow;
+		filter->c3_idx = -1;
+		filter->used = true;
+		filter->pending = true;
+		hash_add(arfs->hash, &filter->node, key);
+		sched = true;
+	} else if (filter->rxq_index != rxq_index) {
+		filter->pending = true;
+		sched = true;
+	}
+	filter->rxq_index = rxq_index;
+	filter->flow_id = flow_id;
+	id = filter - arfs->filters;
+	spin_unlock(&port->priv->hw.c3_lock);
+
+	if (sched)
+		mod_delayed_work(system_wq, &arfs->work, 0);
+
+	return id;
+}
+
+static void mv_pp2x_arfs_flush(struct mv_pp2x_port *port)
+{
+	struct mv_pp2x_hw *hw = &port->priv->hw;
+	int i;
+
+	if (!port->arfs)
+		return;
+
+	cancel_delayed_work_sync(&port->arfs->work);
+
+	for (i = 0; i < MVPP2_ARFS_FILTERS; i++) {
+		spin_lock_bh(&hw->c3_lock);
+		if (port->arfs->filters[i].used)
+			mv_pp2x_arfs_filter_free(hw, &port->arfs->filters[i]);
+		spin_unlock_bh(&hw->c3_lock);
+	}
+}
+
+static void mv_pp2x_arfs_enable(struct mv_pp2x_port *port, bool en)
+{
+	struct mv_pp2x_hw *hw = &port->priv->hw;
+
+	spin_lock_bh(&hw->c3_lock);
+	mv_pp2x_cls_arfs_port_set(hw, port->id, en);
+	spin_unlock_bh(&hw->c3_lock);
+
+	if (!en)
+		mv_pp2x_arfs_flush(port);
+}
+
+static int mv_pp2x_arfs_init(struct mv_pp2x_port *port)
+{
+	struct mv_pp2x_arfs *arfs;
+
+	arfs = devm_kzalloc(port->dev->dev.parent, sizeof(*arfs), GFP_KERNEL);
+	if (!arfs)
+		return -ENOMEM;
+
+	arfs->port = port;
+	hash_init(arfs->hash);
+	INIT_DELAYED_WORK(&arfs->work, mv_pp2x_arfs_work);
+	port->arfs = arfs;
+
+	return 0;
+}
+
+/* Map the private q_vector interrupts (one per CPU, in q_vector order) to
+ * their CPUs, so RPS can translate a CPU into an RX queue index.
+ */
+static void mv_pp2x_arfs_rmap_init(struct net_device *dev,
+				   struct mv_pp2x_port *port)
+{
+	struct queue_vector *qvec;
+	int qvec_id, err;
+
+	if (!port->arfs)
+		return;
+
+	dev->rx_cpu_rmap = alloc_irq_cpu_rmap(port->num_qvector);
+	if (!dev->rx_cpu_rmap) {
+		netdev_warn(dev, "aRFS disabled, cannot allocate cpu rmap\n");
+		return;
+	}
+
+	for (qvec_id = 0; qvec_id < port->num_qvector; qvec_id++) {
+		qvec = &port->q_vector[qvec_id];
+		if (qvec->qv_type != MVPP2_PRIVATE || !qvec->irq)
+			break;
+		err = irq_cpu_rmap_add(dev->rx_cpu_rmap, qvec->irq);
+		if (err)
+			break;
+	}
+	if (qvec_id < port->num_qvector) {
+		netdev_warn(dev, "aRFS disabled, cannot map IRQ %d\n",
+			    port->q_vector[qvec_id].irq);
+		free_irq_cpu_rmap(dev->rx_cpu_rmap);
+		dev->rx_cpu_rmap = NULL;
+	}
+}
+#endif
+
 void mv_pp2x_cleanup_irqs(struct mv_pp2x_port *port)
 {
 	int qvec;
 
+#ifdef CONFIG_RFS_ACCEL
+	free_irq_cpu_rmap(port->dev->rx_cpu_rmap);
+	port->dev->rx_cpu_rmap = NULL;
+#endif
+
 	/* Rx/TX irq's */
 	for (qvec = 0; qvec < port->num_qvector; qvec++) {
 		irq_set_affinity_hint(port->q_vector[qvec].irq, NULL);
@@ -1689,6 +2351,7 @@ static irqreturn_t mv_pp2x_isr(int irq, void *dev_id)
 	pr_debug("%s cpu_id(%d) port_id(%d) q_vec(%d), qv_type(%d)\n",
 		 __func__, smp_processor_id(), q_vec->parent->id,
 		(int)(q_vec - q_vec->parent->q_vector), q_vec->qv_type);
+	q_vec->irq_sched = true;
 	napi_schedule(&q_vec->napi);
 
 	return IRQ_HANDLED;
@@ -1754,6 +2417,9 @@ int mv_pp2x_setup_irqs(struct net_device *dev, struct mv_pp2x_port *port)
 		if (!dev->irq)
 			dev->irq = port->mac_data.link_irq;
 	}
+#ifdef CONFIG_RFS_ACCEL
+	mv_pp2x_arfs_rmap_init(dev, port);
+#endif
 	return 0;
 err_cleanup:
 	mv_pp2x_cleanup_irqs(port);
@@ -1940,13 +2606,13 @@ static void mv_pp2x_timer_set(struct mv_pp2x_port_pcpu *port_pcpu)
 }
 
 /* Set transmit TX timer */
-static void mv_pp2x_tx_timer_set(struct mv_pp2x_cp_pcpu *cp_pcpu)
+static void mv_pp2x_tx_timer_set(struct mv_pp2x_cp_pcpu *cp_pcpu, u32 usecs)
 {
 	ktime_t interval;
 
 	if (!cp_pcpu->tx_timer_scheduled) {
 		cp_pcpu->tx_timer_scheduled = true;
-		interval = ktime_set(0, MVPP2_TX_HRTIMER_PERIOD_NS);
+		interval = ktime_set(0, usecs * NSEC_PER_USEC);
 		hrtimer_start(&cp_pcpu->tx_timer, interval,
 			      HRTIMER_MODE_REL_PINNED);
 	}
@@ -1961,6 +2627,53 @@ static void mv_pp2x_tx_timer_kill(struct mv_pp2x_cp_pcpu *cp_pcpu)
 	}
 }
 
+/* Ring aggregated TXQ doorbell for all bulked descriptors */
+static void mv_pp2x_aggr_txq_flush(struct mv_pp2x *priv,
+				   struct mv_pp2x_aggr_tx_queue *aggr_txq,
+				   struct mv_pp2x_cp_pcpu *cp_pcpu)
+{
+	u32 bulk = aggr_txq->xmit_bulk;
+
+	if (!bulk)
+		return;
+
+	mv_pp2x_tx_timer_kill(cp_pcpu);
+	aggr_txq->sw_count -= bulk;
+	aggr_txq->hw_count += bulk;
+	mv_pp2x_write(&priv->hw, MVPP2_AGGR_TXQ_UPDATE_REG, bulk);
+	aggr_txq->xmit_bulk = 0;
+	aggr_txq->xmit_bytes = 0;
+
+	u64_stats_update_begin(&cp_pcpu->syncp);
+	cp_pcpu->tx_db_hist[min_t(int, fls(bulk), MVPP2_TX_DB_HIST_NUM) - 1]++;
+	u64_stats_update_end(&cp_pcpu->syncp);
+}
+
+/* Adaptive doorbell policy, called after descriptors were bulked.
+ * Doorbell is rung once descriptor or byte budget is exhausted, or when
+ * the stack has nothing more to send and no NAPI poll of this CP will
+ * flush the bulk at its end. Timer is armed only if the port allows
+ * deferring the doorbell.
+ */
+static void mv_pp2x_tx_doorbell(struct mv_pp2x_port *port,
+				struct mv_pp2x_aggr_tx_queue *aggr_txq,
+				struct mv_pp2x_cp_pcpu *cp_pcpu, bool more)
+{
+	if (aggr_txq->xmit_bulk >= port->tx_db_frames ||
+	    aggr_txq->xmit_bytes >= MVPP2_TX_DB_BYTES) {
+		mv_pp2x_aggr_txq_flush(port->priv, aggr_txq, cp_pcpu);
+		return;
+	}
+
+	if (more || cp_pcpu->in_napi)
+		return;
+
+	if (port->tx_db_usecs)
+		mv_pp2x_tx_timer_set(cp_pcpu, port->tx_db_usecs);
+	else
+		mv_pp2x_aggr_txq_flush(port->priv, aggr_txq, cp_pcpu);
+}
+
 static void mv_pp2x_tx_proc_cb(unsigned long data)
 {
 	struct net_device *dev = (struct net_device *)data;
@@ -1974,7 +2687,7 @@ static void mv_pp2x_tx_proc_cb(unsigned long data)
 
 	/* Process all the Tx queues */
 	cause = (1 << mv_pp2x_txq_number) - 1;
-	tx_todo = mv_pp2x_tx_done(port, cause, smp_processor_id());
+	tx_todo = mv_pp2x_tx_done(port, cause, smp_processor_id(), 0);
 
 	/* Set the timer in case not all the packets were processed */
 	if (tx_todo)
@@ -1994,10 +2707,10 @@ static void mv_pp2x_tx_send_proc_cb(unsigned long data)
 	aggr_txq = &priv->aggr_txqs[cpu];
 
 	if (likely(aggr_txq->xmit_bulk > 0)) {
-		aggr_txq->sw_count -= aggr_txq->xmit_bulk;
-		aggr_txq->hw_count += aggr_txq->xmit_bulk;
-		mv_pp2x_write(&priv->hw, MVPP2_AGGR_TXQ_UPDATE_REG, aggr_txq->xmit_bulk);
-		aggr_txq->xmit_bulk = 0;
+		u64_stats_update_begin(&cp_pcpu->syncp);
+		cp_pcpu->tx_db_timer++;
+		u64_stats_update_end(&cp_pcpu->syncp);
+		mv_pp2x_aggr_txq_flush(priv, aggr_txq, cp_pcpu);
 	}
 }
 
@@ -2056,7 +2769,7 @@ static void mv_pp2x_width_calc(struct mv_pp2x_port *port, u32 *cpu_width,
 int mv_pp2x_cos_classifier_set(struct mv_pp2x_port *port,
 			       enum mv_pp2x_cos_classifier cos_mode)
 {
-	int index, flow_idx, lkpid;
+	int index, flow_idx, lkpid, err;
 	int data[MVPP2_LKP_PTR_NUM];
 	struct mv_pp2x_hw *hw = &port->priv->hw;
 	struct mv_pp2x_cls_flow_info *flow_info;
@@ -2071,7 +2784,9 @@ int mv_pp2x_cos_classifier_set(struct mv_pp2x_port *port,
 			data[i] = MVPP2_FLOW_TBL_SIZE;
 		lkpid = index + MVPP2_PRS_FL_START;
 		/* Prepare a temp table for the lkpid */
-		mv_pp2x_cls_flow_tbl_temp_copy(hw, lkpid, &flow_idx);
+		err = mv_pp2x_cls_flow_tbl_temp_copy(hw, lkpid, &flow_idx);
+		if (err)
+			return err;
 		/* Update lookup table to temp flow table */
 		mv_pp2x_cls_lkp_flow_set(hw, lkpid, 0, flow_idx);
 		mv_pp2x_cls_lkp_flow_set(hw, lkpid, 1, flow_idx);
@@ -2129,6 +2844,7 @@ int mv_pp2x_cos_classifier_set(struct mv_pp2x_port *port,
 			if (flow_idx > data[i])
 				flow_idx = data[i];
 		}
+		flow_idx = mv_pp2x_cls_flow_head(flow_info, flow_idx);
 		mv_pp2x_cls_lkp_flow_set(hw, lkpid, 0, flow_idx);
 		mv_pp2x_cls_lkp_flow_set(hw, lkpid, 1, flow_idx);
 	}
@@ -2260,6 +2976,153 @@ int mv_pp22_rss_rxfh_indir_set(struct mv_pp2x_port *port)
 	return 0;
 }
 
+/* mv_pp22_rss_ctx_indir_set
+*  -- The API set the table of RSS context ctx according to its CPU weight
+*  and binds the RXQ selecting it. The entries hold the whole RXQ number,
+*  on the CPU RXQs of the port default CoS queue.
+*/
+int mv_pp22_rss_ctx_indir_set(struct mv_pp2x_port *port, u32 ctx)
+{
+	struct mv_pp2x *priv = port->priv;
+	struct mv_pp22_rss_entry rss_entry;
+	u32 cos_width = 0, cpu_width = 0, cpu_id = 0;
+	int entry_idx;
+	u8 cos_queue;
+
+	if (ctx < priv->num_rss_tables || ctx >= MVPP22_RSS_TBL_NUM)
+		return -EINVAL;
+
+	memset(&rss_entry, 0, sizeof(struct mv_pp22_rss_entry));
+
+	mv_pp2x_width_calc(port, &cpu_width, &cos_width, NULL);
+	cos_queue = mv_pp2x_cosval_queue_map(port, port->cos_cfg.default_cos);
+
+	/* The selecting RXQ is below 128, its bit 7 is kept and cleared */
+	rss_entry.sel = MVPP22_RSS_ACCESS_TBL;
+	rss_entry.u.entry.tbl_id = ctx;
+	rss_entry.u.entry.width = MVPP22_RSS_WIDTH_MAX - 1;
+
+	for (entry_idx = 0; entry_idx < MVPP22_RSS_TBL_LINE_NUM; entry_idx++) {
+		if (mv_pp22_cpu_id_from_indir_tbl_get(priv,
+						      priv->rss_ctx_indir[ctx][entry_idx],
+						      &cpu_id))
+			return -EINVAL;
+		rss_entry.u.entry.tbl_line = entry_idx;
+		rss_entry.u.entry.rxq = port->first_rxq +
+			((cpu_id << cos_width) | cos_queue);
+		if (mv_pp22_rss_tbl_entry_set(&priv->hw, &rss_entry))
+			return -EINVAL;
+	}
+
+	memset(&rss_entry, 0, sizeof(struct mv_pp22_rss_entry));
+	rss_entry.sel = MVPP22_RSS_ACCESS_POINTER;
+	rss_entry.u.pointer.rxq_idx = mv_pp22_rss_ctx_rxq(port, ctx);
+	rss_entry.u.pointer.rss_tbl_ptr = ctx;
+
+	return mv_pp22_rss_tbl_entry_set(&priv->hw, &rss_entry);
+}
+
+/* mv_pp22_rss_ctx_alloc
+*  -- The API allocate a free RSS table as a context of the port, starting
+*  with the default CPU weight. Return the context ID.
+*/
+int mv_pp22_rss_ctx_alloc(struct mv_pp2x_port *port)
+{
+	struct mv_pp2x *priv = port->priv;
+	int ctx, err;
+
+	/* Single mode doesn't support RSS features */
+	if (priv->pp2_version == PPV21 ||
+	    priv->pp2_cfg.queue_mode == MVPP2_QDIST_SINGLE_MODE)
+		return -EOPNOTSUPP;
+
+	for (ctx = priv->num_rss_tables; ctx < MVPP22_RSS_TBL_NUM; ctx++) {
+		if (priv->rss_ctx_port[ctx])
+			continue;
+		/* The selecting RXQ must not be one of the port RXQs */
+		if (mv_pp22_rss_ctx_rxq(port, ctx) <
+		    port->first_rxq + port->num_rx_queues)
+			continue;
+
+		memcpy(priv->rss_ctx_indir[ctx], priv->rx_indir_table,
+		       sizeof(priv->rx_indir_table));
+		err = mv_pp22_rss_ctx_indir_set(port, ctx);
+		if (err)
+			return err;
+
+		priv->rss_ctx_port[ctx] = port;
+		return ctx;
+	}
+
+	return -ENOSPC;
+}
+EXPORT_SYMBOL(mv_pp22_rss_ctx_alloc);
+
+/* mv_pp22_rss_ctx_free
+*  -- The API release RSS context ctx of the port, unless ntuple rules are
+*  still spread by it.
+*/
+int mv_pp22_rss_ctx_free(struct mv_pp2x_port *port, u32 ctx)
+{
+	int i;
+
+	if (!mv_pp22_rss_ctx_owned(port, ctx))
+		return -EINVAL;
+
+	for (i = 0; i < MVPP2_CLS_NTUPLE_RULES; i++)
+		if (port->ntuple_rules[i].valid &&
+		    port->ntuple_rules[i].rss_context == ctx)
+			return -EBUSY;
+
+	port->priv->rss_ctx_port[ctx] = NULL;
+
+	return 0;
+}
+EXPORT_SYMBOL(mv_pp22_rss_ctx_free);
+
+/* mv_pp22_rss_ctx_cpus_set
+*  -- The API spread the table entries of RSS context ctx over the CPUs of
+*  cpu_mask in turn. The mask bits are CPU indexes, as in the ethtool
+*  indirection table.
+*/
+int mv_pp22_rss_ctx_cpus_set(struct mv_pp2x_port *port, u32 ctx, u32 cpu_mask)
+{
+	struct mv_pp2x *priv = port->priv;
+	unsigned long mask = cpu_mask;
+	u8 cpus[BITS_PER_LONG];
+	int cpu, num = 0, entry_idx;
+
+	if (!mv_pp22_rss_ctx_owned(port, ctx))
+		return -EINVAL;
+
+	if (!cpu_mask || fls(cpu_mask) > num_online_cpus())
+		return -EINVAL;
+
+	for_each_set_bit(cpu, &mask, BITS_PER_LONG)
+		cpus[num++] = cpu;
+
+	for (entry_idx = 0; entry_idx < MVPP22_RSS_TBL_LINE_NUM; entry_idx++)
+		priv->rss_ctx_indir[ctx][entry_idx] = cpus[entry_idx % num];
+
+	return mv_pp22_rss_ctx_indir_set(port, ctx);
+}
+EXPORT_SYMBOL(mv_pp22_rss_ctx_cpus_set);
+
+/* mv_pp22_rss_ctx_cpus_get
+*  -- The API return the mask of CPU indexes RSS context ctx spreads over
+*/
+u32 mv_pp22_rss_ctx_cpus_get(struct mv_pp2x_port *port, u32 ctx)
+{
+	u32 cpu_mask = 0;
+	int entry_idx;
+
+	for (entry_idx = 0; entry_idx < MVPP22_RSS_TBL_LINE_NUM; entry_idx++)
+		cpu_mask |= BIT(port->priv->rss_ctx_indir[ctx][entry_idx]);
+
+	return cpu_mask;
+}
+EXPORT_SYMBOL(mv_pp22_rss_ctx_cpus_get);
+
 /* mv_pp22_rss_enable_set
 *  -- The API enable or disable RSS on the port
 */
@@ -2295,99 +3158,140 @@ void mv_pp22_rss_enable(struct mv_pp2x_port *port, bool en)
 	}
 }
 
-/* mv_pp2x_rss_mode_set
-*  -- The API to update RSS hash mode for non-fragemnt UDP packet per port.
+/* mv_pp22_rss_flow_get
+*  -- The API to get the RSS flow type of a flow ID, -1 for non-IP flows.
 */
-int mv_pp22_rss_mode_set(struct mv_pp2x_port *port, int rss_mode)
+static int mv_pp22_rss_flow_get(int lkpid)
+{
+	int lkpid_attr = mv_pp2x_prs_flow_id_attr_get(lkpid);
+	int flow;
+
+	/* IPv6 flow types follow the IPv4 ones in the same order */
+	if (lkpid_attr & MVPP2_PRS_FL_ATTR_IP4_BIT)
+		flow = MVPP2_RSS_FLOW_TCP4;
+	else if (lkpid_attr & MVPP2_PRS_FL_ATTR_IP6_BIT)
+		flow = MVPP2_RSS_FLOW_TCP6;
+	else
+		return -1;
+
+	if (lkpid_attr & MVPP2_PRS_FL_ATTR_FRAG_BIT)
+		return flow + MVPP2_RSS_FLOW_IP4;
+	if (lkpid_attr & MVPP2_PRS_FL_ATTR_TCP_BIT)
+		return flow + MVPP2_RSS_FLOW_TCP4;
+	if (lkpid_attr & MVPP2_PRS_FL_ATTR_UDP_BIT)
+		return flow + MVPP2_RSS_FLOW_UDP4;
+
+	return flow + MVPP2_RSS_FLOW_IP4;
+}
+
+/* mv_pp22_rss_hash_opts_set
+*  -- The API to update the RSS hash fields of a flow type per port, for its
+*  untagged, tagged and fragmented flow IDs.
+*/
+int mv_pp22_rss_hash_opts_set(struct mv_pp2x_port *port, int flow,
+			      u32 hek_opts)
 {
-	int index, flow_idx, flow_idx_rss, lkpid, lkpid_attr;
-	int data[3];
+	int index, flow_idx, lkpid, err;
+	int field_id[MVPP2_CLS_FLOWS_TBL_FIELDS_MAX];
 	struct mv_pp2x_hw *hw = &port->priv->hw;
 	struct mv_pp2x_cls_flow_info *flow_info;
 
 	if (port->priv->pp2_cfg.queue_mode == MVPP2_QDIST_SINGLE_MODE)
 		return -1;
 
-	if (rss_mode != MVPP2_RSS_NF_UDP_2T &&
-	    rss_mode != MVPP2_RSS_NF_UDP_5T) {
-		pr_err("Invalid rss mode:%d\n", rss_mode);
+	if (flow < 0 || flow >= MVPP2_RSS_FLOW_NUM)
 		return -EINVAL;
+
+	/* Check the fields fit the HEK of every flow ID before changing any */
+	for (lkpid = MVPP2_PRS_FL_START; lkpid < MVPP2_PRS_FL_LAST; lkpid++) {
+		if (mv_pp22_rss_flow_get(lkpid) != flow)
+			continue;
+		if (mv_pp2x_cls_rss_hek_fields(lkpid, hek_opts, field_id) < 0) {
+			pr_err("Invalid rss hash fields:0x%x\n", hek_opts);
+			return -EINVAL;
+		}
 	}
 
 	for (index = 0; index < (MVPP2_PRS_FL_LAST - MVPP2_PRS_FL_START);
 		index++) {
-		flow_info = &hw->cls_shadow->flow_info[index];
-		data[0] = MVPP2_FLOW_TBL_SIZE;
-		data[1] = MVPP2_FLOW_TBL_SIZE;
-		data[2] = MVPP2_FLOW_TBL_SIZE;
 		lkpid = index + MVPP2_PRS_FL_START;
-		/* Get lookup ID attribute */
-		lkpid_attr = mv_pp2x_prs_flow_id_attr_get(lkpid);
-		/* Only non-frag TCP & UDP can set rss mode */
-		if ((lkpid_attr & (MVPP2_PRS_FL_ATTR_TCP_BIT | MVPP2_PRS_FL_ATTR_UDP_BIT)) &&
-		    !(lkpid_attr & MVPP2_PRS_FL_ATTR_FRAG_BIT)) {
-			/* Prepare a temp table for the lkpid */
-			mv_pp2x_cls_flow_tbl_temp_copy(hw, lkpid, &flow_idx);
-			/* Update lookup table to temp flow table */
-			mv_pp2x_cls_lkp_flow_set(hw, lkpid, 0, flow_idx);
-			mv_pp2x_cls_lkp_flow_set(hw, lkpid, 1, flow_idx);
-			/* Update original flow table */
-			/* First, remove the port from original table */
-			mv_pp2x_cls_flow_port_del(hw,
-						  flow_info->flow_entry_rss1, port->id);
-			mv_pp2x_cls_flow_port_del(hw,
-						  flow_info->flow_entry_rss2, port->id);
-			if (flow_info->flow_entry_dflt)
-				data[0] = flow_info->flow_entry_dflt;
-			if (flow_info->flow_entry_vlan)
-				data[1] = flow_info->flow_entry_vlan;
-			if (flow_info->flow_entry_dscp)
-				data[2] = flow_info->flow_entry_dscp;
-			/* Second, update port in original table with rss_mode*/
-			if (rss_mode == MVPP2_RSS_NF_UDP_2T)
-				flow_idx_rss = flow_info->flow_entry_rss1;
-			else
-				flow_idx_rss = flow_info->flow_entry_rss2;
-			mv_pp2x_cls_flow_port_add(hw, flow_idx_rss, port->id);
-
-			/*Find the ptr of flow table, the min flow index */
-			flow_idx_rss = min(flow_info->flow_entry_rss1,
-					   flow_info->flow_entry_rss2);
-			flow_idx = min(min(data[0], data[1]), min(data[2],
-								  flow_idx_rss));
-			/*Third, restore lookup table */
-			mv_pp2x_cls_lkp_flow_set(hw, lkpid, 0, flow_idx);
-			mv_pp2x_cls_lkp_flow_set(hw, lkpid, 1, flow_idx);
-		} else
-			if (flow_info->flow_entry_rss1) {
-				flow_idx_rss = flow_info->flow_entry_rss1;
-				mv_pp2x_cls_flow_port_add(hw, flow_idx_rss,
-							  port->id);
-		}
+		if (mv_pp22_rss_flow_get(lkpid) != flow)
+			continue;
+		flow_info = &hw->cls_shadow->flow_info[index];
+		/* Prepare a temp table for the lkpid */
+		err = mv_pp2x_cls_flow_tbl_temp_copy(hw, lkpid, &flow_idx);
+		if (err)
+			return err;
+		/* Update lookup table to temp flow table */
+		mv_pp2x_cls_lkp_flow_set(hw, lkpid, 0, flow_idx);
+		mv_pp2x_cls_lkp_flow_set(hw, lkpid, 1, flow_idx);
+		/* Update the port hash entry in original table */
+		err = mv_pp2x_cls_flow_rss_hek_set(hw, lkpid, port->id,
+						   hek_opts);
+		/* Restore lookup table, the ntuple entries head the flow */
+		flow_idx = mv_pp2x_cls_flow_head(flow_info,
+						 flow_info->flow_entry_rss);
+		mv_pp2x_cls_lkp_flow_set(hw, lkpid, 0, flow_idx);
+		mv_pp2x_cls_lkp_flow_set(hw, lkpid, 1, flow_idx);
+		if (err)
+			return err;
 	}
-	/* Record it in priv */
-	port->rss_cfg.rss_mode = rss_mode;
+	/* Record it in port */
+	port->rss_cfg.hash_opts[flow] = hek_opts;
 
 	return 0;
 }
-EXPORT_SYMBOL(mv_pp22_rss_mode_set);
+EXPORT_SYMBOL(mv_pp22_rss_hash_opts_set);
 
-/* mv_pp22_rss_default_cpu_set
-*  -- The API to update the default CPU to handle the non-IP packets.
+/* mv_pp2x_rss_mode_set
+*  -- The API to update RSS hash mode for non-fragemnt UDP packet per port.
 */
-int mv_pp22_rss_default_cpu_set(struct mv_pp2x_port *port, int default_cpu)
+int mv_pp22_rss_mode_set(struct mv_pp2x_port *port, int rss_mode)
 {
-	u8 index, queue, q_cpu_mask;
-	u32 cpu_width = 0, cos_width = 0;
-	struct mv_pp2x_hw *hw = &port->priv->hw;
+	u32 hek_opts;
+	int err;
 
 	if (port->priv->pp2_cfg.queue_mode == MVPP2_QDIST_SINGLE_MODE)
 		return -1;
 
-	if (!(*cpumask_bits(cpu_online_mask) & (1 << default_cpu))) {
-		pr_err("Invalid default cpu id %d\n", default_cpu);
-		return -EINVAL;
-	}
+	if (rss_mode != MVPP2_RSS_NF_UDP_2T &&
+	    rss_mode != MVPP2_RSS_NF_UDP_5T) {
+		pr_err("Invalid rss mode:%d\n", rss_mode);
+		return -EINVAL;
+	}
+
+	hek_opts = (rss_mode == MVPP2_RSS_NF_UDP_2T) ? MVPP2_RSS_HEK_2T :
+		   MVPP2_RSS_HEK_5T;
+	err = mv_pp22_rss_hash_opts_set(port, MVPP2_RSS_FLOW_UDP4, hek_opts);
+	if (!err)
+		err = mv_pp22_rss_hash_opts_set(port, MVPP2_RSS_FLOW_UDP6,
+						hek_opts);
+	if (err)
+		return err;
+
+	/* Record it in priv */
+	port->rss_cfg.rss_mode = rss_mode;
+
+	return 0;
+}
+EXPORT_SYMBOL(mv_pp22_rss_mode_set);
+
+/* mv_pp22_rss_default_cpu_set
+*  -- The API to update the default CPU to handle the non-IP packets.
+*/
+int mv_pp22_rss_default_cpu_set(struct mv_pp2x_port *port, int default_cpu)
+{
+	u8 index, queue, q_cpu_mask;
+	u32 cpu_width = 0, cos_width = 0;
+	struct mv_pp2x_hw *hw = &port->priv->hw;
+
+	if (port->priv->pp2_cfg.queue_mode == MVPP2_QDIST_SINGLE_MODE)
+		return -1;
+
+	if (!(*cpumask_bits(cpu_online_mask) & (1 << default_cpu))) {
+		pr_err("Invalid default cpu id %d\n", default_cpu);
+		return -EINVAL;
+	}
 
 	/* Calculate width */
 	mv_pp2x_width_calc(port, &cpu_width, &cos_width, NULL);
@@ -2492,6 +3396,123 @@ static void mv_pp2x_buff_hdr_rx(struct mv_pp2x_port *port,
 	} while (!MVPP2_B_HDR_INFO_IS_LAST(buff_hdr->info));
 }
 
+/* Hand received buffer over to the stack: unmap it, or keep it mapped on
+ * the page ring until the stack frees it.
+ */
+static void mv_pp2x_rx_buf_unmap(struct device *dev,
+				 struct mv_pp2x_bm_pool *bm_pool,
+				 void *data, dma_addr_t buf_phys_addr)
+{
+	if (!bm_pool->page_ring)
+		dma_unmap_single(dev, buf_phys_addr,
+				 MVPP2_RX_BUF_SIZE(bm_pool->pkt_size),
+				 bm_pool->dma_dir);
+	else if (!mv_pp2x_page_keep(bm_pool, data, buf_phys_addr))
+		dma_unmap_page(dev, buf_phys_addr,
+			       PAGE_SIZE << bm_pool->page_order,
+			       bm_pool->dma_dir);
+}
+
+/* Multi-buffer frame: every buffer starts with a buffer header pointing
+ * to the next one, data follows at the RXQ packet offset.
+ */
+static inline dma_addr_t mv_pp2x_buff_hdr_next(struct mv_pp2x_buff_hdr *buff_hdr)
+{
+	dma_addr_t next = buff_hdr->next_buff_phys_addr;
+
+#if defined(CONFIG_ARCH_DMA_ADDR_T_64BIT) && defined(CONFIG_PHYS_ADDR_T_64BIT)
+	next |= (u64)buff_hdr->next_buff_phys_addr_high << 32;
+#endif
+	return next;
+}
+
+/* Return remaining buffers of a multi-buffer frame to BM */
+static void mv_pp2x_rx_multi_buf_drop(struct mv_pp2x_port *port,
+				      struct mv_pp2x_bm_pool *bm_pool,
+				      dma_addr_t buf_phys_addr, int cpu)
+{
+	struct device *dev = port->dev->dev.parent;
+	struct mv_pp2x_buff_hdr *buff_hdr;
+	bool last;
+
+	do {
+		buff_hdr = phys_to_virt(dma_to_phys(dev, buf_phys_addr));
+		dma_sync_single_for_cpu(dev, buf_phys_addr, sizeof(*buff_hdr),
+					bm_pool->dma_dir);
+		last = MVPP2_B_HDR_INFO_IS_LAST(buff_hdr->info);
+
+		mv_pp2x_pool_refill(port->priv, bm_pool->id, buf_phys_addr, cpu);
+		buf_phys_addr = mv_pp2x_buff_hdr_next(buff_hdr);
+	} while (!last);
+}
+
+/* Build skb of a frame HW scattered over a chain of pool buffers. First
+ * buffer becomes skb head, the others are attached as page fragments.
+ * Return number of buffers taken from the pool. If the frame is dropped
+ * *pskb is NULL and the buffers not taken are returned to BM.
+ */
+static int mv_pp2x_rx_multi_buf(struct mv_pp2x_port *port,
+				struct mv_pp2x_bm_pool *bm_pool,
+				dma_addr_t buf_phys_addr, struct sk_buff **pskb,
+				int cpu)
+{
+	struct device *dev = port->dev->dev.parent;
+	unsigned int frag_size = mv_pp2x_bm_frag_size(bm_pool);
+	struct mv_pp2x_buff_hdr *buff_hdr;
+	struct sk_buff *skb = NULL;
+	dma_addr_t next_phys_addr;
+	struct page *page;
+	int bufs = 0;
+	bool last;
+	u8 *data;
+
+	/* Fragments must be page backed */
+	if (unlikely(!bm_pool->page_ring && frag_size > PAGE_SIZE))
+		goto drop;
+
+	do {
+		data = phys_to_virt(dma_to_phys(dev, buf_phys_addr));
+		dma_sync_single_for_cpu(dev, buf_phys_addr,
+					MVPP2_RX_BUF_SIZE(bm_pool->pkt_size),
+					bm_pool->dma_dir);
+		buff_hdr = (struct mv_pp2x_buff_hdr *)data;
+		last = MVPP2_B_HDR_INFO_IS_LAST(buff_hdr->info);
+		next_phys_addr = mv_pp2x_buff_hdr_next(buff_hdr);
+
+		if (!skb) {
+			skb = build_skb(data, frag_size);
+			if (unlikely(!skb))
+				goto drop;
+			skb_reserve(skb, MVPP2_MH_SIZE + NET_SKB_PAD);
+			skb_put(skb, buff_hdr->byte_count - MVPP2_MH_SIZE);
+		} else if (likely(skb_shinfo(skb)->nr_frags < MAX_SKB_FRAGS)) {
+			page = virt_to_head_page(data);
+			skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags, page,
+					data + NET_SKB_PAD - (u8 *)page_address(page),
+					buff_hdr->byte_count, frag_size);
+		} else {
+			goto drop;
+		}
+
+		mv_pp2x_rx_buf_unmap(dev, bm_pool, data, buf_phys_addr);
+		bufs++;
+		buf_phys_addr = next_phys_addr;
+	} while (!last);
+
+	*pskb = skb;
+
+	return bufs;
+
+drop:
+	/* Buffers already attached to skb are released with it */
+	if (skb)
+		dev_kfree_skb_any(skb);
+	mv_pp2x_rx_multi_buf_drop(port, bm_pool, buf_phys_addr, cpu);
+	*pskb = NULL;
+
+	return bufs;
+}
+
 static void mv_pp2x_set_skb_hash(struct mv_pp2x_rx_desc *rx_desc, u32 rx_status,
 				 struct sk_buff *skb)
 {
@@ -2538,19 +3559,109 @@ static void mv_pp2x_build_skb(struct sk_buff *skb, unsigned char *data,
 	}
 }
 
+#ifdef MVPP2_XDP
+/* Transmit XDP_TX frame from the RX buffer it was received into.
+ * Buffer stays DMA mapped and is returned by HW to its BM pool (BUF_MOD)
+ * once transmitted, so nothing is freed by tx_done.
+ */
+static int mv_pp2x_xdp_tx(struct mv_pp2x_port *port,
+			  struct mv_pp2x_tx_queue *txq,
+			  struct mv_pp2x_aggr_tx_queue *aggr_txq,
+			  struct xdp_buff *xdp, unsigned char *data,
+			  dma_addr_t buf_phys_addr,
+			  struct mv_pp2x_bm_pool *bm_pool, int cpu)
+{
+	struct mv_pp2x_txq_pcpu *txq_pcpu = this_cpu_ptr(txq->pcpu);
+	struct mv_pp2x_tx_desc *tx_desc;
+	dma_addr_t tx_phys_addr;
+	u32 tx_cmd;
+
+	/* Prevent shadow_q override */
+	if (unlikely(mv_pp2x_txq_free_count(txq_pcpu) < port->txq_stop_limit))
+		return -EBUSY;
+
+	if (unlikely(mv_pp2x_aggr_desc_num_check(port->priv, aggr_txq, 1, cpu) ||
+		     mv_pp2x_txq_reserved_desc_num_proc(port->priv, txq,
+							txq_pcpu, 1, cpu)))
+		return -ENOMEM;
+
+	tx_phys_addr = buf_phys_addr + ((unsigned char *)xdp->data - data);
+
+	tx_desc = mv_pp2x_txq_next_desc_get(aggr_txq);
+	tx_desc->phys_txq = txq->id;
+	tx_desc->data_size = (unsigned char *)xdp->data_end -
+			     (unsigned char *)xdp->data;
+#ifdef CONFIG_MV_PTP_SERVICE
+	*((u32 *)tx_desc + 2) = 0;
+	*((u32 *)tx_desc + 5) = 0;
+#endif
+
+	/* XDP program may have modified the frame */
+	dma_sync_single_for_device(port->dev->dev.parent, tx_phys_addr,
+				   tx_desc->data_size, bm_pool->dma_dir);
+
+	tx_desc->packet_offset = tx_phys_addr & MVPP2_TX_DESC_DATA_OFFSET;
+	mv_pp2x_txdesc_phys_addr_set(port->priv->pp2_version,
+				     tx_phys_addr & ~MVPP2_TX_DESC_DATA_OFFSET, tx_desc);
+
+	tx_cmd = MVPP2_TXD_L4_CSUM_NOT | MVPP2_TXD_IP_CSUM_DISABLE;
+	tx_cmd |= MVPP2_TXD_BUF_MOD;
+	tx_cmd |= ((bm_pool->id << MVPP2_RXD_BM_POOL_ID_OFFS) &
+		   MVPP2_RXD_BM_POOL_ID_MASK);
+	tx_cmd |= MVPP2_TXD_F_DESC | MVPP2_TXD_L_DESC;
+	tx_desc->command = tx_cmd;
+	mv_pp2x_txq_inc_put(port->priv->pp2_version, txq_pcpu,
+			    NULL, MVPP2_ETH_SHADOW_XDP, tx_desc);
+
+	txq_pcpu->reserved_num--;
+	aggr_txq->sw_count++;
+	aggr_txq->xmit_bulk++;
+	aggr_txq->xmit_bytes += tx_desc->data_size;
+
+	return 0;
+}
+
+/* Transmit XDP_TX frames bulked during RX processing */
+static void mv_pp2x_xdp_tx_flush(struct mv_pp2x_port *port,
+				 struct mv_pp2x_tx_queue *txq,
+				 struct mv_pp2x_aggr_tx_queue *aggr_txq,
+				 struct mv_pp2x_cp_pcpu *cp_pcpu)
+{
+	struct mv_pp2x_txq_pcpu *txq_pcpu = this_cpu_ptr(txq->pcpu);
+
+	mv_pp2x_aggr_txq_flush(port->priv, aggr_txq, cp_pcpu);
+
+	if (port->priv->pp2xdata->interrupt_tx_done)
+		return;
+
+	/* PPV21 TX Post-Processing */
+	if (mv_pp2x_txq_count(txq_pcpu) >= txq->pkts_coal)
+		mv_pp2x_txq_done(port, txq, txq_pcpu, 0);
+
+	if (mv_pp2x_txq_count(txq_pcpu) > 0)
+		mv_pp2x_timer_set(this_cpu_ptr(port->pcpu));
+}
+#endif /* MVPP2_XDP */
+
 /* Main rx processing */
 static int mv_pp2x_rx(struct mv_pp2x_port *port, struct napi_struct *napi,
 		      int rx_todo, struct mv_pp2x_rx_queue *rxq)
 {
 	struct net_device *dev = port->dev;
-	int rx_received, rx_filled, i;
+	int rx_received, rx_filled, i, batch;
 	u32 rcvd_pkts = 0;
 	u32 rcvd_bytes = 0;
+	u32 skb_hit = 0, skb_miss = 0, multi_buf = 0;
 	u32 refill_array[MVPP2_BM_POOLS_NUM] = {0};
 	u8  num_pool = MVPP2_BM_SWF_NUM_POOLS;
 	u8  first_bm_pool = port->priv->pp2_cfg.first_bm_pool;
 	int cpu = smp_processor_id();
 	struct mv_pp2x_cp_pcpu *cp_pcpu = this_cpu_ptr(port->priv->pcpu);
+#ifdef MVPP2_XDP
+	struct bpf_prog *xdp_prog = READ_ONCE(port->xdp_prog);
+	struct mv_pp2x_tx_queue *xdp_txq = port->txqs[rxq->log_id % mv_pp2x_txq_number];
+	u32 xdp_drop = 0, xdp_tx = 0;
+#endif
 
 #ifdef DEV_NETMAP
 		if (port->flags & MVPP2_F_IFCAP_NETMAP) {
@@ -2570,111 +3681,242 @@ static int mv_pp2x_rx(struct mv_pp2x_port *port, struct napi_struct *napi,
 		rx_todo = rx_received;
 
 	rx_filled = 0;
-	for (i = 0; i < rx_todo; i++) {
-		struct mv_pp2x_rx_desc *rx_desc =
-			mv_pp2x_rxq_next_desc_get(rxq);
-		struct mv_pp2x_bm_pool *bm_pool;
-		struct sk_buff *skb;
-		u32 rx_status, pool;
-		int rx_bytes;
-		dma_addr_t buf_phys_addr;
-		unsigned char *data;
+	for (i = 0; i < rx_todo; i += batch) {
+		struct mv_pp2x_rx_frame frames[MVPP2_RX_BATCH];
+		int j, desc;
+
+		batch = min_t(int, rx_todo - i, MVPP2_RX_BATCH);
+
+		/* Start fetching the descriptors of the whole batch, two per
+		 * cache line, before the harvest reads the first one.
+		 */
+		desc = rxq->next_desc_to_proc;
+		for (j = 0; j < batch; j++) {
+			if (!j || !(desc & 0x1))
+				prefetch(rxq->first_desc + desc);
+			desc = MVPP2_QUEUE_NEXT_DESC(rxq, desc);
+		}
+
+		/* Harvest: read descriptors of the batch, start fetching the
+		 * packet headers and hand the buffers to the CPU.
+		 */
+		for (j = 0; j < batch; j++) {
+			struct mv_pp2x_rx_frame *frame = &frames[j];
+			struct mv_pp2x_rx_desc *rx_desc =
+				mv_pp2x_rxq_next_desc_get(rxq);
+			struct mv_pp2x_bm_pool *bm_pool;
 
 #if defined(__BIG_ENDIAN)
-		if (port->priv->pp2_version == PPV21)
-			mv_pp21_rx_desc_swap(rx_desc);
-		else
-			mv_pp22_rx_desc_swap(rx_desc);
+			if (port->priv->pp2_version == PPV21)
+				mv_pp21_rx_desc_swap(rx_desc);
+			else
+				mv_pp22_rx_desc_swap(rx_desc);
 #endif /* __BIG_ENDIAN */
 
-		rx_filled++;
-		rx_status = rx_desc->status;
-		rx_bytes = rx_desc->data_size - MVPP2_MH_SIZE;
+			frame->rx_desc = rx_desc;
+			frame->data = NULL;
+			if (port->priv->pp2_version == PPV21)
+				frame->buf_phys_addr = mv_pp21_rxdesc_phys_addr_get(rx_desc);
+			else
+				frame->buf_phys_addr = mv_pp22_rxdesc_phys_addr_get(rx_desc);
 
-		pool = MVPP2_RX_DESC_POOL(rx_desc);
-		bm_pool = &port->priv->bm_pools[pool - first_bm_pool];
-		/* Check if buffer header is used */
-		if (unlikely(rx_status & MVPP2_RXD_BUF_HDR)) {
-			mv_pp2x_buff_hdr_rx(port, rx_desc, cpu);
-			continue;
+			/* Chained buffers are walked by the build phase */
+			if (unlikely(rx_desc->status & MVPP2_RXD_BUF_HDR))
+				continue;
+
+			frame->data = phys_to_virt(dma_to_phys(port->dev->dev.parent,
+							       frame->buf_phys_addr));
+			bm_pool = &port->priv->bm_pools[MVPP2_RX_DESC_POOL(rx_desc) -
+							first_bm_pool];
+
+			dma_sync_single_for_cpu(dev->dev.parent, frame->buf_phys_addr,
+						MVPP2_RX_BUF_SIZE(rx_desc->data_size),
+						bm_pool->dma_dir);
+			/* Prefetch 128B packet_header, after the sync has
+			 * invalidated stale lines on non-coherent systems
+			 */
+			prefetch(frame->data + NET_SKB_PAD);
 		}
 
-		if (port->priv->pp2_version == PPV21)
-			buf_phys_addr = mv_pp21_rxdesc_phys_addr_get(rx_desc);
-		else
-			buf_phys_addr = mv_pp22_rxdesc_phys_addr_get(rx_desc);
+		/* Build: run XDP, build skbs and pass them to the stack */
+		for (j = 0; j < batch; j++) {
+			struct mv_pp2x_rx_desc *rx_desc = frames[j].rx_desc;
+			dma_addr_t buf_phys_addr = frames[j].buf_phys_addr;
+			unsigned char *data = frames[j].data;
+			struct mv_pp2x_bm_pool *bm_pool;
+			struct sk_buff *skb;
+			u32 rx_status, pool;
+			int rx_bytes, rx_offset;
+
+			rx_filled++;
+			rx_status = rx_desc->status;
+			rx_bytes = rx_desc->data_size - MVPP2_MH_SIZE;
+			rx_offset = MVPP2_MH_SIZE + NET_SKB_PAD;
+
+			pool = MVPP2_RX_DESC_POOL(rx_desc);
+			bm_pool = &port->priv->bm_pools[pool - first_bm_pool];
+			/* Check if buffer header is used */
+			if (unlikely(rx_status & MVPP2_RXD_BUF_HDR) && !rx_multi_buf) {
+				mv_pp2x_buff_hdr_rx(port, rx_desc, cpu);
+				continue;
+			}
 
-		data = phys_to_virt(dma_to_phys(port->dev->dev.parent, buf_phys_addr));
+			/* Frame is scattered over chained buffers */
+			if (unlikely(rx_status & MVPP2_RXD_BUF_HDR)) {
+				int bufs;
 
-		/* Prefetch 128B packet_header */
-		prefetch(data + NET_SKB_PAD);
-		dma_sync_single_for_cpu(dev->dev.parent, buf_phys_addr,
-					MVPP2_RX_BUF_SIZE(rx_desc->data_size),
-					DMA_FROM_DEVICE);
+				skb = NULL;
+				if (unlikely(rx_status & MVPP2_RXD_ERR_SUMMARY)) {
+					dev->stats.rx_errors++;
+					mv_pp2x_rx_error(port, rx_desc);
+					mv_pp2x_rx_multi_buf_drop(port, bm_pool, buf_phys_addr, cpu);
+					continue;
+				}
+#ifdef MVPP2_XDP
+				/* XDP program can't see the whole frame */
+				if (xdp_prog) {
+					mv_pp2x_rx_multi_buf_drop(port, bm_pool, buf_phys_addr, cpu);
+					rcvd_pkts++;
+					rcvd_bytes += rx_bytes;
+					xdp_drop++;
+					continue;
+				}
+#endif
+				bufs = mv_pp2x_rx_multi_buf(port, bm_pool, buf_phys_addr,
+							    &skb, cpu);
+				refill_array[bm_pool->log_id] += bufs;
+				cp_pcpu->in_use[bm_pool->id] += bufs;
+				if (unlikely(!skb)) {
+					dev->stats.rx_dropped++;
+					continue;
+				}
 
-		/* In case of an error, release the requested buffer pointer
-		 * to the Buffer Manager. This request process is controlled
-		 * by the hardware, and the information about the buffer is
-		 * comprised by the RX descriptor.
-		 */
-		if (unlikely(rx_status & MVPP2_RXD_ERR_SUMMARY)) {
-			netdev_warn(port->dev, "MVPP2_RXD_ERR_SUMMARY\n");
+				rcvd_pkts++;
+				rcvd_bytes += rx_bytes;
+				multi_buf++;
+				goto rx_skb_ready;
+			}
+
+			/* In case of an error, release the requested buffer pointer
+			 * to the Buffer Manager. This request process is controlled
+			 * by the hardware, and the information about the buffer is
+			 * comprised by the RX descriptor.
+			 */
+			if (unlikely(rx_status & MVPP2_RXD_ERR_SUMMARY)) {
+				netdev_warn(port->dev, "MVPP2_RXD_ERR_SUMMARY\n");
 err_drop_frame:
-			dev->stats.rx_errors++;
-			mv_pp2x_rx_error(port, rx_desc);
-			mv_pp2x_pool_refill(port->priv, pool, buf_phys_addr, cpu);
-			continue;
-		}
-		/* Try to get skb from CP skb pool
-		*  If get func return skb -> use mv_pp2x_build_skb to reset skb
-		*  else -> use regular build_skb callback
-		*/
-		skb = mv_pp2_skb_pool_get(port);
-
-		if (skb)
-			mv_pp2x_build_skb(skb, data, bm_pool->frag_size > PAGE_SIZE ? 0 :
-				bm_pool->frag_size);
-		else
-			skb = build_skb(data, bm_pool->frag_size > PAGE_SIZE ? 0 :
-				bm_pool->frag_size);
+				dev->stats.rx_errors++;
+				mv_pp2x_rx_error(port, rx_desc);
+				mv_pp2x_pool_refill(port->priv, pool, buf_phys_addr, cpu);
+				continue;
+			}
 
-		if (unlikely(!skb)) {
-			netdev_warn(port->dev, "skb build failed\n");
-			goto err_drop_frame;
-		}
+#ifdef MVPP2_XDP
+			if (xdp_prog) {
+				struct xdp_buff xdp;
+				u32 act;
 
-		dma_unmap_single(dev->dev.parent, buf_phys_addr,
-				 MVPP2_RX_BUF_SIZE(bm_pool->pkt_size),
-				 DMA_FROM_DEVICE);
-		refill_array[bm_pool->log_id]++;
-		cp_pcpu->in_use[bm_pool->id]++;
+#ifdef MVPP2_XDP_HEADROOM
+				xdp.data_hard_start = data;
+#endif
+				xdp.data = data + rx_offset;
+				xdp.data_end = xdp.data + rx_bytes;
+
+				act = bpf_prog_run_xdp(xdp_prog, &xdp);
+				switch (act) {
+				case XDP_PASS:
+					/* Program may have moved the frame bounds */
+					rx_offset = (unsigned char *)xdp.data - data;
+					rx_bytes = (unsigned char *)xdp.data_end -
+						   (unsigned char *)xdp.data;
+					/* Program may have written the frame, clean it so
+					 * the invalidate done by the unmap can't drop it.
+					 */
+					dma_sync_single_for_device(dev->dev.parent, buf_phys_addr,
+								   MVPP2_RX_BUF_SIZE(rx_desc->data_size),
+								   bm_pool->dma_dir);
+					break;
+				case XDP_TX:
+					if (likely(!mv_pp2x_xdp_tx(port, xdp_txq,
+								   &port->priv->aggr_txqs[cpu],
+								   &xdp, data, buf_phys_addr,
+								   bm_pool, cpu))) {
+						rcvd_pkts++;
+						rcvd_bytes += rx_bytes;
+						xdp_tx++;
+						continue;
+					}
+					goto xdp_drop_frame;
+				default:
+					bpf_warn_invalid_xdp_action(act);
+					/* fall through */
+				case XDP_ABORTED:
+				case XDP_DROP:
+xdp_drop_frame:
+					/* Drop dirty cache lines before buffer goes back to HW */
+					dma_sync_single_for_device(dev->dev.parent, buf_phys_addr,
+								   MVPP2_RX_BUF_SIZE(rx_desc->data_size),
+								   bm_pool->dma_dir);
+					mv_pp2x_pool_refill(port->priv, pool, buf_phys_addr, cpu);
+					rcvd_pkts++;
+					rcvd_bytes += rx_bytes;
+					xdp_drop++;
+					continue;
+				}
+			}
+#endif /* MVPP2_XDP */
+
+			/* Try to get skb from CP skb pool
+			*  If get func return skb -> use mv_pp2x_build_skb to reset skb
+			*  else -> use regular build_skb callback
+			*/
+			skb = mv_pp2_skb_pool_get(port);
+
+			if (skb) {
+				mv_pp2x_build_skb(skb, data, mv_pp2x_bm_frag_size(bm_pool));
+				skb_hit++;
+			} else {
+				skb = build_skb(data, mv_pp2x_bm_frag_size(bm_pool));
+				skb_miss++;
+			}
+
+			if (unlikely(!skb)) {
+				netdev_warn(port->dev, "skb build failed\n");
+				goto err_drop_frame;
+			}
+
+			mv_pp2x_rx_buf_unmap(dev->dev.parent, bm_pool, data, buf_phys_addr);
+			refill_array[bm_pool->log_id]++;
+			cp_pcpu->in_use[bm_pool->id]++;
 
 #ifdef MVPP2_VERBOSE
-		mv_pp2x_skb_dump(skb, rx_desc->data_size, 4);
+			mv_pp2x_skb_dump(skb, rx_desc->data_size, 4);
 #endif
 
-		rcvd_pkts++;
-		rcvd_bytes += rx_bytes;
-		skb_reserve(skb, MVPP2_MH_SIZE + NET_SKB_PAD);
+			rcvd_pkts++;
+			rcvd_bytes += rx_bytes;
+			skb_reserve(skb, rx_offset);
 #ifdef CONFIG_MV_PTP_SERVICE
-		/* If packet is PTP fetch timestamp info and built into packet data */
-		mv_pp2_is_pkt_ptp_rx_proc(port, rx_desc, rx_bytes, skb->data, rcvd_pkts);
+			/* If packet is PTP fetch timestamp info and built into packet data */
+			mv_pp2_is_pkt_ptp_rx_proc(port, rx_desc, rx_bytes, skb->data, rcvd_pkts);
 #endif
-		skb_put(skb, rx_bytes);
-		skb->protocol = eth_type_trans(skb, dev);
-
-		if (likely(dev->features & NETIF_F_RXCSUM))
-			mv_pp2x_rx_csum(port, rx_status, skb);
-		/* Store skb magic id sequence for recycling  */
-		MVPP2X_SKB_MAGIC_BPID_SET(skb, (MVPP2X_SKB_MAGIC(skb) |
-					(port->priv->pp2_cfg.cell_index << 4) |
-							pool));
-
-		skb_record_rx_queue(skb, (u16)rxq->log_id);
-		mv_pp2x_set_skb_hash(rx_desc, rx_status, skb);
-		skb_mark_napi_id(skb, napi);
-
-		napi_gro_receive(napi, skb);
+			skb_put(skb, rx_bytes);
+rx_skb_ready:
+			skb->protocol = eth_type_trans(skb, dev);
+
+			if (likely(dev->features & NETIF_F_RXCSUM))
+				mv_pp2x_rx_csum(port, rx_status, skb);
+			/* Store skb magic id sequence for recycling  */
+			MVPP2X_SKB_MAGIC_BPID_SET(skb, (MVPP2X_SKB_MAGIC(skb) |
+						(port->priv->pp2_cfg.cell_index << 4) |
+								pool));
+
+			skb_record_rx_queue(skb, (u16)rxq->log_id);
+			mv_pp2x_set_skb_hash(rx_desc, rx_status, skb);
+			skb_mark_napi_id(skb, napi);
+
+			napi_gro_receive(napi, skb);
+		}
 	}
 
 	/* Refill pool */
@@ -2686,27 +3928,42 @@ err_drop_frame:
 			continue;
 
 		refill_bm_pool = &port->priv->bm_pools[i];
-		while (likely(refill_array[i]--)) {
-			err = mv_pp2x_rx_refill_new(port, refill_bm_pool,
-						    refill_bm_pool->id, true, cpu);
-			if (unlikely(err)) {
-				netdev_err(port->dev, "failed to refill BM pools\n");
-				refill_array[i]++;
-				rx_filled -= refill_array[i];
-				break;
-			}
+		err = mv_pp2x_rx_refill_bulk(port, refill_bm_pool,
+					     refill_array[i], cpu);
+		if (unlikely(err)) {
+			netdev_err(port->dev, "failed to refill BM pools\n");
+			rx_filled -= err;
 		}
 	}
 
 	if (likely(rcvd_pkts)) {
 		struct mv_pp2x_pcpu_stats *stats = this_cpu_ptr(port->stats);
+		struct queue_vector *q_vec = container_of(napi,
+				struct queue_vector, napi);
+
+		/* Adaptive coalescing samples */
+		q_vec->rx_pkts += rcvd_pkts;
+		q_vec->rx_bytes += rcvd_bytes;
 
 		u64_stats_update_begin(&stats->syncp);
 		stats->rx_packets += rcvd_pkts;
 		stats->rx_bytes   += rcvd_bytes;
+		stats->rx_skb_cache_hit += skb_hit;
+		stats->rx_skb_cache_miss += skb_miss;
+		stats->rx_multi_buf += multi_buf;
+#ifdef MVPP2_XDP
+		stats->rx_xdp_drop += xdp_drop;
+		stats->rx_xdp_tx += xdp_tx;
+#endif
 		u64_stats_update_end(&stats->syncp);
 	}
 
+#ifdef MVPP2_XDP
+	if (xdp_tx)
+		mv_pp2x_xdp_tx_flush(port, xdp_txq, &port->priv->aggr_txqs[cpu],
+				     cp_pcpu);
+#endif
+
 	/* Update Rx queue management counters */
 
 	mv_pp2x_rxq_status_update(port, rxq->id, rx_todo, rx_filled);
@@ -2726,10 +3983,79 @@ static inline void tx_desc_unmap_put(struct device *dev,
 	mv_pp2x_txq_desc_put(txq);
 }
 
-/* Handle tx fragmentation processing */
+/* Routine to check if skb recyclable. Data buffer cannot be recycled if:
+ * 1. skb is cloned, shared, has frag_list, zero copied.
+ * 2. skb with not align data buffer.
+ * 3. IRQs are disabled (netpoll could interrupt per-CPU recycle state).
+ * 4. HW TX timestamp is requested.
+ * Page fragments are allowed, their references are moved to the TX
+ * descriptors and released on TX done.
+ */
+static inline bool mv_pp2x_skb_is_recycleable(const struct sk_buff *skb, int skb_size)
+{
+	if (unlikely(irqs_disabled()))
+		return false;
+
+	if (unlikely(skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY))
+		return false;
+
+	/* TX timestamp is reported to the socket, which recycling drops */
+	if (unlikely(skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP))
+		return false;
+
+	if (unlikely(skb_has_frag_list(skb) || skb->fclone != SKB_FCLONE_UNAVAILABLE))
+		return false;
+
+	skb_size = SKB_DATA_ALIGN(skb_size + NET_SKB_PAD);
+	if (unlikely(skb_end_pointer(skb) - skb->head < skb_size))
+		return false;
+
+	if (unlikely(skb_shared(skb) || skb_cloned(skb)))
+		return false;
+
+	return true;
+}
+
+/* Routine to get BM pool from skb cb */
+static inline struct mv_pp2x_bm_pool *mv_pp2x_skb_recycle_get_pool(struct mv_pp2x *priv, struct sk_buff *skb)
+{
+	if (MVPP2X_SKB_RECYCLE_MAGIC_IS_OK(skb))
+		return &priv->bm_pools[MVPP2X_SKB_BPID_GET(skb)];
+	else
+		return NULL;
+}
+
+/* Routine:
+ * 1. Check that it's save to recycle skb by mv_pp2x_skb_is_recycleable routine
+ * 2. Check if MVPP2 unique hash were set in RX routine.
+ * 3. Check that recycle is on same CPN.
+ * 4. Test skb->cb magic and return BM pool ID if its pass all criterions.
+ * Otherwise -1 returned.
+ */
+static inline int mv_pp2x_skb_recycle_check(struct mv_pp2x *priv, struct sk_buff *skb)
+{
+	struct mv_pp2x_bm_pool *bm_pool;
+	struct mv_pp2x_cp_pcpu *cp_pcpu = this_cpu_ptr(priv->pcpu);
+
+	if ((skb->hash == MVPP2_UNIQUE_HASH) && (MVPP2X_SKB_PP2_CELL_GET(skb) == priv->pp2_cfg.cell_index)) {
+		bm_pool = mv_pp2x_skb_recycle_get_pool(priv, skb);
+		/* Page pool buffers are still referenced by the page ring,
+		 * BUF_MOD recycling needs rx_page_pool=0.
+		 */
+		if (bm_pool && !bm_pool->page_ring)
+			if (mv_pp2x_skb_is_recycleable(skb, bm_pool->pkt_size) && (cp_pcpu->in_use[bm_pool->id] > 0))
+				return bm_pool->id;
+	}
+
+	return -1;
+}
+
+/* Map skb fragments. For recycled skb each descriptor owns reference of its
+ * fragment page, skb itself is released with the first descriptor.
+ */
 static int mv_pp2x_tx_frag_process(struct mv_pp2x_port *port,
 				   struct sk_buff *skb, struct mv_pp2x_aggr_tx_queue *aggr_txq,
-	 struct mv_pp2x_tx_queue *txq)
+	 struct mv_pp2x_tx_queue *txq, bool recycle)
 {
 	struct mv_pp2x_txq_pcpu *txq_pcpu = this_cpu_ptr(txq->pcpu);
 	struct mv_pp2x_tx_desc *tx_desc;
@@ -2755,18 +4081,23 @@ static int mv_pp2x_tx_frag_process(struct mv_pp2x_port *port,
 		mv_pp2x_txdesc_phys_addr_set(port->priv->pp2_version,
 					     buf_phys_addr & ~MVPP2_TX_DESC_DATA_OFFSET, tx_desc);
 
-		if (i == (skb_shinfo(skb)->nr_frags - 1)) {
+		if (recycle) {
+			tx_desc->command = (i == (skb_shinfo(skb)->nr_frags - 1)) ?
+					   MVPP2_TXD_L_DESC : 0;
+			mv_pp2x_txq_inc_put(port->priv->pp2_version, txq_pcpu,
+					    skb_frag_page(frag),
+					    MVPP2_ETH_SHADOW_PAGE, tx_desc);
+		} else if (i == (skb_shinfo(skb)->nr_frags - 1)) {
 			/* Last descriptor */
 			tx_desc->command = MVPP2_TXD_L_DESC;
 			mv_pp2x_txq_inc_put(port->priv->pp2_version, txq_pcpu,
-					    (struct sk_buff *)((uintptr_t)skb | MVPP2_ETH_SHADOW_SKB),
-				tx_desc);
+					    skb, MVPP2_ETH_SHADOW_SKB, tx_desc);
 
 		} else {
 			/* Descriptor in the middle: Not First, Not Last */
 			tx_desc->command = 0;
-			mv_pp2x_txq_inc_put(port->priv->pp2_version,
-					    txq_pcpu, NULL, tx_desc);
+			mv_pp2x_txq_inc_put(port->priv->pp2_version, txq_pcpu,
+					    NULL, MVPP2_ETH_SHADOW_NONE, tx_desc);
 		}
 	}
 
@@ -2793,7 +4124,7 @@ static inline void mv_pp2x_tx_done_post_proc(struct mv_pp2x_tx_queue *txq,
 
 	/* Finalize TX processing */
 	if (txq_count >= txq->pkts_coal)
-		mv_pp2x_txq_done(port, txq, txq_pcpu);
+		mv_pp2x_txq_done(port, txq, txq_pcpu, 0);
 
 	/* Recalc after tx_done */
 	txq_count = mv_pp2x_txq_count(txq_pcpu);
@@ -2806,11 +4137,38 @@ static inline void mv_pp2x_tx_done_post_proc(struct mv_pp2x_tx_queue *txq,
 	}
 }
 
+/* Length of MAC + IP + TCP headers, replicated in front of each segment */
+static inline int mv_pp2_tso_hdr_len(struct sk_buff *skb)
+{
+	return skb_transport_offset(skb) + tcp_hdrlen(skb);
+}
+
 /* Validate TSO */
 static inline int mv_pp2_tso_validate(struct sk_buff *skb, struct net_device *dev)
 {
-	if (!(dev->features & NETIF_F_TSO)) {
-		pr_err("skb_is_gso(skb) returns true but features is not NETIF_F_TSO\n");
+	int gso_type = skb_shinfo(skb)->gso_type;
+
+	if (gso_type & SKB_GSO_TCPV4) {
+		if (!(dev->features & NETIF_F_TSO)) {
+			pr_err("skb_is_gso(skb) returns true but features is not NETIF_F_TSO\n");
+			return 1;
+		}
+		if ((htons(ETH_P_IP) != skb->protocol) ||
+		    (ip_hdr(skb)->protocol != IPPROTO_TCP)) {
+			pr_err("Protocol is not TCP over IP\n");
+			return 1;
+		}
+	} else if (gso_type & SKB_GSO_TCPV6) {
+		if (!(dev->features & NETIF_F_TSO6)) {
+			pr_err("skb_is_gso(skb) returns true but features is not NETIF_F_TSO6\n");
+			return 1;
+		}
+		if (htons(ETH_P_IPV6) != skb->protocol) {
+			pr_err("Protocol is not TCP over IPv6\n");
+			return 1;
+		}
+	} else {
+		pr_err("Unsupported GSO type 0x%x\n", gso_type);
 		return 1;
 	}
 	if (skb_shinfo(skb)->frag_list) {
@@ -2826,41 +4184,75 @@ static inline int mv_pp2_tso_validate(struct sk_buff *skb, struct net_device *de
 		       skb->len, skb_shinfo(skb)->gso_size);
 		return 1;
 	}
-	if ((htons(ETH_P_IP) != skb->protocol) || (ip_hdr(skb)->protocol != IPPROTO_TCP) ||
-	    (!tcp_hdr(skb))) {
-		pr_err("Protocol is not TCP over IP\n");
+	if (mv_pp2_tso_hdr_len(skb) + MVPP2_MH_SIZE > MVPP2_TSO_HDR_SIZE) {
+		pr_err("TSO headers do not fit %d bytes\n", MVPP2_TSO_HDR_SIZE);
 		return 1;
 	}
 
 	return 0;
 }
 
+/* Segment in software the GSO skbs whose headers don't fit a TSO slot,
+ * rather than dropping them in mv_pp2_tso_validate().
+ * The TX descriptor takes the L4 protocol from the IPv6 next header, so
+ * packets with IPv6 extension headers are segmented and checksummed in
+ * software.
+ */
+static netdev_features_t mv_pp2x_features_check(struct sk_buff *skb,
+						struct net_device *dev,
+						netdev_features_t features)
+{
+	if (skb_is_gso(skb) &&
+	    mv_pp2_tso_hdr_len(skb) + MVPP2_MH_SIZE > MVPP2_TSO_HDR_SIZE)
+		features &= ~NETIF_F_GSO_MASK;
+
+	if (skb->ip_summed == CHECKSUM_PARTIAL &&
+	    skb->protocol == htons(ETH_P_IPV6) &&
+	    skb_transport_offset(skb) - skb_network_offset(skb) !=
+	    sizeof(struct ipv6hdr))
+		features &= ~(NETIF_F_IPV6_CSUM | NETIF_F_GSO_MASK);
+
+	return vlan_features_check(skb, features);
+}
+
+/* Headers are built in the TSO header slot of the descriptor being filled,
+ * which is coherent and mapped once at TXQ init.
+ */
 static inline int mv_pp2_tso_build_hdr_desc(struct mv_pp2x_tx_desc *tx_desc,
-					    u8 *data, struct mv_pp2x_port *port,
+					    struct mv_pp2x_port *port,
 					    struct sk_buff *skb,
 					    struct mv_pp2x_txq_pcpu *txq_pcpu,
 					    u16 *mh, int hdr_len, int size,
 					    u32 tcp_seq, u16 ip_id, int left_len)
 {
-	struct iphdr *iph;
 	struct tcphdr *tcph;
-	u8 *mac;
+	u8 *mac, *l3, *data;
 	dma_addr_t buf_phys_addr;
 	int mac_hdr_len = skb_network_offset(skb);
-	u8 *data_orig = data;
+	int hdr_offs = txq_pcpu->txq_put_index * MVPP2_TSO_HDR_SIZE;
+
+	data = txq_pcpu->tso_hdrs + hdr_offs;
+	buf_phys_addr = txq_pcpu->tso_hdrs_phys + hdr_offs;
 
 	/* Reserve 2 bytes for IP header alignment */
 	mac = data + MVPP2_MH_SIZE;
-	iph = (struct iphdr *)(mac + mac_hdr_len);
+	l3 = mac + mac_hdr_len;
+	tcph = (struct tcphdr *)(mac + skb_transport_offset(skb));
 
 	memcpy(mac, skb->data, hdr_len);
 
-	if (iph) {
+	if (skb->protocol == htons(ETH_P_IP)) {
+		struct iphdr *iph = (struct iphdr *)l3;
+
 		iph->id = htons(ip_id);
 		iph->tot_len = htons(size + hdr_len - mac_hdr_len);
+	} else {
+		struct ipv6hdr *ip6h = (struct ipv6hdr *)l3;
+
+		ip6h->payload_len = htons(size + hdr_len - mac_hdr_len -
+					  sizeof(*ip6h));
 	}
 
-	tcph = (struct tcphdr *)(mac + skb_transport_offset(skb));
 	tcph->seq = htonl(tcp_seq);
 
 	if (left_len) {
@@ -2878,45 +4270,41 @@ static inline int mv_pp2_tso_build_hdr_desc(struct mv_pp2x_tx_desc *tx_desc,
 		hdr_len += MVPP2_MH_SIZE;
 	} else {
 		/* Start transmit from MAC */
-		data = mac;
+		buf_phys_addr += MVPP2_MH_SIZE;
 	}
 
 	tx_desc->data_size = hdr_len;
 	tx_desc->command = mv_pp2x_txq_desc_csum(mac_hdr_len, ntohs(skb->protocol),
-				((u8 *)tcph - (u8 *)iph) >> 2, IPPROTO_TCP);
+						 ((u8 *)tcph - l3) >> 2, IPPROTO_TCP);
 	tx_desc->command |= MVPP2_TXD_F_DESC;
 
-	buf_phys_addr = dma_map_single(port->dev->dev.parent, data,
-				       tx_desc->data_size, DMA_TO_DEVICE);
-
-	if (unlikely(dma_mapping_error(port->dev->dev.parent, buf_phys_addr))) {
-		pr_err("%s dma_map_single error\n", __func__);
-		return -1;
-	}
-
 	tx_desc->packet_offset = buf_phys_addr & MVPP2_TX_DESC_DATA_OFFSET;
 
 	mv_pp2x_txdesc_phys_addr_set(port->priv->pp2_version,
 				     buf_phys_addr & ~MVPP2_TX_DESC_DATA_OFFSET, tx_desc);
 
-	mv_pp2x_txq_inc_put(port->priv->pp2_version,
-			    txq_pcpu,
-				(struct sk_buff *)((uintptr_t)data_orig |
-				MVPP2_ETH_SHADOW_EXT), tx_desc);
+	mv_pp2x_txq_inc_put(port->priv->pp2_version, txq_pcpu,
+			    NULL, MVPP2_ETH_SHADOW_EXT, tx_desc);
 
 	return hdr_len;
 }
 
+/* For recycled skb (rec_pool >= 0) head payload is released by HW with its
+ * single data descriptor, which also carries the skb. Last descriptor of each
+ * fragment owns the fragment page reference (frag_page is NULL for head).
+ */
 static inline int mv_pp2_tso_build_data_desc(struct mv_pp2x_port *port,
 					     struct mv_pp2x_tx_desc *tx_desc,
 					     struct sk_buff *skb,
 					     struct mv_pp2x_txq_pcpu *txq_pcpu,
 					     char *frag_ptr, int frag_size,
-					     int data_left, int total_left)
+					     int data_left, int total_left,
+					     int rec_pool, struct page *frag_page)
 {
 	dma_addr_t buf_phys_addr;
 	int size;
-	uintptr_t val = 0;
+	void *cookie = NULL;
+	u8 type = MVPP2_ETH_SHADOW_NONE;
 
 	size = min(frag_size, data_left);
 
@@ -2940,13 +4328,27 @@ static inline int mv_pp2_tso_build_data_desc(struct mv_pp2x_port *port,
 		/* last descriptor in the TCP packet */
 		tx_desc->command = MVPP2_TXD_L_DESC;
 
-		if (total_left == 0) {
+		if (total_left == 0 && rec_pool < 0) {
 			/* last descriptor in SKB */
-			val = ((uintptr_t)skb | MVPP2_ETH_SHADOW_SKB);
+			cookie = skb;
+			type = MVPP2_ETH_SHADOW_SKB;
+		}
+	}
+
+	if (rec_pool >= 0) {
+		if (!frag_page) {
+			tx_desc->command |= MVPP2_TXD_BUF_MOD |
+				((rec_pool << MVPP2_RXD_BM_POOL_ID_OFFS) &
+				 MVPP2_RXD_BM_POOL_ID_MASK);
+			cookie = skb;
+			type = MVPP2_ETH_SHADOW_REC;
+		} else if (size == frag_size) {
+			cookie = frag_page;
+			type = MVPP2_ETH_SHADOW_PAGE;
 		}
 	}
 	mv_pp2x_txq_inc_put(port->priv->pp2_version, txq_pcpu,
-			    (struct sk_buff *)(val), tx_desc);
+			    cookie, type, tx_desc);
 
 	return size;
 }
@@ -2954,19 +4356,20 @@ static inline int mv_pp2_tso_build_data_desc(struct mv_pp2x_port *port,
 /* send tso packet */
 static inline int mv_pp2_tx_tso(struct sk_buff *skb, struct net_device *dev,
 				struct mv_pp2x_tx_queue *txq,
-			 struct mv_pp2x_aggr_tx_queue *aggr_txq, int cpu)
+			 struct mv_pp2x_aggr_tx_queue *aggr_txq, int cpu,
+			 bool *recycled)
 {
-	int frag = 0, i;
+	int frag = 0, i, rec_pool = -1;
+	struct page *frag_page = NULL;
 	int total_len, hdr_len, size, frag_size, data_left;
 	int total_desc_num, total_bytes = 0, max_desc_num = 0;
 	char *frag_ptr;
 	struct mv_pp2x_tx_desc *tx_desc;
 	struct mv_pp2x_port *port = netdev_priv(dev);
 	struct mv_pp2x_txq_pcpu *txq_pcpu = this_cpu_ptr(txq->pcpu);
-	u16 ip_id, *mh = NULL;
+	u16 ip_id = 0, *mh = NULL;
 	u32 tcp_seq = 0;
 	skb_frag_t *skb_frag_ptr;
-	const struct tcphdr *th = tcp_hdr(skb);
 	struct mv_pp2x_cp_pcpu *cp_pcpu = this_cpu_ptr(port->priv->pcpu);
 
 	if (unlikely(mv_pp2_tso_validate(skb, dev)))
@@ -2987,11 +4390,12 @@ static inline int mv_pp2_tx_tso(struct sk_buff *skb, struct net_device *dev,
 			return 0;
 
 	total_len = skb->len;
-	hdr_len = (skb_transport_offset(skb) + tcp_hdrlen(skb));
+	hdr_len = mv_pp2_tso_hdr_len(skb);
 
 	total_len -= hdr_len;
-	ip_id = ntohs(ip_hdr(skb)->id);
-	tcp_seq = ntohl(th->seq);
+	if (skb->protocol == htons(ETH_P_IP))
+		ip_id = ntohs(ip_hdr(skb)->id);
+	tcp_seq = ntohl(tcp_hdr(skb)->seq);
 
 	frag_size = skb_headlen(skb);
 	frag_ptr = skb->data;
@@ -3001,10 +4405,17 @@ static inline int mv_pp2_tx_tso(struct sk_buff *skb, struct net_device *dev,
 		return 0;
 	}
 
-	/* Skip header - we'll add header in another buffer (from extra pool) */
+	/* Skip header - we'll add header in the TSO header slot */
 	frag_size -= hdr_len;
 	frag_ptr += hdr_len;
 
+	/* Head buffer could be recycled only if its payload is sent by single
+	 * descriptor, which points to the same buffer as in non-TSO case.
+	 */
+	if (frag_size > 0 && frag_size <= skb_shinfo(skb)->gso_size &&
+	    frag_ptr - (char *)skb->head <= MVPP2_TX_DESC_DATA_OFFSET)
+		rec_pool = mv_pp2x_skb_recycle_check(port->priv, skb);
+
 	/* A special case where the first skb's frag contains only the packet's header */
 	if (frag_size == 0) {
 		skb_frag_ptr = &skb_shinfo(skb)->frags[frag];
@@ -3012,14 +4423,13 @@ static inline int mv_pp2_tx_tso(struct sk_buff *skb, struct net_device *dev,
 		/* Move to next segment */
 		frag_size = skb_frag_ptr->size;
 		frag_ptr = page_address(skb_frag_ptr->page.p) + skb_frag_ptr->page_offset;
+		frag_page = skb_frag_page(skb_frag_ptr);
 		frag++;
 	}
 	total_desc_num = 0;
 
 	/* Each iteration - create new TCP segment */
 	while (likely(total_len > 0)) {
-		u8 *data;
-
 		data_left = min((int)(skb_shinfo(skb)->gso_size), total_len);
 
 		/* Sanity check */
@@ -3029,18 +4439,13 @@ static inline int mv_pp2_tx_tso(struct sk_buff *skb, struct net_device *dev,
 			goto out_no_tx_desc;
 		}
 
-		data = mv_pp2_extra_pool_get(port);
-		if (unlikely(!data)) {
-			pr_err("Can't allocate extra buffer for TSO\n");
-			goto out_no_tx_desc;
-		}
 		tx_desc = mv_pp2x_txq_next_desc_get(aggr_txq);
 		tx_desc->phys_txq = txq->id;
 
 		total_len -= data_left;
 
 		/* prepare packet headers: MAC + IP + TCP */
-		size = mv_pp2_tso_build_hdr_desc(tx_desc, data, port, skb,
+		size = mv_pp2_tso_build_hdr_desc(tx_desc, port, skb,
 						 txq_pcpu, mh, hdr_len,
 						 data_left, tcp_seq, ip_id,
 						 total_len);
@@ -3064,7 +4469,8 @@ static inline int mv_pp2_tx_tso(struct sk_buff *skb, struct net_device *dev,
 			tx_desc->phys_txq = txq->id;
 
 			size = mv_pp2_tso_build_data_desc(port, tx_desc, skb, txq_pcpu,
-							  frag_ptr, frag_size, data_left, total_len);
+							  frag_ptr, frag_size, data_left, total_len,
+							  rec_pool, frag_page);
 
 			if (unlikely(size < 0))
 				goto out_no_tx_desc;
@@ -3086,108 +4492,50 @@ static inline int mv_pp2_tx_tso(struct sk_buff *skb, struct net_device *dev,
 				/* Move to next segment */
 				frag_size = skb_frag_ptr->size;
 				frag_ptr = page_address(skb_frag_ptr->page.p) + skb_frag_ptr->page_offset;
+				frag_page = skb_frag_page(skb_frag_ptr);
 				frag++;
 			}
 		}
 	}
 
-	aggr_txq->sw_count += total_desc_num;
-	aggr_txq->xmit_bulk += total_desc_num;
-
-	if (!skb->xmit_more) {
-		/* Transmit TCP segment with bulked descriptors and cancel tx hr timer if exist */
-		aggr_txq->sw_count -= aggr_txq->xmit_bulk;
-		aggr_txq->hw_count += aggr_txq->xmit_bulk;
-		mv_pp2x_aggr_txq_pend_desc_add(port, aggr_txq->xmit_bulk);
-		aggr_txq->xmit_bulk = 0;
-		mv_pp2x_tx_timer_kill(cp_pcpu);
-	}
-
-	txq_pcpu->reserved_num -= total_desc_num;
-
-	return total_desc_num;
-
-out_no_tx_desc:
-	/* No enough memory for packet header - rollback */
-	pr_err("%s: No TX descriptors - rollback %d, txq_count=%d, nr_frags=%d, skb=%p, len=%d, gso_segs=%d\n",
-	       __func__, total_desc_num, (aggr_txq->hw_count + aggr_txq->sw_count), skb_shinfo(skb)->nr_frags,
-			skb, skb->len, skb_shinfo(skb)->gso_segs);
-
-	for (i = 0; i < total_desc_num; i++) {
-		struct sk_buff *shadow_skb;
-		dma_addr_t  shadow_buf;
-		int data_size;
-
-		mv_pp2x_txq_dec_put(txq_pcpu);
-
-		shadow_skb = txq_pcpu->tx_skb[txq_pcpu->txq_put_index];
-		shadow_buf = txq_pcpu->tx_buffs[txq_pcpu->txq_put_index];
-		data_size = txq_pcpu->data_size[txq_pcpu->txq_put_index];
-
-		mv_pp2x_txq_buf_free(port, (uintptr_t)shadow_skb, shadow_buf,
-				     data_size, cpu);
-
-		mv_pp2x_txq_prev_desc_get(aggr_txq);
+	/* Fragment references are owned by TX descriptors now. Head buffer
+	 * could be reused by HW once sent, so do it before the doorbell.
+	 */
+	if (rec_pool >= 0) {
+		skb_shinfo(skb)->nr_frags = 0;
+		/* Recycled shell waits in skb cache, drop its socket and dst */
+		skb_orphan(skb);
+		skb_dst_drop(skb);
+		*recycled = true;
 	}
 
-	return 0;
-}
-
-/* Routine to check if skb recyclable. Data buffer cannot be recycled if:
- * 1. skb is cloned, shared, nonlinear, zero copied.
- * 2. skb with not align data buffer.
- * 3. IRQs are disabled.
- */
-static inline bool mv_pp2x_skb_is_recycleable(const struct sk_buff *skb, int skb_size)
-{
-	if (unlikely(irqs_disabled()))
-		return false;
-
-	if (unlikely(skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY))
-		return false;
-
-	if (unlikely(skb_is_nonlinear(skb) || skb->fclone != SKB_FCLONE_UNAVAILABLE))
-		return false;
+	aggr_txq->sw_count += total_desc_num;
+	aggr_txq->xmit_bulk += total_desc_num;
+	aggr_txq->xmit_bytes += total_bytes;
 
-	skb_size = SKB_DATA_ALIGN(skb_size + NET_SKB_PAD);
-	if (unlikely(skb_end_pointer(skb) - skb->head < skb_size))
-		return false;
+	mv_pp2x_tx_doorbell(port, aggr_txq, cp_pcpu,
+			    mv_pp2x_tx_bql_sent(port, txq, skb, cpu));
 
-	if (unlikely(skb_shared(skb) || skb_cloned(skb)))
-		return false;
+	txq_pcpu->reserved_num -= total_desc_num;
 
-	return true;
-}
+	return total_desc_num;
 
-/* Routine to get BM pool from skb cb */
-static inline struct mv_pp2x_bm_pool *mv_pp2x_skb_recycle_get_pool(struct mv_pp2x *priv, struct sk_buff *skb)
-{
-	if (MVPP2X_SKB_RECYCLE_MAGIC_IS_OK(skb))
-		return &priv->bm_pools[MVPP2X_SKB_BPID_GET(skb)];
-	else
-		return NULL;
-}
+out_no_tx_desc:
+	/* No enough memory for packet header - rollback */
+	pr_err("%s: No TX descriptors - rollback %d, txq_count=%d, nr_frags=%d, skb=%p, len=%d, gso_segs=%d\n",
+	       __func__, total_desc_num, (aggr_txq->hw_count + aggr_txq->sw_count), skb_shinfo(skb)->nr_frags,
+			skb, skb->len, skb_shinfo(skb)->gso_segs);
 
-/* Routine:
- * 1. Check that it's save to recycle skb by mv_pp2x_skb_is_recycleable routine
- * 2. Check if MVPP2 unique hash were set in RX routine.
- * 3. Check that recycle is on same CPN.
- * 4. Test skb->cb magic and return BM pool ID if its pass all criterions.
- * Otherwise -1 returned.
- */
-static inline int mv_pp2x_skb_recycle_check(struct mv_pp2x *priv, struct sk_buff *skb)
-{
-	struct mv_pp2x_bm_pool *bm_pool;
-	struct mv_pp2x_cp_pcpu *cp_pcpu = this_cpu_ptr(priv->pcpu);
+	for (i = 0; i < total_desc_num; i++) {
+		mv_pp2x_txq_dec_put(txq_pcpu);
 
-	if ((skb->hash == MVPP2_UNIQUE_HASH) && (MVPP2X_SKB_PP2_CELL_GET(skb) == priv->pp2_cfg.cell_index)) {
-		bm_pool = mv_pp2x_skb_recycle_get_pool(priv, skb);
-		if (bm_pool)
-			if (mv_pp2x_skb_is_recycleable(skb, bm_pool->pkt_size) && (cp_pcpu->in_use[bm_pool->id] > 0))
-				return bm_pool->id;
+		mv_pp2x_txq_buf_free(port,
+				     &txq_pcpu->shadow[txq_pcpu->txq_put_index]);
+
+		mv_pp2x_txq_prev_desc_get(aggr_txq);
 	}
 
-	return -1;
+	return 0;
 }
 
 /* Main tx processing */
@@ -3206,16 +4554,17 @@ static int mv_pp2x_tx(struct sk_buff *skb, struct net_device *dev)
 	int cpu = smp_processor_id();
 	struct mv_pp2x_cp_pcpu *cp_pcpu = this_cpu_ptr(port->priv->pcpu);
 	u8 recycling;
+	bool recycled = false;
 
 	/* Set relevant physical TxQ and Linux netdev queue */
-	txq_id = skb_get_queue_mapping(skb) % mv_pp2x_txq_number;
+	txq_id = skb_get_queue_mapping(skb) / mv_pp2x_txq_ncpus(port);
 	txq = port->txqs[txq_id];
 	txq_pcpu = this_cpu_ptr(txq->pcpu);
 	aggr_txq = &port->priv->aggr_txqs[cpu];
 
 	/* Prevent shadow_q override, stop tx_queue until tx_done is called*/
 	if (unlikely(mv_pp2x_txq_free_count(txq_pcpu) < port->txq_stop_limit)) {
-		if ((txq->log_id + (cpu * mv_pp2x_txq_number)) == skb_get_queue_mapping(skb)) {
+		if (mv_pp2x_txq_ndev_queue(port, txq->log_id, cpu) == skb_get_queue_mapping(skb)) {
 			nq = netdev_get_tx_queue(dev, skb_get_queue_mapping(skb));
 			netif_tx_stop_queue(nq);
 		}
@@ -3225,7 +4574,7 @@ static int mv_pp2x_tx(struct sk_buff *skb, struct net_device *dev)
 
 	/* GSO/TSO */
 	if (skb_is_gso(skb)) {
-		frags = mv_pp2_tx_tso(skb, dev, txq, aggr_txq, cpu);
+		frags = mv_pp2_tx_tso(skb, dev, txq, aggr_txq, cpu, &recycled);
 		goto out;
 	}
 
@@ -3290,53 +4639,65 @@ static int mv_pp2x_tx(struct sk_buff *skb, struct net_device *dev)
 
 	tx_cmd = mv_pp2x_skb_tx_csum(port, skb);
 
+	/* Check if skb should be recycled */
+	pool_id = mv_pp2x_skb_recycle_check(port->priv, skb);
+	/* If pool ID provided -> packet should be recycled.
+	*  Set recycled field in TX descriptor and add skb recycle shadow.
+	*/
+	if (pool_id > -1) {
+		tx_cmd |= MVPP2_TXD_BUF_MOD;
+		tx_cmd |= ((pool_id << MVPP2_RXD_BM_POOL_ID_OFFS) & MVPP2_RXD_BM_POOL_ID_MASK);
+		recycling = MVPP2_ETH_SHADOW_REC;
+		/* Recycled shell waits in skb cache, drop its socket and dst */
+		skb_orphan(skb);
+		skb_dst_drop(skb);
+	} else {
+		recycling = MVPP2_ETH_SHADOW_SKB;
+	}
+
 	if (frags == 1) {
 		/* First and Last descriptor */
-		/* Check if skb should be recycled */
-		pool_id = mv_pp2x_skb_recycle_check(port->priv, skb);
-		/* If pool ID provided -> packet should be recycled.
-		*  Set recycled field in TX descriptor and add skb recycle shadow.
-		*/
-		if (pool_id > -1) {
-			tx_cmd |= MVPP2_TXD_BUF_MOD;
-			tx_cmd |= ((pool_id << MVPP2_RXD_BM_POOL_ID_OFFS) & MVPP2_RXD_BM_POOL_ID_MASK);
-			recycling = MVPP2_ETH_SHADOW_REC;
-		} else {
-			recycling = MVPP2_ETH_SHADOW_SKB;
-		}
-
 		tx_cmd |= MVPP2_TXD_F_DESC | MVPP2_TXD_L_DESC;
 		tx_desc->command = tx_cmd;
-		mv_pp2x_txq_inc_put(port->priv->pp2_version,
-				    txq_pcpu, (struct sk_buff *)((uintptr_t)skb |
-					recycling), tx_desc);
+		mv_pp2x_txq_inc_put(port->priv->pp2_version, txq_pcpu,
+				    skb, recycling, tx_desc);
 	} else {
-		/* First but not Last */
+		/* First but not Last, recycled skb is released with its head */
 		tx_cmd |= MVPP2_TXD_F_DESC | MVPP2_TXD_PADDING_DISABLE;
 		tx_desc->command = tx_cmd;
-		mv_pp2x_txq_inc_put(port->priv->pp2_version,
-				    txq_pcpu, NULL, tx_desc);
+		if (pool_id > -1)
+			mv_pp2x_txq_inc_put(port->priv->pp2_version, txq_pcpu,
+					    skb, recycling, tx_desc);
+		else
+			mv_pp2x_txq_inc_put(port->priv->pp2_version, txq_pcpu,
+					    NULL, MVPP2_ETH_SHADOW_NONE, tx_desc);
 
 		/* Continue with other skb fragments */
-		if (unlikely(mv_pp2x_tx_frag_process(port, skb, aggr_txq, txq))) {
+		if (unlikely(mv_pp2x_tx_frag_process(port, skb, aggr_txq, txq,
+						     pool_id > -1))) {
 			mv_pp2x_txq_inc_error(txq_pcpu, 1);
 			tx_desc_unmap_put(port->dev->dev.parent, txq, tx_desc);
 			frags = 0;
 			goto out;
 		}
+
+		/* Fragment references are owned by TX descriptors now */
+		if (pool_id > -1)
+			skb_shinfo(skb)->nr_frags = 0;
 	}
+	recycled = pool_id > -1;
 	txq_pcpu->reserved_num -= frags;
 	aggr_txq->sw_count += frags;
 	aggr_txq->xmit_bulk += frags;
+	aggr_txq->xmit_bytes += skb->len;
 
 #ifdef CONFIG_MV_PTP_SERVICE
 	/* If packet is PTP add Time-Stamp request into the tx_desc */
 	mv_pp2_is_pkt_ptp_tx_proc(port, tx_desc, skb);
 #endif
 
-	/* Start 50 microseconds timer to transmit */
-	if (!skb->xmit_more)
-		mv_pp2x_tx_timer_set(cp_pcpu);
+	mv_pp2x_tx_doorbell(port, aggr_txq, cp_pcpu,
+			    mv_pp2x_tx_bql_sent(port, txq, skb, cpu));
 
 out:
 	if (likely(frags > 0)) {
@@ -3345,16 +4706,14 @@ out:
 		u64_stats_update_begin(&stats->syncp);
 		stats->tx_packets++;
 		stats->tx_bytes += skb->len;
+		if (recycled)
+			stats->tx_skb_recycled++;
+		else
+			stats->tx_skb_freed++;
 		u64_stats_update_end(&stats->syncp);
 	} else {
 		/* Transmit bulked descriptors*/
-		if (aggr_txq->xmit_bulk > 0) {
-			mv_pp2x_tx_timer_kill(cp_pcpu);
-			aggr_txq->sw_count -= aggr_txq->xmit_bulk;
-			aggr_txq->hw_count += aggr_txq->xmit_bulk;
-			mv_pp2x_aggr_txq_pend_desc_add(port, aggr_txq->xmit_bulk);
-			aggr_txq->xmit_bulk = 0;
-		}
+		mv_pp2x_aggr_txq_flush(port->priv, aggr_txq, cp_pcpu);
 		dev->stats.tx_dropped++;
 		dev_kfree_skb_any(skb);
 	}
@@ -3371,6 +4730,217 @@ out:
 	return NETDEV_TX_OK;
 }
 
+/* Dynamic interrupt moderation.
+ * Every MVPP2_DIM_NEVENTS polls of a queue vector byte, packet and poll
+ * rates are compared to the previous window and the coalescing profile
+ * is moved one step further in the direction that improved them. Going
+ * back after a single step parks the vector on the previous profile
+ * until the traffic changes significantly.
+ */
+static const struct mv_pp2x_dim_profile
+mv_pp2x_dim_rx_profile[MVPP2_DIM_PROFILES_NUM] = {
+	{1, 1}, {8, 16}, {64, 32}, {128, 64}, {256, 128}
+};
+
+/* TX done time threshold is per port, only packets threshold is adapted */
+static const u32 mv_pp2x_dim_tx_profile[MVPP2_DIM_PROFILES_NUM] = {
+	16, 32, 64, 128, 256
+};
+
+enum {
+	MVPP2_DIM_WORSE,
+	MVPP2_DIM_SAME,
+	MVPP2_DIM_BETTER
+};
+
+static int mv_pp2x_dim_rate_cmp(u32 curr, u32 prev)
+{
+	u64 diff = (curr > prev) ? curr - prev : prev - curr;
+
+	if (!prev)
+		return curr ? MVPP2_DIM_BETTER : MVPP2_DIM_SAME;
+
+	if (100 * diff <= (u64)prev * MVPP2_DIM_DIFF_PCT)
+		return MVPP2_DIM_SAME;
+
+	return (curr > prev) ? MVPP2_DIM_BETTER : MVPP2_DIM_WORSE;
+}
+
+static int mv_pp2x_dim_stats_cmp(struct mv_pp2x_dim *dim, u32 ppms,
+				 u32 bpms, u32 epms)
+{
+	int res;
+
+	res = mv_pp2x_dim_rate_cmp(bpms, dim->bpms);
+	if (res != MVPP2_DIM_SAME)
+		return res;
+
+	res = mv_pp2x_dim_rate_cmp(ppms, dim->ppms);
+	if (res != MVPP2_DIM_SAME || !dim->epms)
+		return res;
+
+	/* Same traffic with less interrupts is better */
+	switch (mv_pp2x_dim_rate_cmp(epms, dim->epms)) {
+	case MVPP2_DIM_BETTER:
+		return MVPP2_DIM_WORSE;
+	case MVPP2_DIM_WORSE:
+		return MVPP2_DIM_BETTER;
+	default:
+		return MVPP2_DIM_SAME;
+	}
+}
+
+/* Move profile according to the window result, return true if changed */
+static bool mv_pp2x_dim_decide(struct mv_pp2x_dim *dim, int res)
+{
+	bool park = false;
+
+	if (dim->state == MVPP2_DIM_PARKING) {
+		if (res == MVPP2_DIM_SAME)
+			return false;
+		dim->state = dim->profile_ix ? MVPP2_DIM_GOING_LEFT :
+					       MVPP2_DIM_GOING_RIGHT;
+		dim->steps = 0;
+	} else if (res != MVPP2_DIM_BETTER) {
+		park = (dim->steps == 1);
+		dim->state = (dim->state == MVPP2_DIM_GOING_RIGHT) ?
+			     MVPP2_DIM_GOING_LEFT : MVPP2_DIM_GOING_RIGHT;
+		dim->steps = 0;
+	}
+
+	if (dim->state == MVPP2_DIM_GOING_RIGHT &&
+	    dim->profile_ix < MVPP2_DIM_PROFILES_NUM - 1) {
+		dim->profile_ix++;
+	} else if (dim->state == MVPP2_DIM_GOING_LEFT && dim->profile_ix) {
+		dim->profile_ix--;
+	} else {
+		dim->state = MVPP2_DIM_PARKING;
+		return false;
+	}
+
+	dim->steps++;
+	if (park)
+		dim->state = MVPP2_DIM_PARKING;
+
+	return true;
+}
+
+static void mv_pp2x_dim_reset(struct mv_pp2x_dim *dim)
+{
+	memset(dim, 0, sizeof(*dim));
+	dim->profile_ix = MVPP2_DIM_DEF_PROFILE;
+}
+
+/* Account one poll, return true if a new profile should be programmed */
+static bool mv_pp2x_dim_sample(struct mv_pp2x_dim *dim, u64 pkts, u64 bytes)
+{
+	ktime_t now;
+	u32 ppms, bpms, epms;
+	s64 usecs;
+	bool changed;
+
+	/* First poll after reset starts the window with default profile */
+	if (!ktime_to_ns(dim->start_time)) {
+		changed = true;
+		now = ktime_get();
+		goto new_window;
+	}
+
+	if (++dim->events < MVPP2_DIM_NEVENTS)
+		return false;
+
+	now = ktime_get();
+	usecs = ktime_us_delta(now, dim->start_time);
+	if (usecs <= 0)
+		return false;
+
+	ppms = div64_s64((pkts - dim->start_pkts) * USEC_PER_MSEC, usecs);
+	bpms = div64_s64((bytes - dim->start_bytes) * USEC_PER_MSEC, usecs);
+	epms = div64_s64((s64)dim->events * USEC_PER_MSEC, usecs);
+
+	changed = mv_pp2x_dim_decide(dim,
+				     mv_pp2x_dim_stats_cmp(dim, ppms, bpms, epms));
+	dim->ppms = ppms;
+	dim->bpms = bpms;
+	dim->epms = epms;
+
+new_window:
+	dim->start_time = now;
+	dim->start_pkts = pkts;
+	dim->start_bytes = bytes;
+	dim->events = 0;
+
+	return changed;
+}
+
+static void mv_pp2x_dim_poll(struct mv_pp2x_port *port,
+			     struct queue_vector *q_vec)
+{
+	if ((port->flags & MVPP2_F_DIM_RX) && q_vec->num_rx_queues &&
+	    mv_pp2x_dim_sample(&q_vec->rx_dim, q_vec->rx_pkts, q_vec->rx_bytes)) {
+		const struct mv_pp2x_dim_profile *prof =
+			&mv_pp2x_dim_rx_profile[q_vec->rx_dim.profile_ix];
+		int queue;
+
+		for (queue = q_vec->first_rx_queue;
+		     queue < q_vec->first_rx_queue + q_vec->num_rx_queues; queue++) {
+			struct mv_pp2x_rx_queue *rxq = port->rxqs[queue];
+
+			if (rxq->ext_pool)
+				continue;
+			mv_pp2x_rx_coal_thresh_set(port, rxq, prof->pkts,
+						   prof->usecs);
+		}
+	}
+
+	if ((port->flags & MVPP2_F_DIM_TX) && q_vec->qv_type == MVPP2_PRIVATE) {
+		struct mv_pp2x_pcpu_stats *stats = per_cpu_ptr(port->stats,
+				QV_THR_2_CPU(q_vec->sw_thread_id));
+
+		if (mv_pp2x_dim_sample(&q_vec->tx_dim, stats->tx_packets,
+				       stats->tx_bytes))
+			mv_pp22_tx_done_pkts_thresh_set(port, q_vec->sw_thread_id,
+				mv_pp2x_dim_tx_profile[q_vec->tx_dim.profile_ix]);
+	}
+}
+
+/* Enable/disable adaptive coalescing. Adaptive mode programs HW thresholds
+ * only, static rxq/txq coalescing configuration is restored when it is
+ * disabled.
+ */
+void mv_pp2x_dim_set(struct mv_pp2x_port *port, bool rx, bool tx)
+{
+	u32 old_flags = port->flags;
+	int i;
+
+	port->flags &= ~(MVPP2_F_DIM_RX | MVPP2_F_DIM_TX);
+	/* Wait for running NAPI polls */
+	synchronize_net();
+
+	for (i = 0; i < port->num_qvector; i++) {
+		mv_pp2x_dim_reset(&port->q_vector[i].rx_dim);
+		mv_pp2x_dim_reset(&port->q_vector[i].tx_dim);
+	}
+
+	if ((old_flags & MVPP2_F_DIM_RX) && !rx) {
+		for (i = 0; i < port->num_rx_queues; i++) {
+			struct mv_pp2x_rx_queue *rxq = port->rxqs[i];
+
+			if (rxq->ext_pool)
+				continue;
+			mv_pp2x_rx_pkts_coal_set(port, rxq);
+			mv_pp2x_rx_time_coal_set(port, rxq);
+		}
+	}
+	if ((old_flags & MVPP2_F_DIM_TX) && !tx)
+		on_each_cpu(mv_pp2x_tx_done_pkts_coal_set, port, 1);
+
+	if (rx)
+		port->flags |= MVPP2_F_DIM_RX;
+	if (tx)
+		port->flags |= MVPP2_F_DIM_TX;
+}
+
 static inline void mv_pp2x_cause_misc_handle(struct mv_pp2x_port *port,
 					     struct mv_pp2x_hw *hw, u32 cause_rx_tx)
 {
@@ -3392,12 +4962,22 @@ static inline int mv_pp2x_cause_rx_handle(struct mv_pp2x_port *port,
 {
 	int rx_done = 0, count = 0;
 	struct mv_pp2x_rx_queue *rxq;
+	struct mv_pp2x_cp_pcpu *cp_pcpu = this_cpu_ptr(port->priv->pcpu);
+
+	/* Packets forwarded from this poll are sent with one doorbell */
+	cp_pcpu->in_napi = true;
 
 	while (cause_rx && budget > 0) {
 		rxq = mv_pp2x_get_rx_queue(port, cause_rx);
 		if (!rxq)
 			break;
 
+		/* RXQ is polled by user space owner */
+		if (unlikely(rxq->ext_pool)) {
+			cause_rx &= ~(1 << rxq->log_id);
+			continue;
+		}
+
 		count = mv_pp2x_rx(port, &q_vec->napi, budget, rxq);
 		rx_done += count;
 		budget -= count;
@@ -3410,6 +4990,16 @@ static inline int mv_pp2x_cause_rx_handle(struct mv_pp2x_port *port,
 		}
 	}
 
+	cp_pcpu->in_napi = false;
+	q_vec->repoll = (budget <= 0);
+	mv_pp2x_aggr_txq_flush(port->priv,
+			       &port->priv->aggr_txqs[smp_processor_id()],
+			       cp_pcpu);
+
+	/* Sample before NAPI completes, poll may be rescheduled on other CPU */
+	if (port->flags & (MVPP2_F_DIM_RX | MVPP2_F_DIM_TX))
+		mv_pp2x_dim_poll(port, q_vec);
+
 #ifdef DEV_NETMAP
 	if ((port->flags & MVPP2_F_IFCAP_NETMAP)) {
 		napi_complete(napi);
@@ -3420,14 +5010,57 @@ static inline int mv_pp2x_cause_rx_handle(struct mv_pp2x_port *port,
 
 	if (budget > 0) {
 		cause_rx = 0;
-		napi_complete(napi);
+#ifdef MVPP2_NAPI_DONE_RET
+		/* Interrupt stays masked while busy polling owns NAPI */
+		if (napi_complete_done(napi, rx_done))
+			mv_pp2x_qvector_interrupt_enable(q_vec);
+#else
+		napi_complete_done(napi, rx_done);
 		mv_pp2x_qvector_interrupt_enable(q_vec);
+#endif
 	}
 	q_vec->pending_cause_rx = cause_rx;
 
 	return rx_done;
 }
 
+/* Account poll origin: interrupt or busy polling socket. Polls continuing
+ * work of a poll that exhausted its budget are not counted.
+ */
+static inline void mv_pp2x_poll_account(struct mv_pp2x_port *port,
+					struct queue_vector *q_vec)
+{
+	struct mv_pp2x_pcpu_stats *stats;
+
+	if (q_vec->repoll)
+		return;
+
+	stats = this_cpu_ptr(port->stats);
+	u64_stats_update_begin(&stats->syncp);
+	if (q_vec->irq_sched)
+		stats->rx_irq_polls++;
+	else
+		stats->rx_busy_polls++;
+	u64_stats_update_end(&stats->syncp);
+	q_vec->irq_sched = false;
+}
+
+/* Serve pending RX queues without reading cause register. Cause register
+ * is still read every MVPP2_CAUSE_SKIP_MAX polls for new RX queues. Private
+ * vectors also get TX done and misc events there, it is read on each of
+ * their polls not to delay them.
+ */
+static inline bool mv_pp2x_cause_skip(struct queue_vector *q_vec)
+{
+	if (q_vec->qv_type != MVPP2_SHARED || !q_vec->pending_cause_rx ||
+	    ++q_vec->cause_skip >= MVPP2_CAUSE_SKIP_MAX) {
+		q_vec->cause_skip = 0;
+		return false;
+	}
+
+	return true;
+}
+
 static int mv_pp21_poll(struct napi_struct *napi, int budget)
 {
 	u32 cause_rx_tx, cause_rx;
@@ -3437,6 +5070,11 @@ static int mv_pp21_poll(struct napi_struct *napi, int budget)
 	struct queue_vector *q_vec = container_of(napi,
 			struct queue_vector, napi);
 
+	mv_pp2x_poll_account(port, q_vec);
+	if (mv_pp2x_cause_skip(q_vec))
+		return mv_pp2x_cause_rx_handle(port, q_vec, napi, budget,
+					       q_vec->pending_cause_rx);
+
 	/* Rx/Tx cause register
 	 *
 	 * Bits 0-15: each bit indicates received packets on the Rx queue
@@ -3472,6 +5110,11 @@ static int mv_pp22_poll(struct napi_struct *napi, int budget)
 	struct queue_vector *q_vec = container_of(napi,
 			struct queue_vector, napi);
 
+	mv_pp2x_poll_account(port, q_vec);
+	if (mv_pp2x_cause_skip(q_vec))
+		return mv_pp2x_cause_rx_handle(port, q_vec, napi, budget,
+					       q_vec->pending_cause_rx);
+
 	/* Rx/Tx cause register
 	 * Each CPU has its own Tx cause register
 	 */
@@ -3491,7 +5134,7 @@ static int mv_pp22_poll(struct napi_struct *napi, int budget)
 			MVPP2_CAUSE_TXQ_OCCUP_DESC_ALL_OFFSET;
 	if (cause_tx) {
 		cpu = QV_THR_2_CPU(q_vec->sw_thread_id);
-		mv_pp2x_tx_done(port, cause_tx, cpu);
+		mv_pp2x_tx_done(port, cause_tx, cpu, budget);
 	}
 
 	/* Process RX packets */
@@ -3846,7 +5489,7 @@ int mv_pp2x_open_cls(struct net_device *dev)
 	unsigned char mac_bcast[ETH_ALEN] = {
 			0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
 	struct mv_pp2x_hw *hw = &port->priv->hw;
-	int err;
+	int err, i;
 	u32 cpu_width = 0, cos_width = 0, port_rxq_width = 0;
 	u8 bound_cpu_first_rxq;
 
@@ -3915,11 +5558,14 @@ int mv_pp2x_open_cls(struct net_device *dev)
 
 	/* RSS related config */
 	if (port->priv->pp2_cfg.queue_mode == MVPP2_QDIST_MULTI_MODE) {
-		/* Set RSS mode */
-		err = mv_pp22_rss_mode_set(port, port->rss_cfg.rss_mode);
-		if (err) {
-			netdev_err(port->dev, "cannot set rss mode\n");
-			return err;
+		/* Set RSS hash fields */
+		for (i = 0; i < MVPP2_RSS_FLOW_NUM; i++) {
+			err = mv_pp22_rss_hash_opts_set(port, i,
+							port->rss_cfg.hash_opts[i]);
+			if (err) {
+				netdev_err(port->dev, "cannot set rss hash fields\n");
+				return err;
+			}
 		}
 
 		/* Init RSS table */
@@ -4017,6 +5663,9 @@ int mv_pp2x_stop(struct net_device *dev)
 	int cpu;
 
 	mv_pp2x_stop_dev(port);
+#ifdef CONFIG_RFS_ACCEL
+	mv_pp2x_arfs_flush(port);
+#endif
 
 	/* Mask interrupts on all CPUs */
 	on_each_cpu(mv_pp2x_interrupts_mask, port, 1);
@@ -4202,6 +5851,13 @@ static int mv_pp2x_change_mtu(struct net_device *dev, int mtu)
 		goto error;
 	}
 
+#ifdef MVPP2_XDP
+	if (port->xdp_prog && MVPP2_RX_PKT_SIZE(mtu) > MVPP2_BM_LONG_PKT_SIZE) {
+		netdev_err(dev, "MTU %d is not supported with XDP program\n", mtu);
+		return -EINVAL;
+	}
+#endif
+
 	if (!netif_running(dev)) {
 		err = mv_pp2x_bm_update_mtu(dev, mtu);
 		if (!err) {
@@ -4262,6 +5918,7 @@ static struct rtnl_link_stats64 *
 mv_pp2x_get_stats64(struct net_device *dev, struct rtnl_link_stats64 *stats)
 {
 	struct mv_pp2x_port *port = netdev_priv(dev);
+	struct gop_stat gop_statistics;
 	unsigned int start;
 	int cpu;
 
@@ -4291,6 +5948,29 @@ mv_pp2x_get_stats64(struct net_device *dev, struct rtnl_link_stats64 *stats)
 	stats->rx_dropped	= dev->stats.rx_dropped;
 	stats->tx_dropped	= dev->stats.tx_dropped;
 
+	if (port->priv->pp2_version == PPV21)
+		return stats;
+
+	/* MAC errors and PPv2 drops, packets not given to the driver */
+	mv_pp2x_port_stats_get(port, &gop_statistics);
+	stats->multicast	= gop_statistics.rx_mcast;
+	stats->collisions	= gop_statistics.collision +
+				  gop_statistics.late_collision;
+	stats->rx_crc_errors	= gop_statistics.rx_crc;
+	stats->rx_length_errors	= gop_statistics.rx_runt +
+				  gop_statistics.rx_giant +
+				  gop_statistics.rx_fragments_err +
+				  gop_statistics.rx_jabber;
+	stats->rx_fifo_errors	= gop_statistics.rx_mac_overrun;
+	stats->rx_missed_errors	= gop_statistics.rx_ppv2_overrun +
+				  gop_statistics.rx_fullq_drop +
+				  gop_statistics.rx_early_drop +
+				  gop_statistics.rx_bm_drop;
+	stats->rx_errors	+= stats->rx_crc_errors +
+				   stats->rx_length_errors +
+				   stats->rx_fifo_errors +
+				   gop_statistics.rx_mac_err;
+
 	return stats;
 }
 
@@ -4330,6 +6010,14 @@ static int mv_pp2x_netdev_set_features(struct net_device *dev,
 	if (!changed)
 		return 0;
 
+#ifdef MVPP2_TC_FLOWER
+	if ((changed & NETIF_F_HW_TC) && !(features & NETIF_F_HW_TC) &&
+	    (port->tc_flower_num || port->plcr != MVPP2_PLCR_NONE)) {
+		netdev_err(dev, "offloaded tc filters, cannot disable hw-tc-offload\n");
+		return -EBUSY;
+	}
+#endif
+
 	if (changed & NETIF_F_RXHASH) {
 		if (features & NETIF_F_RXHASH) {
 			/* Enable RSS */
@@ -4340,8 +6028,8 @@ static int mv_pp2x_netdev_set_features(struct net_device *dev,
 		}
 	}
 
-	if (changed & NETIF_F_TSO) {
-		if (features & NETIF_F_TSO)
+	if (changed & MVPP2_TSO_FEATURES) {
+		if (features & MVPP2_TSO_FEATURES)
 			port->txq_stop_limit = TSO_TXQ_LIMIT;
 		else
 			port->txq_stop_limit = TXQ_LIMIT;
@@ -4349,6 +6037,11 @@ static int mv_pp2x_netdev_set_features(struct net_device *dev,
 
 	dev->features = features;
 
+#ifdef CONFIG_RFS_ACCEL
+	if (changed & NETIF_F_NTUPLE)
+		mv_pp2x_arfs_enable(port, !!(features & NETIF_F_NTUPLE));
+#endif
+
 	return 0;
 }
 
@@ -4356,16 +6049,94 @@ u16 mv_pp2x_select_queue(struct net_device *dev, struct sk_buff *skb,
 			 void *accel_priv, select_queue_fallback_t fallback)
 
 {
+	struct mv_pp2x_port *port = netdev_priv(dev);
 	int val;
 
+	/* Offloaded traffic class i is sent on TXQ i */
+	if (port->num_tc)
+		val = netdev_get_prio_tc_map(dev, skb->priority);
 	/* If packet in coming from Rx -> RxQ = TxQ, callback function used for packets from CPU Tx */
-	if (skb->queue_mapping)
+	else if (skb->queue_mapping)
 		val = skb->queue_mapping - 1;
 	else
 		val = fallback(dev, skb);
 
-	return (val % mv_pp2x_txq_number) + (smp_processor_id() * mv_pp2x_txq_number);
+	return mv_pp2x_txq_ndev_queue(port, val % mv_pp2x_txq_number,
+				      smp_processor_id());
+}
+
+/* Netdev TX queues of all CPUs for a TXQ share its shaper */
+static int mv_pp2x_set_tx_maxrate(struct net_device *dev, int index,
+				  u32 maxrate)
+{
+	struct mv_pp2x_port *port = netdev_priv(dev);
+	int txq = index / mv_pp2x_txq_ncpus(port);
+	int ret;
+
+	ret = mv_pp2x_txq_rate_set(port, txq, maxrate);
+	if (ret)
+		return ret;
+	port->txq_maxrate[txq] = maxrate;
+
+	return 0;
+}
+
+#ifdef MVPP2_XDP
+static int mv_pp2x_xdp_setup(struct net_device *dev, struct bpf_prog *prog)
+{
+	struct mv_pp2x_port *port = netdev_priv(dev);
+	struct bpf_prog *old_prog;
+	int rxq;
+
+	if (prog && port->priv->pp2_version == PPV21) {
+		netdev_err(dev, "XDP is not supported by PPv2.1\n");
+		return -EOPNOTSUPP;
+	}
+
+	if (prog && (port->flags & MVPP2_F_IF_MUSDK)) {
+		netdev_err(dev, "XDP is not supported by MUSDK port\n");
+		return -EOPNOTSUPP;
+	}
+
+	/* Program must see the whole frame in one buffer */
+	if (prog && MVPP2_RX_PKT_SIZE(dev->mtu) > MVPP2_BM_LONG_PKT_SIZE) {
+		netdev_err(dev, "XDP is not supported with MTU %d\n", dev->mtu);
+		return -EOPNOTSUPP;
+	}
+
+	for (rxq = 0; prog && rxq < port->num_rx_queues; rxq++) {
+		if (port->rxqs[rxq]->ext_pool) {
+			netdev_err(dev, "XDP is not supported with rxq %d bound to external pool\n",
+				   rxq);
+			return -EOPNOTSUPP;
+		}
+	}
+
+	/* RX path picks the program up with READ_ONCE, the old one is
+	 * released after RCU grace period by bpf_prog_put.
+	 */
+	old_prog = xchg(&port->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+static int mv_pp2x_xdp(struct net_device *dev, struct netdev_xdp *xdp)
+{
+	struct mv_pp2x_port *port = netdev_priv(dev);
+
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return mv_pp2x_xdp_setup(dev, xdp->prog);
+	case XDP_QUERY_PROG:
+		xdp->prog_attached = !!port->xdp_prog;
+		return 0;
+	default:
+		return -EINVAL;
+	}
 }
+#endif /* MVPP2_XDP */
 
 /* Dummy netdev_ops for non-kernel (i.e. musdk) network devices */
 static int mv_pp2x_dummy_change_mtu(struct net_device *dev, int mtu)
@@ -4401,8 +6172,19 @@ static const struct net_device_ops mv_pp2x_netdev_ops = {
 	.ndo_get_stats64	= mv_pp2x_get_stats64,
 	.ndo_do_ioctl		= mv_pp2x_ioctl,
 	.ndo_set_features	= mv_pp2x_netdev_set_features,
+	.ndo_features_check	= mv_pp2x_features_check,
 	.ndo_vlan_rx_add_vid	= mv_pp2x_rx_add_vid,
 	.ndo_vlan_rx_kill_vid	= mv_pp2x_rx_kill_vid,
+	.ndo_set_tx_maxrate	= mv_pp2x_set_tx_maxrate,
+#ifdef MVPP2_XDP
+	.ndo_xdp		= mv_pp2x_xdp,
+#endif
+#ifdef CONFIG_RFS_ACCEL
+	.ndo_rx_flow_steer	= mv_pp2x_rx_flow_steer,
+#endif
+#ifdef MVPP2_TC
+	.ndo_setup_tc		= mv_pp2x_setup_tc,
+#endif
 };
 
 /* musdk ports contain dummy operations for those functions that are performed in UserSpace (i.e. musdk) */
@@ -4438,6 +6220,8 @@ static int  mv_pp2x_port_txqs_init(struct device *dev,
 	struct mv_pp2x_txq_pcpu *txq_pcpu;
 
 	port->tx_time_coal = MVPP2_TXDONE_COAL_USEC;
+	port->tx_db_frames = MVPP2_TX_DB_FRAMES;
+	port->tx_db_usecs = MVPP2_TX_DB_USEC;
 
 	for (queue = 0; queue < port->num_tx_queues; queue++) {
 		int queue_phy_id = mv_pp2x_txq_phys(port->id, queue);
@@ -4749,23 +6533,52 @@ static u32 mvp_pp2x_gop110_netc_cfg_create(struct mv_pp2x *priv)
 	return val;
 }
 
-static void mv_pp2x_get_port_stats(struct mv_pp2x_port *port)
+/* Accumulate the clear on read MAC and PPv2 counters of the port, at most
+ * every MVPP2_STATS_REFRESH_MSEC. If another context is refreshing them,
+ * its snapshot is used.
+ */
+static void mv_pp2x_port_stats_refresh(struct mv_pp2x_port *port)
 {
-	bool link_is_up;
 	struct mv_mac_data *mac = &port->mac_data;
 	struct gop_hw *gop = &port->priv->hw.gop;
-	int gop_port = mac->gop_index;
-	struct gop_stat	*gop_statistics = &mac->gop_statistics;
+	struct gop_stat gop_statistics;
 
 	if (port->priv->pp2_version == PPV21)
 		return;
-	if (!(port->flags & MVPP2_F_LOOPBACK)) {
-		link_is_up = mv_gop110_port_is_link_up(gop, &port->mac_data);
-		if (link_is_up) {
-			mv_gop110_mib_counters_stat_update(gop, gop_port, gop_statistics);
-			mv_pp2x_counters_stat_update(port, gop_statistics);
-		}
+	if (time_before(jiffies, port->stats_jiffies +
+			msecs_to_jiffies(MVPP2_STATS_REFRESH_MSEC)))
+		return;
+	if (!spin_trylock_bh(&port->stats_lock))
+		return;
+
+	if (!(port->flags & MVPP2_F_LOOPBACK) &&
+	    mv_gop110_port_is_link_up(gop, mac)) {
+		gop_statistics = mac->gop_statistics;
+		mv_gop110_mib_counters_stat_update(gop, mac->gop_index,
+						   &gop_statistics);
+		mv_pp2x_counters_stat_update(port, &gop_statistics);
+
+		write_seqcount_begin(&port->stats_seq);
+		mac->gop_statistics = gop_statistics;
+		write_seqcount_end(&port->stats_seq);
 	}
+	port->stats_jiffies = jiffies;
+
+	spin_unlock_bh(&port->stats_lock);
+}
+
+/* Get a consistent snapshot of the port MAC and PPv2 counters */
+void mv_pp2x_port_stats_get(struct mv_pp2x_port *port,
+			    struct gop_stat *gop_statistics)
+{
+	unsigned int start;
+
+	mv_pp2x_port_stats_refresh(port);
+
+	do {
+		start = read_seqcount_begin(&port->stats_seq);
+		*gop_statistics = port->mac_data.gop_statistics;
+	} while (read_seqcount_retry(&port->stats_seq, start));
 }
 
 static void mv_pp2x_get_device_stats(struct work_struct *work)
@@ -4777,7 +6590,7 @@ static void mv_pp2x_get_device_stats(struct work_struct *work)
 
 	for (i = 0; i < priv->num_ports; i++) {
 		if (priv->port_list[i])
-			mv_pp2x_get_port_stats(priv->port_list[i]);
+			mv_pp2x_port_stats_refresh(priv->port_list[i]);
 	}
 
 	queue_delayed_work(priv->workqueue, &priv->stats_task, stats_delay);
@@ -4881,6 +6694,18 @@ static void mv_pp2x_port_init_config(struct mv_pp2x_port *port)
 	/* RSS is disabled as default, it can be update when running */
 	port->rss_cfg.rss_en = 0;
 	port->rss_cfg.rss_mode = rss_mode;
+	/* TCP hash on 5T, UDP on rss_mode, fragments and others on 2T */
+	port->rss_cfg.hash_opts[MVPP2_RSS_FLOW_TCP4] = MVPP2_RSS_HEK_5T;
+	port->rss_cfg.hash_opts[MVPP2_RSS_FLOW_TCP6] = MVPP2_RSS_HEK_5T;
+	port->rss_cfg.hash_opts[MVPP2_RSS_FLOW_UDP4] =
+		(rss_mode == MVPP2_RSS_NF_UDP_5T) ? MVPP2_RSS_HEK_5T :
+		MVPP2_RSS_HEK_2T;
+	port->rss_cfg.hash_opts[MVPP2_RSS_FLOW_UDP6] =
+		port->rss_cfg.hash_opts[MVPP2_RSS_FLOW_UDP4];
+	port->rss_cfg.hash_opts[MVPP2_RSS_FLOW_IP4] = MVPP2_RSS_HEK_2T;
+	port->rss_cfg.hash_opts[MVPP2_RSS_FLOW_IP6] = MVPP2_RSS_HEK_2T;
+
+	port->plcr = MVPP2_PLCR_NONE;
 }
 
 /* Routine called by port CPU hot plug notifier. If port up callback set irq affinity for private interrupts,
@@ -4925,6 +6750,7 @@ static int mv_pp2x_port_cpu_callback(struct notifier_block *nfb,
 		aggr_txq->hw_count += aggr_txq->xmit_bulk;
 		mv_pp22_thread_write(&port->priv->hw, cpu, MVPP2_AGGR_TXQ_UPDATE_REG, aggr_txq->xmit_bulk);
 		aggr_txq->xmit_bulk = 0;
+		aggr_txq->xmit_bytes = 0;
 	}
 
 	return NOTIFY_OK;
@@ -4947,7 +6773,6 @@ static int mv_pp2x_port_probe(struct platform_device *pdev,
 	u32 id;
 	int features, err = 0, i, cpu;
 	int priv_common_regs_num = 2;
-	struct mv_pp2x_ext_buf_struct *ext_buf_struct;
 	unsigned int *port_irqs;
 	int port_num_irq;
 	int phy_mode;
@@ -5119,6 +6944,10 @@ static int mv_pp2x_port_probe(struct platform_device *pdev,
 		err = -ENOMEM;
 		goto err_free_irq;
 	}
+	spin_lock_init(&port->stats_lock);
+	seqcount_init(&port->stats_seq);
+	port->stats_jiffies = jiffies -
+		msecs_to_jiffies(MVPP2_STATS_REFRESH_MSEC);
 
 	port->tx_ring_size = tx_queue_size;
 	port->rx_ring_size = rx_queue_size;
@@ -5158,49 +6987,34 @@ static int mv_pp2x_port_probe(struct platform_device *pdev,
 		}
 	}
 
-	if (port->flags & MVPP2_F_IF_MUSDK)
-		goto skip_tso_buffers;
-	/* Init pool of external buffers for TSO, fragmentation, etc */
-	for_each_present_cpu(cpu) {
-		port_pcpu = per_cpu_ptr(port->pcpu, cpu);
-		port_pcpu->ext_buf_size = MVPP2_EXTRA_BUF_SIZE;
-
-		INIT_LIST_HEAD(&port_pcpu->ext_buf_port_list);
-		port_pcpu->ext_buf_pool = devm_kzalloc(port->dev->dev.parent,
-			sizeof(struct mv_pp2x_ext_buf_pool), GFP_ATOMIC);
-		port_pcpu->ext_buf_pool->buf_pool_size = MVPP2_EXTRA_BUF_NUM;
-		port_pcpu->ext_buf_pool->ext_buf_struct =
-			devm_kzalloc(port->dev->dev.parent,
-				     sizeof(*ext_buf_struct) * MVPP2_EXTRA_BUF_NUM, GFP_ATOMIC);
-
-		for (i = 0; i < MVPP2_EXTRA_BUF_NUM; i++) {
-			u8 *ext_buf = kmalloc(MVPP2_EXTRA_BUF_SIZE, GFP_ATOMIC);
-
-			port_pcpu->ext_buf_pool->ext_buf_struct[i].ext_buf_data = ext_buf;
-			if (!ext_buf) {
-				pr_warn("\to %s Warning: %d of %d extra buffers allocated\n",
-					__func__, i, MVPP2_EXTRA_BUF_NUM);
-				break;
-			}
-			list_add(&port_pcpu->ext_buf_pool->ext_buf_struct[i].ext_buf_list,
-				 &port_pcpu->ext_buf_port_list);
-			mv_pp2x_extra_pool_inc(port_pcpu->ext_buf_pool);
-			port_pcpu->ext_buf_pool->buf_pool_in_use++;
-		}
-	}
-
-skip_tso_buffers:
 	features = NETIF_F_SG;
 	dev->features = features | NETIF_F_RXCSUM | NETIF_F_IP_CSUM |
-			NETIF_F_IPV6_CSUM | NETIF_F_TSO;
+			NETIF_F_IPV6_CSUM | MVPP2_TSO_FEATURES;
 	dev->hw_features |= features | NETIF_F_RXCSUM | NETIF_F_GRO |
-			NETIF_F_IP_CSUM | NETIF_F_IPV6_CSUM | NETIF_F_TSO;
+			NETIF_F_IP_CSUM | NETIF_F_IPV6_CSUM | MVPP2_TSO_FEATURES;
 
 	/* Only when multi queue mode, rxhash is supported */
 	if (mv_pp2x_queue_mode)
 		dev->hw_features |= NETIF_F_RXHASH;
 
-	if (dev->features & NETIF_F_TSO)
+#ifdef CONFIG_RFS_ACCEL
+	/* aRFS needs one RX queue set per CPU and the PPv2.2 C3 engine */
+	if (priv->pp2_version == PPV22 &&
+	    mv_pp2x_queue_mode == MVPP2_QDIST_MULTI_MODE) {
+		err = mv_pp2x_arfs_init(port);
+		if (err)
+			goto err_free_port_pcpu;
+		dev->hw_features |= NETIF_F_NTUPLE;
+	}
+#endif
+#ifdef MVPP2_TC_FLOWER
+	/* tc flower filters use the C2 lookups of the ntuple rules */
+	if (priv->pp2_version == PPV22 &&
+	    mv_pp2x_queue_mode == MVPP2_QDIST_MULTI_MODE)
+		dev->hw_features |= NETIF_F_HW_TC;
+#endif
+
+	if (dev->features & MVPP2_TSO_FEATURES)
 		port->txq_stop_limit = TSO_TXQ_LIMIT;
 	else
 		port->txq_stop_limit = TXQ_LIMIT;
@@ -5268,6 +7082,14 @@ static void mv_pp2x_port_remove(struct mv_pp2x_port *port)
 		mv_pp2x_phy_disconnect(port);
 
 	unregister_netdev(port->dev);
+	mv_pp2x_port_ext_pools_unbind(port);
+#ifdef CONFIG_RFS_ACCEL
+	mv_pp2x_arfs_flush(port);
+#endif
+#ifdef MVPP2_XDP
+	if (port->xdp_prog)
+		bpf_prog_put(port->xdp_prog);
+#endif
 	free_percpu(port->pcpu);
 	free_percpu(port->stats);
 	for (i = 0; i < port->num_tx_queues; i++)
@@ -5449,6 +7271,9 @@ static int mv_pp2x_init(struct platform_device *pdev, struct mv_pp2x *priv)
 	if (err < 0)
 		return err;
 
+	/* Policer initialization */
+	mv_pp2x_plcr_init(hw);
+
 	if (pp2_ver == PPV22) {
 		for (i = 0; i < 128; i++) {
 			val = mv_pp2x_read(hw, MVPP2_RXQ_CONFIG_REG(i));
@@ -5893,7 +7718,7 @@ static int mv_pp2x_probe(struct platform_device *pdev)
 	struct mv_pp2x *priv;
 	struct mv_pp2x_hw *hw;
 	int port_count = 0, cpu;
-	int i, err;
+	int i, err, skb_num;
 	u32 cell_index = 0;
 	struct device_node *dn = pdev->dev.of_node;
 	struct device_node *port_node;
@@ -5963,17 +7788,19 @@ static int mv_pp2x_probe(struct platform_device *pdev)
 		goto  err_clk;
 	}
 
-	/* Init per CPU CP skb list for skb recycling */
+	/* Init per CPU CP skb cache for skb recycling, sized for RX rings
+	 * a CPU serves on all ports.
+	 */
+	skb_num = (rx_queue_size ? min_t(int, rx_queue_size, MVPP2_MAX_RXD) :
+		   MVPP2_MAX_RXD) * mv_pp2x_num_cos_queues * port_count;
 	for_each_present_cpu(cpu) {
 		cp_pcpu = per_cpu_ptr(priv->pcpu, cpu);
+		u64_stats_init(&cp_pcpu->syncp);
 
-		INIT_LIST_HEAD(&cp_pcpu->skb_port_list);
-		cp_pcpu->skb_pool = devm_kzalloc(&pdev->dev,
-			sizeof(struct mv_pp2x_skb_pool), GFP_ATOMIC);
-		cp_pcpu->skb_pool->skb_pool_size = MVPP2_SKB_NUM;
-		cp_pcpu->skb_pool->skb_struct =
-			devm_kzalloc(&pdev->dev,
-				     sizeof(struct mv_pp2x_skb_struct) * MVPP2_SKB_NUM, GFP_ATOMIC);
+		err = mv_pp2x_obj_cache_init(&pdev->dev, &cp_pcpu->skb_pool,
+					     skb_num);
+		if (err)
+			goto err_clk;
 	}
 
 	/* Init PP22 rxfhindir table evenly in probe */
@@ -5989,9 +7816,8 @@ static int mv_pp2x_probe(struct platform_device *pdev)
 			goto err_clk;
 	}
 	/* Init hrtimer for tx transmit procedure.
-	 * Instead of reg_write atfer each xmit callback, 50 microsecond
-	 * hrtimer would be started. Hrtimer will reduce amount of accesses
-	 * to transmit register and dmb() influence on network performance.
+	 * Doorbell may be deferred by up to tx_db_usecs when neither the
+	 * stack nor NAPI would ring it, see mv_pp2x_tx_doorbell().
 	 */
 	for_each_present_cpu(cpu) {
 		cp_pcpu = per_cpu_ptr(priv->pcpu, cpu);
@@ -6073,6 +7899,15 @@ static int mv_pp2x_remove(struct platform_device *pdev)
 		priv->num_ports--;
 	}
 
+	/* Cached skbs have no data buffer attached */
+	for_each_present_cpu(cpu) {
+		struct sk_buff *skb;
+
+		cp_pcpu = per_cpu_ptr(priv->pcpu, cpu);
+		while ((skb = mv_pp2x_obj_cache_get(&cp_pcpu->skb_pool)))
+			dev_kfree_skb_any(skb);
+	}
+
 	for (i = 0; i < priv->num_pools; i++) {
 		struct mv_pp2x_bm_pool *bm_pool = &priv->bm_pools[i];
 
@@ -0,0 +1,790 @@
+/*
+* ***************************************************************************
+* Copyright (C) 2016 Marvell International Ltd.
+* ***************************************************************************
+* This program is free software: you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation, either version 2 of the License, or any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+* ***************************************************************************
+*/
+
+#include <linux/kernel.h>
+#include <linux/netdevice.h>
+#include <linux/etherdevice.h>
+#include <linux/platform_device.h>
+#include <linux/skbuff.h>
+#include <linux/if_vlan.h>
+#include <linux/slab.h>
+#include <linux/version.h>
+#include <net/flow_dissector.h>
+#include <net/netlink.h>
+#include <net/pkt_cls.h>
+#include <net/pkt_sched.h>
+#include <net/tc_act/tc_gact.h>
+#include <net/tc_act/tc_skbedit.h>
+
+#include "mv_pp2x.h"
+#include "mv_pp2x_hw.h"
+
+#ifdef MVPP2_TC
+
+#ifdef MVPP2_TC_FLOWER
+struct mv_pp2x_tc_police {
+	u64 rate;	/* bytes/sec */
+	u64 burst;	/* bytes */
+};
+
+static const struct nla_policy mv_pp2x_tc_police_policy[TCA_POLICE_MAX + 1] = {
+	[TCA_POLICE_TBF]	= { .len = sizeof(struct tc_police) },
+	[TCA_POLICE_AVRATE]	= { .type = NLA_U32 },
+	[TCA_POLICE_RESULT]	= { .type = NLA_U32 },
+};
+
+/* struct tcf_police is private to act_police and these kernels have no
+ * accessors for it, so its parameters are read back from the action
+ * netlink dump, the attributes "tc actions get" returns. They are
+ * validated against the act_police policy. Only a single rate policer
+ * dropping the packets over it is offloaded.
+ */
+static int mv_pp2x_tc_police_parse(const struct tc_action *a,
+				   struct mv_pp2x_tc_police *police)
+{
+	struct nlattr *tb[TCA_POLICE_MAX + 1];
+	struct tc_police *parm;
+	struct sk_buff *skb;
+	u32 result;
+	int ret;
+
+	if (!a->ops->dump)
+		return -EOPNOTSUPP;
+
+	skb = alloc_skb(NLMSG_GOODSIZE, GFP_KERNEL);
+	if (!skb)
+		return -ENOMEM;
+
+	ret = a->ops->dump(skb, (struct tc_action *)a, 0, 0);
+	if (ret < 0)
+		goto out;
+
+	ret = nla_parse(tb, TCA_POLICE_MAX, (struct nlattr *)skb->data,
+			skb->len, mv_pp2x_tc_police_policy);
+	if (ret)
+		goto out;
+
+	ret = -EOPNOTSUPP;
+	if (!tb[TCA_POLICE_TBF] || tb[TCA_POLICE_AVRATE])
+		goto out;
+
+	if (tb[TCA_POLICE_RESULT]) {
+		result = nla_get_u32(tb[TCA_POLICE_RESULT]);
+		if (result != TC_ACT_OK && result != TC_ACT_PIPE)
+			goto out;
+	}
+
+	parm = nla_data(tb[TCA_POLICE_TBF]);
+	if (parm->action != TC_ACT_SHOT || !parm->rate.rate ||
+	    parm->peakrate.rate)
+		goto out;
+
+	police->rate = parm->rate.rate;
+	police->burst = div_u64(police->rate * PSCHED_TICKS2NS(parm->burst),
+				NSEC_PER_SEC);
+	ret = 0;
+out:
+	kfree_skb(skb);
+	return ret;
+}
+
+/* Allocate a policer of port metering as police */
+static int mv_pp2x_tc_plcr_get(struct mv_pp2x_port *port,
+			       struct mv_pp2x_tc_police *police)
+{
+	struct mv_pp2x_hw *hw = &port->priv->hw;
+	int plcr, ret;
+
+	plcr = mv_pp2x_plcr_alloc(hw, port->id);
+	if (plcr < 0)
+		return plcr;
+
+	ret = mv_pp2x_plcr_set(hw, plcr, police->rate, police->burst);
+	if (ret) {
+		mv_pp2x_plcr_free(hw, plcr);
+		return ret;
+	}
+
+	return plcr;
+}
+
+static u64 mv_pp2x_tc_mac_to_u64(const u8 *addr)
+{
+	u64 val = 0;
+	int i;
+
+	for (i = 0; i < ETH_ALEN; i++)
+		val = (val << 8) | addr[i];
+
+	return val;
+}
+
+/* Translate flower match keys to classifier ntuple rule */
+static int mv_pp2x_tc_flower_keys_parse(struct tc_cls_flower_offload *f,
+					struct mv_pp2x_cls_ntuple *rule)
+{
+	u64 da = 0, da_m = 0;
+	u32 sip = 0, sip_m = 0, dip = 0, dip_m = 0;
+	u16 vid = 0, vid_m = 0, proto = 0, proto_m = 0;
+	u16 sport = 0, sport_m = 0, dport = 0, dport_m = 0;
+	u8 l3 = 0, l3_m = 0;
+	u16 addr_type = 0;
+	int hek_offs = 0, ret = 0;
+
+	if (f->dissector->used_keys &
+	    ~(BIT(FLOW_DISSECTOR_KEY_CONTROL) |
+	      BIT(FLOW_DISSECTOR_KEY_BASIC) |
+	      BIT(FLOW_DISSECTOR_KEY_ETH_ADDRS) |
+	      BIT(FLOW_DISSECTOR_KEY_VLAN) |
+	      BIT(FLOW_DISSECTOR_KEY_IPV4_ADDRS) |
+	      BIT(FLOW_DISSECTOR_KEY_PORTS)))
+		return -EOPNOTSUPP;
+
+	if (dissector_uses_key(f->dissector, FLOW_DISSECTOR_KEY_CONTROL)) {
+		struct flow_dissector_key_control *key =
+			skb_flow_dissector_target(f->dissector,
+						  FLOW_DISSECTOR_KEY_CONTROL,
+						  f->key);
+
+		addr_type = key->addr_type;
+	}
+
+	if (dissector_uses_key(f->dissector, FLOW_DISSECTOR_KEY_BASIC)) {
+		struct flow_dissector_key_basic *key =
+			skb_flow_dissector_target(f->dissector,
+						  FLOW_DISSECTOR_KEY_BASIC,
+						  f->key);
+		struct flow_dissector_key_basic *mask =
+			skb_flow_dissector_target(f->dissector,
+						  FLOW_DISSECTOR_KEY_BASIC,
+						  f->mask);
+
+		proto = ntohs(key->n_proto);
+		proto_m = ntohs(mask->n_proto);
+		l3 = key->ip_proto;
+		l3_m = mask->ip_proto;
+	}
+
+	if (dissector_uses_key(f->dissector, FLOW_DISSECTOR_KEY_ETH_ADDRS)) {
+		struct flow_dissector_key_eth_addrs *key =
+			skb_flow_dissector_target(f->dissector,
+						  FLOW_DISSECTOR_KEY_ETH_ADDRS,
+						  f->key);
+		struct flow_dissector_key_eth_addrs *mask =
+			skb_flow_dissector_target(f->dissector,
+						  FLOW_DISSECTOR_KEY_ETH_ADDRS,
+						  f->mask);
+
+		if (!is_zero_ether_addr(mask->src))
+			return -EOPNOTSUPP;
+		da = mv_pp2x_tc_mac_to_u64(key->dst);
+		da_m = mv_pp2x_tc_mac_to_u64(mask->dst);
+	}
+
+	if (dissector_uses_key(f->dissector, FLOW_DISSECTOR_KEY_VLAN)) {
+		struct flow_dissector_key_vlan *key =
+			skb_flow_dissector_target(f->dissector,
+						  FLOW_DISSECTOR_KEY_VLAN,
+						  f->key);
+		struct flow_dissector_key_vlan *mask =
+			skb_flow_dissector_target(f->dissector,
+						  FLOW_DISSECTOR_KEY_VLAN,
+						  f->mask);
+
+		/* Only the VLAN ID is extracted */
+		if (mask->vlan_priority)
+			return -EOPNOTSUPP;
+		vid = key->vlan_id;
+		vid_m = mask->vlan_id;
+		if (vid_m) {
+			rule->flow_attr |= MVPP2_PRS_FL_ATTR_VLAN_BIT;
+			rule->flow_attr_mask |= MVPP2_PRS_FL_ATTR_VLAN_BIT;
+		}
+	}
+
+	if (addr_type == FLOW_DISSECTOR_KEY_IPV4_ADDRS) {
+		struct flow_dissector_key_ipv4_addrs *key =
+			skb_flow_dissector_target(f->dissector,
+						  FLOW_DISSECTOR_KEY_IPV4_ADDRS,
+						  f->key);
+		struct flow_dissector_key_ipv4_addrs *mask =
+			skb_flow_dissector_target(f->dissector,
+						  FLOW_DISSECTOR_KEY_IPV4_ADDRS,
+						  f->mask);
+
+		sip = ntohl(key->src);
+		sip_m = ntohl(mask->src);
+		dip = ntohl(key->dst);
+		dip_m = ntohl(mask->dst);
+	}
+
+	if (dissector_uses_key(f->dissector, FLOW_DISSECTOR_KEY_PORTS)) {
+		struct flow_dissector_key_ports *key =
+			skb_flow_dissector_target(f->dissector,
+						  FLOW_DISSECTOR_KEY_PORTS,
+						  f->key);
+		struct flow_dissector_key_ports *mask =
+			skb_flow_dissector_target(f->dissector,
+						  FLOW_DISSECTOR_KEY_PORTS,
+						  f->mask);
+
+		sport = ntohs(key->src);
+		sport_m = ntohs(mask->src);
+		dport = ntohs(key->dst);
+		dport_m = ntohs(mask->dst);
+	}
+
+	/* IPv4 and its TCP/UDP protocol are matched by the flow IDs, other
+	 * ethertypes and IP protocols by HEK fields
+	 */
+	if (proto_m && proto == ETH_P_IP) {
+		rule->flow_attr |= MVPP2_PRS_FL_ATTR_IP4_BIT;
+		rule->flow_attr_mask |= MVPP2_PRS_FL_ATTR_IP4_BIT;
+		proto_m = 0;
+		if (l3_m && (l3 == IPPROTO_TCP || l3 == IPPROTO_UDP)) {
+			rule->flow_attr |= (l3 == IPPROTO_TCP) ?
+				MVPP2_PRS_FL_ATTR_TCP_BIT :
+				MVPP2_PRS_FL_ATTR_UDP_BIT;
+			rule->flow_attr_mask |= MVPP2_PRS_FL_ATTR_TCP_BIT |
+						MVPP2_PRS_FL_ATTR_UDP_BIT;
+			l3_m = 0;
+		}
+	} else if (sip_m || dip_m || l3_m) {
+		return -EOPNOTSUPP;
+	}
+
+	if (sport_m || dport_m) {
+		if (!(rule->flow_attr & (MVPP2_PRS_FL_ATTR_TCP_BIT |
+					 MVPP2_PRS_FL_ATTR_UDP_BIT)))
+			return -EOPNOTSUPP;
+		/* Fragments carry no L4 header past the first one */
+		rule->flow_attr_mask |= MVPP2_PRS_FL_ATTR_FRAG_BIT;
+	}
+
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_MAC_DA,
+					    da, da_m, ETH_ALEN);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_VLAN,
+					    vid, vid_m, 2);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_ETH_TYPE,
+					    proto, proto_m, 2);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_L3_PROTO,
+					    l3, l3_m, 1);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_IP4SA,
+					    sip, sip_m, 4);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_IP4DA,
+					    dip, dip_m, 4);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_L4SIP,
+					    sport, sport_m, 2);
+	ret |= mv_pp2x_cls_ntuple_field_add(rule, &hek_offs,
+					    MVPP2_CLS_FIELD_L4DIP,
+					    dport, dport_m, 2);
+
+	return ret ? -EOPNOTSUPP : 0;
+}
+
+/* Translate flower actions, drop, skbedit queue_mapping (RX queue) and
+ * police
+ */
+static int mv_pp2x_tc_flower_actions_parse(struct mv_pp2x_port *port,
+					   struct tcf_exts *exts,
+					   struct mv_pp2x_cls_ntuple *rule,
+					   struct mv_pp2x_tc_police *police)
+{
+	const struct tc_action *a;
+	struct tcf_skbedit *skbedit;
+	LIST_HEAD(actions);
+	int ret;
+
+	if (tc_no_actions(exts))
+		return -EINVAL;
+
+	tcf_exts_to_list(exts, &actions);
+	list_for_each_entry(a, &actions, list) {
+		if (is_tcf_gact_shot(a)) {
+			rule->drop = true;
+			continue;
+		}
+		if (a->ops && a->ops->type == TCA_ACT_SKBEDIT) {
+			skbedit = to_skbedit((struct tc_action *)a);
+			if (skbedit->flags != SKBEDIT_F_QUEUE_MAPPING ||
+			    skbedit->queue_mapping >= port->num_rx_queues)
+				return -EOPNOTSUPP;
+			rule->rxq = port->rxqs[skbedit->queue_mapping]->id;
+			continue;
+		}
+		if (a->ops && a->ops->type == TCA_ACT_POLICE && !police->rate) {
+			ret = mv_pp2x_tc_police_parse(a, police);
+			if (ret)
+				return ret;
+			continue;
+		}
+		return -EOPNOTSUPP;
+	}
+
+	return 0;
+}
+
+static int mv_pp2x_tc_flower_find(struct mv_pp2x_port *port,
+				  unsigned long cookie)
+{
+	int i;
+
+	for (i = 0; i < port->tc_flower_num; i++)
+		if (port->tc_flowers[i]->cookie == cookie)
+			return i;
+
+	return -ENOENT;
+}
+
+/* Lookups apply in location order and the first match decides, so a filter
+ * of insertion order fits lookup loc only if filters added before it use
+ * lookups before it and filters added after it lookups after it.
+ */
+static bool mv_pp2x_tc_flower_lkp_fits(struct mv_pp2x_port *port, int loc,
+				       u32 order)
+{
+	struct mv_pp2x_tc_flower *cur;
+	int i;
+
+	for (i = 0; i < port->tc_flower_num; i++) {
+		cur = port->tc_flowers[i];
+		if ((cur->order < order && cur->loc > loc) ||
+		    (cur->order > order && cur->loc < loc))
+			return false;
+	}
+
+	return true;
+}
+
+/* Filters with the same match keys share an ntuple lookup, else a lookup
+ * free of ethtool rules and filters is taken. Return -EOPNOTSUPP if no
+ * lookup keeps the insertion order of the filters.
+ */
+static int mv_pp2x_tc_flower_lkp_get(struct mv_pp2x_port *port,
+				     struct mv_pp2x_cls_ntuple *rule, u32 order)
+{
+	struct mv_pp2x_cls_ntuple *cur;
+	int i, loc, ret = -ENOSPC;
+
+	for (i = 0; i < port->tc_flower_num; i++) {
+		cur = &port->tc_flowers[i]->rule;
+		if (cur->flow_attr == rule->flow_attr &&
+		    cur->flow_attr_mask == rule->flow_attr_mask &&
+		    cur->field_num == rule->field_num &&
+		    !memcmp(cur->field_id, rule->field_id,
+			    sizeof(rule->field_id))) {
+			loc = port->tc_flowers[i]->loc;
+			if (!mv_pp2x_tc_flower_lkp_fits(port, loc, order))
+				return -EOPNOTSUPP;
+			return loc;
+		}
+	}
+
+	for (loc = 0; loc < MVPP2_CLS_NTUPLE_RULES; loc++) {
+		if (port->ntuple_rules[loc].valid ||
+		    port->tc_flower_lkp_ref[loc])
+			continue;
+		if (!mv_pp2x_tc_flower_lkp_fits(port, loc, order)) {
+			ret = -EOPNOTSUPP;
+			continue;
+		}
+		mv_pp2x_cls_ntuple_lkp_set(&port->priv->hw, port->id, loc,
+					   rule);
+		return loc;
+	}
+
+	return ret;
+}
+
+static void mv_pp2x_tc_flower_lkp_put(struct mv_pp2x_port *port, int loc)
+{
+	if (--port->tc_flower_lkp_ref[loc])
+		return;
+
+	mv_pp2x_cls_ntuple_lkp_set(&port->priv->hw, port->id, loc, NULL);
+}
+
+static u64 mv_pp2x_tc_flower_hits_get(struct mv_pp2x_port *port, int pos)
+{
+	struct mv_pp2x_tc_flower *flower = port->tc_flowers[pos];
+	u32 cnt = 0;
+
+	mv_pp2x_cls_c2_hit_cntr_read(&port->priv->hw,
+				     MVPP2_CLS_C2_FLOWER_IDX(port->id, pos),
+				     &cnt);
+
+	return flower->hits + (u32)(cnt - flower->hits_base);
+}
+
+static int mv_pp2x_tc_flower_write(struct mv_pp2x_port *port,
+				   struct mv_pp2x_tc_flower *flower, int pos)
+{
+	int c2_index = MVPP2_CLS_C2_FLOWER_IDX(port->id, pos);
+	int ret;
+
+	ret = mv_pp2x_cls_ntuple_c2_set(port, flower->loc, &flower->rule,
+					c2_index);
+	if (ret)
+		return ret;
+
+	mv_pp2x_cls_c2_hit_cntr_read(&port->priv->hw, c2_index,
+				     &flower->hits_base);
+	port->tc_flowers[pos] = flower;
+
+	return 0;
+}
+
+/* Move filter to another C2 entry, keeping its hits. The filter matches in
+ * both entries until the source one is overwritten.
+ */
+static void mv_pp2x_tc_flower_move(struct mv_pp2x_port *port, int from,
+				   int to)
+{
+	struct mv_pp2x_tc_flower *flower = port->tc_flowers[from];
+
+	flower->hits = mv_pp2x_tc_flower_hits_get(port, from);
+	mv_pp2x_tc_flower_write(port, flower, to);
+}
+
+/* Remove filter in position pos, the next ones move up */
+static void mv_pp2x_tc_flower_remove(struct mv_pp2x_port *port, int pos)
+{
+	int last = port->tc_flower_num - 1;
+	int i;
+
+	for (i = pos; i < last; i++)
+		mv_pp2x_tc_flower_move(port, i + 1, i);
+
+	mv_pp2x_cls_c2_hw_inv(&port->priv->hw,
+			      MVPP2_CLS_C2_FLOWER_IDX(port->id, last));
+	port->tc_flowers[last] = NULL;
+	port->tc_flower_num--;
+}
+
+static int mv_pp2x_tc_flower_destroy(struct mv_pp2x_port *port,
+				     struct tc_cls_flower_offload *f)
+{
+	struct mv_pp2x_tc_flower *flower;
+	int pos;
+
+	pos = mv_pp2x_tc_flower_find(port, f->cookie);
+	if (pos < 0)
+		return pos;
+
+	flower = port->tc_flowers[pos];
+	mv_pp2x_tc_flower_remove(port, pos);
+	mv_pp2x_tc_flower_lkp_put(port, flower->loc);
+	if (flower->rule.police)
+		mv_pp2x_plcr_free(&port->priv->hw, flower->rule.plcr);
+	kfree(flower);
+
+	return 0;
+}
+
+/* Flower offload carries no filter priority before 4.11, so filters match
+ * in insertion order. A replaced filter keeps its order.
+ */
+static int mv_pp2x_tc_flower_replace(struct mv_pp2x_port *port,
+				     struct tc_cls_flower_offload *f)
+{
+	struct mv_pp2x_tc_police police = {0};
+	struct mv_pp2x_tc_flower *flower;
+	u32 order;
+	int pos, i, ret;
+
+	pos = mv_pp2x_tc_flower_find(port, f->cookie);
+	if (pos >= 0) {
+		order = port->tc_flowers[pos]->order;
+		mv_pp2x_tc_flower_destroy(port, f);
+	} else {
+		order = port->tc_flower_order;
+	}
+
+	if (port->tc_flower_num == MVPP2_CLS_C2_FLOWER_ENTRIES)
+		return -ENOSPC;
+
+	flower = kzalloc(sizeof(*flower), GFP_KERNEL);
+	if (!flower)
+		return -ENOMEM;
+
+	flower->cookie = f->cookie;
+	flower->order = order;
+	flower->lastuse = jiffies;
+
+	ret = mv_pp2x_tc_flower_keys_parse(f, &flower->rule);
+	if (!ret)
+		ret = mv_pp2x_tc_flower_actions_parse(port, f->exts,
+						      &flower->rule, &police);
+	if (ret) {
+		netdev_dbg(port->dev, "unsupported flower filter\n");
+		goto err_free;
+	}
+
+	if (police.rate) {
+		ret = mv_pp2x_tc_plcr_get(port, &police);
+		if (ret < 0)
+			goto err_free;
+		flower->rule.police = true;
+		flower->rule.plcr = ret;
+	}
+
+	ret = mv_pp2x_tc_flower_lkp_get(port, &flower->rule, flower->order);
+	if (ret < 0) {
+		if (ret == -EOPNOTSUPP)
+			netdev_err(port->dev,
+				   "flower filter can't be ordered after filters of other match keys\n");
+		goto err_plcr;
+	}
+	flower->loc = ret;
+	port->tc_flower_lkp_ref[flower->loc]++;
+
+	/* Lower C2 index wins */
+	for (pos = 0; pos < port->tc_flower_num; pos++)
+		if (port->tc_flowers[pos]->order > flower->order)
+			break;
+
+	port->tc_flower_num++;
+	for (i = port->tc_flower_num - 2; i >= pos; i--)
+		mv_pp2x_tc_flower_move(port, i, i + 1);
+
+	ret = mv_pp2x_tc_flower_write(port, flower, pos);
+	if (ret) {
+		mv_pp2x_tc_flower_remove(port, pos);
+		mv_pp2x_tc_flower_lkp_put(port, flower->loc);
+		goto err_plcr;
+	}
+	if (order == port->tc_flower_order)
+		port->tc_flower_order++;
+
+	return 0;
+
+err_plcr:
+	if (flower->rule.police)
+		mv_pp2x_plcr_free(&port->priv->hw, flower->rule.plcr);
+err_free:
+	kfree(flower);
+	return ret;
+}
+
+/* C2 counts packets only, no bytes are reported */
+static int mv_pp2x_tc_flower_stats(struct mv_pp2x_port *port,
+				   struct tc_cls_flower_offload *f)
+{
+	struct mv_pp2x_tc_flower *flower;
+	u64 hits;
+	int pos;
+
+	pos = mv_pp2x_tc_flower_find(port, f->cookie);
+	if (pos < 0)
+		return pos;
+
+	flower = port->tc_flowers[pos];
+	hits = mv_pp2x_tc_flower_hits_get(port, pos);
+	if (hits != flower->hits_reported)
+		flower->lastuse = jiffies;
+
+	tcf_exts_stats_update(f->exts, 0, hits - flower->hits_reported,
+			      flower->lastuse);
+	flower->hits_reported = hits;
+
+	return 0;
+}
+
+static bool mv_pp2x_tc_supported(struct mv_pp2x_port *port)
+{
+	return port->priv->pp2_version != PPV21 &&
+	       port->priv->pp2_cfg.queue_mode != MVPP2_QDIST_SINGLE_MODE;
+}
+
+static int mv_pp2x_tc_flower(struct mv_pp2x_port *port,
+			     struct tc_cls_flower_offload *f)
+{
+	if (!mv_pp2x_tc_supported(port))
+		return -EOPNOTSUPP;
+
+	switch (f->command) {
+	case TC_CLSFLOWER_REPLACE:
+		return mv_pp2x_tc_flower_replace(port, f);
+	case TC_CLSFLOWER_DESTROY:
+		return mv_pp2x_tc_flower_destroy(port, f);
+	case TC_CLSFLOWER_STATS:
+		return mv_pp2x_tc_flower_stats(port, f);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+/* Apply plcr to the port CoS C2 rules, the traffic no flower filter or
+ * ntuple rule policed
+ */
+static int mv_pp2x_tc_port_plcr_set(struct mv_pp2x_port *port, int plcr)
+{
+	int prev = port->plcr;
+	int ret;
+
+	port->plcr = plcr;
+	ret = mv_pp2x_cls_c2_rule_set(port,
+				      mv_pp2x_bound_cpu_first_rxq_calc(port));
+	if (ret) {
+		port->plcr = prev;
+		mv_pp2x_cls_c2_rule_set(port,
+					mv_pp2x_bound_cpu_first_rxq_calc(port));
+		return ret;
+	}
+
+	if (prev != MVPP2_PLCR_NONE)
+		mv_pp2x_plcr_free(&port->priv->hw, prev);
+
+	return 0;
+}
+
+/* matchall filter with a single police action polices all port traffic */
+static int mv_pp2x_tc_mall_replace(struct mv_pp2x_port *port,
+				   struct tc_cls_matchall_offload *m)
+{
+	struct mv_pp2x_tc_police police = {0};
+	const struct tc_action *a;
+	LIST_HEAD(actions);
+	int plcr, ret;
+
+	if (port->plcr != MVPP2_PLCR_NONE && port->tc_mall_cookie != m->cookie)
+		return -EBUSY;
+
+	if (tc_no_actions(m->exts))
+		return -EINVAL;
+
+	tcf_exts_to_list(m->exts, &actions);
+	list_for_each_entry(a, &actions, list) {
+		if (!a->ops || a->ops->type != TCA_ACT_POLICE || police.rate)
+			return -EOPNOTSUPP;
+		ret = mv_pp2x_tc_police_parse(a, &police);
+		if (ret)
+			return ret;
+	}
+
+	plcr = mv_pp2x_tc_plcr_get(port, &police);
+	if (plcr < 0)
+		return plcr;
+
+	ret = mv_pp2x_tc_port_plcr_set(port, plcr);
+	if (ret) {
+		mv_pp2x_plcr_free(&port->priv->hw, plcr);
+		return ret;
+	}
+	port->tc_mall_cookie = m->cookie;
+
+	return 0;
+}
+
+static int mv_pp2x_tc_mall_destroy(struct mv_pp2x_port *port,
+				   struct tc_cls_matchall_offload *m)
+{
+	if (port->plcr == MVPP2_PLCR_NONE || port->tc_mall_cookie != m->cookie)
+		return -ENOENT;
+
+	return mv_pp2x_tc_port_plcr_set(port, MVPP2_PLCR_NONE);
+}
+
+static int mv_pp2x_tc_mall(struct mv_pp2x_port *port,
+			   struct tc_cls_matchall_offload *m)
+{
+	if (!mv_pp2x_tc_supported(port))
+		return -EOPNOTSUPP;
+
+	switch (m->command) {
+	case TC_CLSMATCHALL_REPLACE:
+		return mv_pp2x_tc_mall_replace(port, m);
+	case TC_CLSMATCHALL_DESTROY:
+		return mv_pp2x_tc_mall_destroy(port, m);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+#endif /* MVPP2_TC_FLOWER */
+
+/* Traffic class i is sent on TXQ i in fixed priority, so a higher class is
+ * served first. The class rates are the tx_maxrate of its TXQ.
+ * Each class owns the netdev TX queues of its TXQ on all CPUs, and
+ * mv_pp2x_select_queue() picks the one of the sending CPU.
+ */
+static int mv_pp2x_tc_mqprio(struct mv_pp2x_port *port, u8 num_tc)
+{
+	struct net_device *dev = port->dev;
+	int ncpus = mv_pp2x_txq_ncpus(port);
+	int tc;
+
+	if (num_tc > port->num_tx_queues)
+		return -EINVAL;
+
+	if (!num_tc) {
+		if (port->num_tc)
+			mv_pp2x_txq_fixed_prio_set(port, port->tx_fixed_prio);
+		port->num_tc = 0;
+		netdev_reset_tc(dev);
+		return 0;
+	}
+
+	if (!port->num_tc)
+		port->tx_fixed_prio = mv_pp2x_txq_fixed_prio_get(port);
+
+	netdev_set_num_tc(dev, num_tc);
+	for (tc = 0; tc < num_tc; tc++)
+		netdev_set_tc_queue(dev, tc, ncpus,
+				    mv_pp2x_txq_ndev_queue(port, tc, 0));
+	mv_pp2x_txq_fixed_prio_set(port, (1 << num_tc) - 1);
+	port->num_tc = num_tc;
+
+	return 0;
+}
+
+#ifdef MVPP2_TC_TO_NETDEV
+int mv_pp2x_setup_tc(struct net_device *dev, u32 handle, __be16 proto,
+		     struct tc_to_netdev *tc)
+{
+	switch (tc->type) {
+	case TC_SETUP_MQPRIO:
+		return mv_pp2x_tc_mqprio(netdev_priv(dev), tc->tc);
+#ifdef MVPP2_TC_FLOWER
+	case TC_SETUP_CLSFLOWER:
+		if (TC_H_MAJ(handle) != TC_H_MAJ(TC_H_INGRESS))
+			return -EOPNOTSUPP;
+		return mv_pp2x_tc_flower(netdev_priv(dev), tc->cls_flower);
+	case TC_SETUP_MATCHALL:
+		if (TC_H_MAJ(handle) != TC_H_MAJ(TC_H_INGRESS))
+			return -EOPNOTSUPP;
+		return mv_pp2x_tc_mall(netdev_priv(dev), tc->cls_mall);
+#endif
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+#else
+int mv_pp2x_setup_tc(struct net_device *dev, u8 num_tc)
+{
+	return mv_pp2x_tc_mqprio(netdev_priv(dev), num_tc);
+}
+#endif
+
+#endif /* MVPP2_TC */
@@ -476,8 +476,7 @@ void mvPp2TxqShow(struct mv_pp2x *priv, int port, int txq, int mode)
 			txq_pcpu->reserved_num);
 		DBG_MSG("txq_put_index=%d, txq_get_index=%d\n",
 			txq_pcpu->txq_put_index, txq_pcpu->txq_get_index);
-		DBG_MSG("tx_skb=%p, tx_buffs=%p\n",
-			txq_pcpu->tx_skb, txq_pcpu->tx_buffs);
+		DBG_MSG("shadow=%p\n", txq_pcpu->shadow);
 	}
 
 	if (mode)
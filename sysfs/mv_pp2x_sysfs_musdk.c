@@ -31,6 +31,7 @@ disclaimer.
 #include <linux/capability.h>
 #include <linux/platform_device.h>
 #include <linux/netdevice.h>
+#include <linux/rtnetlink.h>
 
 #include "mv_pp2x_sysfs.h"
 
@@ -39,6 +40,10 @@ static ssize_t mv_pp2_help(char *buf)
 {
 	int off = 0;
 	off += sprintf(buf+off, "This sysfs used by MUSDK\n");
+	off += sprintf(buf+off, "cat                rxq_pools       - show BM pools of RXQs handed over to user space\n");
+	off += sprintf(buf+off, "echo rxq pkt_size > rxq_pool_bind   - hand RXQ over to user space with dedicated BM pool\n");
+	off += sprintf(buf+off, "echo rxq          > rxq_pool_unbind - return RXQ to kernel, release its BM pool\n");
+	off += sprintf(buf+off, "   rxq is port relative, port must be down\n");
 
 	return off;
 }
@@ -65,6 +70,17 @@ static ssize_t mv_pp2_show(struct device *dev,
 		off = scnprintf(buf, PAGE_SIZE, "%d\n", rel_first_rxq);
 	} else if (!strcmp(name, "num_tx_queues")) {
 		off = scnprintf(buf, PAGE_SIZE, "%d\n", sysfs_cur_port->num_tx_queues);
+	} else if (!strcmp(name, "rxq_pools")) {
+		int rxq;
+
+		for (rxq = 0; rxq < sysfs_cur_port->num_rx_queues; rxq++) {
+			struct mv_pp2x_bm_pool *bm_pool = sysfs_cur_port->rxqs[rxq]->ext_pool;
+
+			if (!bm_pool)
+				continue;
+			off += scnprintf(buf + off, PAGE_SIZE - off, "%d %d %d\n", rxq,
+					 sysfs_cur_port->rxqs[rxq]->id, bm_pool->id);
+		}
 	} else {
 		off = mv_pp2_help(buf);
 	}
@@ -109,11 +125,65 @@ static ssize_t mv_pp2_port_store(struct device *dev,
 	return err ? -EINVAL : len;
 }
 
+static ssize_t mv_pp2_rxq_store(struct device *dev,
+				struct device_attribute *attr, const char *buf, size_t len)
+{
+	const char	*name = attr->attr.name;
+	int		err;
+	u32		rxq, pkt_size, pool_id;
+	struct mv_pp2x	*priv;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	if (!sysfs_cur_port) {
+		printk(KERN_ERR "%s: sysfs_cur_port not set\n", __func__);
+		return -EINVAL;
+	}
+
+	rxq = pkt_size = 0;
+	priv = sysfs_cur_port->priv;
+
+	rtnl_lock();
+	if (!strcmp(name, "rxq_pool_bind")) {
+		if (sscanf(buf, "%u %u", &rxq, &pkt_size) != 2 ||
+		    rxq >= sysfs_cur_port->num_rx_queues ||
+		    !pkt_size || pkt_size > MVPP2_BM_JUMBO_PKT_SIZE) {
+			err = -EINVAL;
+		} else if (priv->num_pools >= MVPP2_BM_POOLS_MAX_ALLOC_NUM) {
+			err = -ENOSPC;
+		} else {
+			err = mv_pp2x_rxq_ext_pool_bind(sysfs_cur_port, rxq, pkt_size, &pool_id);
+			if (!err)
+				printk(KERN_INFO "%s: rxq %u bound to BM pool %u\n",
+				       sysfs_cur_port->dev->name, rxq, pool_id);
+		}
+	} else if (!strcmp(name, "rxq_pool_unbind")) {
+		if (sscanf(buf, "%u", &rxq) != 1 ||
+		    rxq >= sysfs_cur_port->num_rx_queues)
+			err = -EINVAL;
+		else
+			err = mv_pp2x_rxq_ext_pool_unbind(sysfs_cur_port, rxq);
+	} else {
+		err = -EINVAL;
+		printk(KERN_ERR "%s: illegal operation <%s>\n", __func__, attr->attr.name);
+	}
+	rtnl_unlock();
+
+	if (err)
+		printk(KERN_ERR "%s: error %d\n", __func__, err);
+
+	return err ? err : len;
+}
+
 static DEVICE_ATTR(help,		S_IRUSR, mv_pp2_show, NULL);
 static DEVICE_ATTR(num_rx_queues,	S_IRUSR, mv_pp2_show, NULL);
 static DEVICE_ATTR(first_rxq,		S_IRUSR, mv_pp2_show, NULL);
 static DEVICE_ATTR(num_tx_queues,	S_IRUSR, mv_pp2_show, NULL);
 static DEVICE_ATTR(sysfs_current_port,	S_IWUSR, NULL, mv_pp2_port_store);
+static DEVICE_ATTR(rxq_pools,		S_IRUSR, mv_pp2_show, NULL);
+static DEVICE_ATTR(rxq_pool_bind,	S_IWUSR, NULL, mv_pp2_rxq_store);
+static DEVICE_ATTR(rxq_pool_unbind,	S_IWUSR, NULL, mv_pp2_rxq_store);
 
 static struct attribute *mv_pp2_attrs[] = {
 	&dev_attr_help.attr,
@@ -121,6 +191,9 @@ static struct attribute *mv_pp2_attrs[] = {
 	&dev_attr_first_rxq.attr,
 	&dev_attr_num_tx_queues.attr,
 	&dev_attr_sysfs_current_port.attr,
+	&dev_attr_rxq_pools.attr,
+	&dev_attr_rxq_pool_bind.attr,
+	&dev_attr_rxq_pool_unbind.attr,
 	NULL
 };
 
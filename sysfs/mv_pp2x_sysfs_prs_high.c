@@ -43,11 +43,35 @@ static ssize_t mv_prs_high_help(char *b)
 
 	o += scnprintf(b + o, PAGE_SIZE - o, "cd                 debug       - move to parser low level sysfs directory\n");
 	o += scnprintf(b + o, PAGE_SIZE - o, "cat                dump        - dump all valid HW entries\n");
+	o += scnprintf(b + o, PAGE_SIZE - o, "cat                tcam_usage  - show TCAM regions occupancy and fragmentation\n");
 
 	return o;
 }
 
 
+static ssize_t mv_prs_tcam_usage(char *b)
+{
+	struct mv_pp2x_prs_region_stats stats;
+	int o = 0, i;
+
+	o += scnprintf(b + o, PAGE_SIZE - o, "%-6s %9s %5s %5s %9s %9s\n",
+		       "region", "range", "used", "free", "free_runs",
+		       "max_run");
+	for (i = 0; i < MVPP2_PRS_REGION_LAST; i++) {
+		if (mv_pp2x_prs_region_stats_get(sysfs_cur_hw, i, &stats))
+			continue;
+		o += scnprintf(b + o, PAGE_SIZE - o,
+			       "%-6s %4d-%-4d %5d %5d %9d %9d\n",
+			       stats.name, stats.start, stats.end, stats.used,
+			       stats.free, stats.free_runs,
+			       stats.largest_free_run);
+	}
+	o += scnprintf(b + o, PAGE_SIZE - o, "compaction moves: %u\n",
+		       sysfs_cur_hw->prs_moves);
+
+	return o;
+}
+
 static ssize_t mv_prs_high_show(struct device *dev,
 				  struct device_attribute *attr, char *buf)
 {
@@ -59,6 +83,8 @@ static ssize_t mv_prs_high_show(struct device *dev,
 
 	if (!strcmp(name, "dump"))
 		mv_pp2x_prs_hw_dump(sysfs_cur_hw);
+	else if (!strcmp(name, "tcam_usage"))
+		off += mv_prs_tcam_usage(buf);
 	else
 		off += mv_prs_high_help(buf);
 
@@ -68,11 +94,13 @@ static ssize_t mv_prs_high_show(struct device *dev,
 
 
 static DEVICE_ATTR(dump,		S_IRUSR, mv_prs_high_show, NULL);
+static DEVICE_ATTR(tcam_usage,		S_IRUSR, mv_prs_high_show, NULL);
 static DEVICE_ATTR(help,		S_IRUSR, mv_prs_high_show, NULL);
 
 
 static struct attribute *prs_high_attrs[] = {
 	&dev_attr_dump.attr,
+	&dev_attr_tcam_usage.attr,
 	&dev_attr_help.attr,
     NULL
 };
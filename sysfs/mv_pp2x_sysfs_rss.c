@@ -31,6 +31,8 @@ disclaimer.
 #include <linux/capability.h>
 #include <linux/kernel.h>
 #include <linux/platform_device.h>
+#include <linux/netdevice.h>
+#include <linux/rtnetlink.h>
 #include "mv_pp2x_sysfs.h"
 
 #ifdef MVPP2_SOC_TEST
@@ -51,6 +53,12 @@ static ssize_t mv_rss_help(char *buf)
 	off += scnprintf(buf + off, PAGE_SIZE,  "                 - 1 - 5-Tuple\n");
 	off += scnprintf(buf + off, PAGE_SIZE,  "echo [if_name] [cpu]     >  rss_dflt_cpu - Set cpu to handle the non-IP packet\n");
 	off += scnprintf(buf + off, PAGE_SIZE,  "\n");
+	off += scnprintf(buf + off, PAGE_SIZE,  "cat                         rss_ctx      - show RSS contexts, their CPUs and ntuple rules.\n");
+	off += scnprintf(buf + off, PAGE_SIZE,  "echo [if_name]           >  rss_ctx_add  - Create RSS context on a spare RSS table\n");
+	off += scnprintf(buf + off, PAGE_SIZE,  "echo [if_name] [ctx]     >  rss_ctx_del  - Delete RSS context, no ntuple rule may use it\n");
+	off += scnprintf(buf + off, PAGE_SIZE,  "echo [if_name] [ctx] [cpu_mask] > rss_ctx_cpus - Spread RSS context over the CPUs of hex cpu_mask\n");
+	off += scnprintf(buf + off, PAGE_SIZE,  "echo [if_name] [rule] [ctx] > rss_ctx_rule - Spread ntuple rule flows by RSS context, ctx 0 for rule queue\n");
+	off += scnprintf(buf + off, PAGE_SIZE,  "\n");
 #ifdef MVPP2_SOC_TEST
 	off += scnprintf(buf + off, PAGE_SIZE,  "echo [rss_sel]           >  rss_hash_sel ");
 	off += scnprintf(buf + off, PAGE_SIZE,  "                                         ");
@@ -66,6 +74,29 @@ static ssize_t mv_rss_help(char *buf)
 }
 
 
+static int mv_rss_ctx_dump(char *buf)
+{
+	struct mv_pp2x_port *port;
+	int ctx, loc, off = 0;
+
+	rtnl_lock();
+	for (ctx = 0; ctx < MVPP22_RSS_TBL_NUM; ctx++) {
+		port = sysfs_cur_priv->rss_ctx_port[ctx];
+		if (!port)
+			continue;
+		off += scnprintf(buf + off, PAGE_SIZE - off, "ctx %d: %s cpus 0x%x rules",
+				 ctx, port->dev->name, mv_pp22_rss_ctx_cpus_get(port, ctx));
+		for (loc = 0; loc < MVPP2_CLS_NTUPLE_RULES; loc++)
+			if (port->ntuple_rules[loc].valid &&
+			    port->ntuple_rules[loc].rss_context == ctx)
+				off += scnprintf(buf + off, PAGE_SIZE - off, " %d", loc);
+		off += scnprintf(buf + off, PAGE_SIZE - off, "\n");
+	}
+	rtnl_unlock();
+
+	return off;
+}
+
 static ssize_t mv_rss_show(struct device *dev,
 				struct device_attribute *attr, char *buf)
 {
@@ -81,6 +112,8 @@ static ssize_t mv_rss_show(struct device *dev,
 		mv_pp22_rss_hw_rxq_tbl_dump(sysfs_cur_hw);
 	} else if (!strcmp(name, "num_rss_tables")) {
 		off += scnprintf(buf + off, PAGE_SIZE, "%d\n", sysfs_cur_priv->num_rss_tables);
+	} else if (!strcmp(name, "rss_ctx")) {
+		off += mv_rss_ctx_dump(buf);
 	} else {
 		off += mv_rss_help(buf);
 	}
@@ -128,6 +161,64 @@ static ssize_t mv_rss_store(struct device *dev,
 	return err ? -EINVAL : len;
 }
 
+static ssize_t mv_rss_ctx_store(struct device *dev,
+				struct device_attribute *attr, const char *buf, size_t len)
+{
+	const char	*name = attr->attr.name;
+	int		err;
+	u32		a = 0, b = 0;
+	char		if_name[IFNAMSIZ];
+	struct net_device *netdev;
+	struct mv_pp2x_port *port;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	if (sscanf(buf, "%15s", if_name) != 1)
+		return -EINVAL;
+
+	netdev = dev_get_by_name(&init_net, if_name);
+	if (!netdev) {
+		printk(KERN_ERR "%s: illegal interface <%s>\n", __func__, if_name);
+		return -EINVAL;
+	}
+	port = netdev_priv(netdev);
+
+	rtnl_lock();
+	if (!strcmp(name, "rss_ctx_add")) {
+		err = mv_pp22_rss_ctx_alloc(port);
+		if (err >= 0) {
+			printk(KERN_INFO "%s: RSS context %d created\n", if_name, err);
+			err = 0;
+		}
+	} else if (!strcmp(name, "rss_ctx_del")) {
+		if (sscanf(buf, "%*s %u", &a) != 1)
+			err = -EINVAL;
+		else
+			err = mv_pp22_rss_ctx_free(port, a);
+	} else if (!strcmp(name, "rss_ctx_cpus")) {
+		if (sscanf(buf, "%*s %u %x", &a, &b) != 2)
+			err = -EINVAL;
+		else
+			err = mv_pp22_rss_ctx_cpus_set(port, a, b);
+	} else if (!strcmp(name, "rss_ctx_rule")) {
+		if (sscanf(buf, "%*s %u %u", &a, &b) != 2)
+			err = -EINVAL;
+		else
+			err = mv_pp2x_ntuple_rss_ctx_set(port, a, b);
+	} else {
+		err = -EINVAL;
+		printk(KERN_ERR "%s: illegal operation <%s>\n", __func__, attr->attr.name);
+	}
+	rtnl_unlock();
+
+	if (err)
+		printk(KERN_ERR "%s: error %d\n", __func__, err);
+	dev_put(netdev);
+
+	return err ? err : len;
+}
+
 #ifdef MVPP2_SOC_TEST
 static ssize_t mv_rss_store4(struct device *dev,
 			struct device_attribute *attr, const char *buf, size_t len)
@@ -168,6 +259,11 @@ static DEVICE_ATTR(num_rss_tables,	S_IRUSR, mv_rss_show, NULL);
 static DEVICE_ATTR(help,		S_IRUSR, mv_rss_show, NULL);
 static DEVICE_ATTR(rss_mode,		S_IWUSR, NULL, mv_rss_store);
 static DEVICE_ATTR(rss_dflt_cpu,	S_IWUSR, NULL, mv_rss_store);
+static DEVICE_ATTR(rss_ctx,		S_IRUSR, mv_rss_show, NULL);
+static DEVICE_ATTR(rss_ctx_add,		S_IWUSR, NULL, mv_rss_ctx_store);
+static DEVICE_ATTR(rss_ctx_del,		S_IWUSR, NULL, mv_rss_ctx_store);
+static DEVICE_ATTR(rss_ctx_cpus,	S_IWUSR, NULL, mv_rss_ctx_store);
+static DEVICE_ATTR(rss_ctx_rule,	S_IWUSR, NULL, mv_rss_ctx_store);
 #ifdef MVPP2_SOC_TEST
 static DEVICE_ATTR(rss_hash_sel,	S_IWUSR, NULL, mv_rss_store4);
 static DEVICE_ATTR(rss_tbl_rxq_bind,	S_IWUSR, NULL, mv_rss_store4);
@@ -181,6 +277,11 @@ static struct attribute *rss_attrs[] = {
 	&dev_attr_help.attr,
 	&dev_attr_rss_mode.attr,
 	&dev_attr_rss_dflt_cpu.attr,
+	&dev_attr_rss_ctx.attr,
+	&dev_attr_rss_ctx_add.attr,
+	&dev_attr_rss_ctx_del.attr,
+	&dev_attr_rss_ctx_cpus.attr,
+	&dev_attr_rss_ctx_rule.attr,
 #ifdef MVPP2_SOC_TEST
 	&dev_attr_rss_hash_sel.attr,
 	&dev_attr_rss_tbl_rxq_bind.attr,